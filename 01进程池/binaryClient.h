@@ -0,0 +1,188 @@
+#ifndef __BINARYCLIENT_H
+#define __BINARYCLIENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <vector>
+
+#include "binaryProtocol.h"
+
+/*
+二进制协议的客户端库（阻塞socket）
+用法：多次add_request把请求编码到发送缓冲区，flush一次send全部发送，然后recv_response逐个取出响应
+响应可能乱序返回，调用者通过request_id匹配请求；call_batch封装了"批量发送+按id收齐"的过程
+*/
+
+//一个响应
+struct bin_response
+{
+	uint32_t request_id;
+	uint16_t opcode;
+	uint16_t status;
+	std::vector<char> payload;
+};
+
+//批量调用中的一个请求
+struct bin_request
+{
+	uint16_t opcode;
+	const void *payload;
+	uint32_t length;
+};
+
+class bin_client
+{
+public:
+	bin_client() : m_sockfd(-1),m_next_id(1),m_recv_start(0){}
+	~bin_client(){ close_conn(); }
+
+	//连接服务端，成功返回0，失败返回-1
+	int connect_to(const char *ip,int port){
+		m_sockfd = socket(AF_INET,SOCK_STREAM,0);
+		if(m_sockfd < 0){
+			return -1;
+		}
+
+		struct sockaddr_in addr;
+		memset(&addr,0,sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = inet_addr(ip);
+
+		if(connect(m_sockfd,(struct sockaddr*)&addr,sizeof(addr)) == -1){
+			close_conn();
+			return -1;
+		}
+
+		int nodelay = 1;												//批量已经在应用层做了，关闭Nagle避免flush之后还要等待
+		setsockopt(m_sockfd,IPPROTO_TCP,TCP_NODELAY,&nodelay,sizeof(nodelay));
+		return 0;
+	}
+
+	void close_conn(){
+		if(m_sockfd >= 0){
+			close(m_sockfd);
+			m_sockfd = -1;
+		}
+	}
+
+	//把一个请求编码到发送缓冲区，返回分配的request_id，此时还没有真正发送
+	uint32_t add_request(uint16_t opcode,const void *payload,uint32_t len){
+		bin_header h;
+		h.length = len;
+		h.request_id = m_next_id++;
+		h.opcode = opcode;
+		h.status = 0;
+
+		size_t off = m_send_buf.size();
+		m_send_buf.resize(off + BIN_HEADER_LEN + len);
+		bin_encode_header(&m_send_buf[off],h);
+		if(len > 0){
+			memcpy(&m_send_buf[off + BIN_HEADER_LEN],payload,len);
+		}
+		return h.request_id;
+	}
+
+	//发送缓冲区中所有的请求，成功返回0
+	int flush(){
+		size_t sent = 0;
+		while(sent < m_send_buf.size()){
+			int ret = send(m_sockfd,&m_send_buf[sent],m_send_buf.size() - sent,0);
+			if(ret < 0){
+				if(errno == EINTR){
+					continue;
+				}
+				return -1;
+			}
+			sent += ret;
+		}
+		m_send_buf.clear();
+		return 0;
+	}
+
+	//接收一个完整的响应，成功返回0，连接关闭或出错返回-1
+	int recv_response(bin_response &rsp){
+		while(true){
+			size_t avail = m_recv_buf.size() - m_recv_start;
+			if(avail >= BIN_HEADER_LEN){
+				bin_header h;
+				bin_decode_header(&m_recv_buf[m_recv_start],h);
+				if(avail >= BIN_HEADER_LEN + h.length){					//一个完整的响应
+					const char *p = &m_recv_buf[m_recv_start] + BIN_HEADER_LEN;
+					rsp.request_id = h.request_id;
+					rsp.opcode = h.opcode;
+					rsp.status = h.status;
+					rsp.payload.assign(p,p + h.length);
+					m_recv_start += BIN_HEADER_LEN + h.length;
+					return 0;
+				}
+			}
+
+			//数据不够，整理缓冲区后继续接收，一次recv尽可能多读，后面的响应就不需要再系统调用了
+			if(m_recv_start > 0){
+				m_recv_buf.erase(m_recv_buf.begin(),m_recv_buf.begin() + m_recv_start);
+				m_recv_start = 0;
+			}
+			size_t off = m_recv_buf.size();
+			m_recv_buf.resize(off + RECV_CHUNK);
+			int ret = recv(m_sockfd,&m_recv_buf[off],RECV_CHUNK,0);
+			m_recv_buf.resize(off + (ret > 0 ? ret : 0));
+			if(ret == 0 || (ret < 0 && errno != EINTR)){
+				return -1;
+			}
+		}
+	}
+
+	/*
+	批量调用：一次发送n个请求，收齐n个响应，rsps[i]对应reqs[i]（按request_id归位，与响应到达的顺序无关）
+	成功返回0，失败返回-1
+	*/
+	int call_batch(const bin_request *reqs,int n,bin_response *rsps){
+		uint32_t first_id = m_next_id;
+		for(int i = 0;i < n;i++){
+			add_request(reqs[i].opcode,reqs[i].payload,reqs[i].length);
+		}
+		if(flush() < 0){
+			return -1;
+		}
+
+		bin_response rsp;
+		for(int i = 0;i < n;i++){
+			if(recv_response(rsp) < 0){
+				return -1;
+			}
+			uint32_t idx = rsp.request_id - first_id;
+			if(idx >= (uint32_t)n){										//不属于本批次的响应
+				return -1;
+			}
+			rsps[idx].request_id = rsp.request_id;
+			rsps[idx].opcode = rsp.opcode;
+			rsps[idx].status = rsp.status;
+			rsps[idx].payload.swap(rsp.payload);
+		}
+		return 0;
+	}
+
+private:
+	static const int RECV_CHUNK = 64 * 1024;
+
+	int m_sockfd;
+	uint32_t m_next_id;													//下一个请求的id，单调递增
+
+	std::vector<char> m_send_buf;										//待发送的请求（已编码）
+	std::vector<char> m_recv_buf;										//已接收但还没有解析的数据
+	size_t m_recv_start;												//m_recv_buf中未解析数据的起始位置
+};
+
+#endif
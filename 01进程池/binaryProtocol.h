@@ -0,0 +1,74 @@
+#ifndef __BINARYPROTOCOL_H
+#define __BINARYPROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+
+/*
+长度前缀的二进制协议：用于替代"文件名\r\n"的文本协议
+1.文本协议需要逐字节扫描\r\n，并且一个连接只能处理一个请求
+2.二进制协议每个请求都有固定长度的包头，先读包头就知道负载有多长，不需要扫描
+3.一个数据包中可以包含多个请求（批量），每个请求带有request_id，响应通过request_id匹配请求，所以允许乱序返回
+  客户端可以一次send几百个小请求，服务端一次readv读入、一次writev写回，摊薄系统调用的开销
+
+包头格式（网络字节序，共12字节）：
+	| length(4) | request_id(4) | opcode(2) | status(2) |
+length是负载长度，不包含包头；请求中status为0，响应中status为处理结果
+*/
+
+#define BIN_HEADER_LEN		12
+#define BIN_MAX_PAYLOAD		(64 * 1024)											//单个请求的最大负载，超过则认为是非法数据，关闭连接
+
+//操作码
+enum bin_opcode
+{
+	BIN_OP_NOOP = 0,															//空操作，直接返回空响应，用于测试协议本身的开销
+	BIN_OP_ECHO = 1,															//回显负载
+	BIN_OP_STAT = 2,															//负载是文件路径，返回8字节的文件大小（对应文本协议中的access检查）
+};
+
+//响应状态码
+enum bin_status
+{
+	BIN_STATUS_OK = 0,
+	BIN_STATUS_NOT_FOUND = 1,
+	BIN_STATUS_BAD_REQUEST = 2,
+};
+
+struct bin_header
+{
+	uint32_t length;
+	uint32_t request_id;
+	uint16_t opcode;
+	uint16_t status;
+};
+
+//包头编码：主机字节序 ---> 网络字节序，逐字段写入，避免结构体对齐带来的问题
+static inline void bin_encode_header(char *buf,const bin_header &h){
+	uint32_t l = htonl(h.length);
+	uint32_t id = htonl(h.request_id);
+	uint16_t op = htons(h.opcode);
+	uint16_t st = htons(h.status);
+	memcpy(buf,&l,4);
+	memcpy(buf + 4,&id,4);
+	memcpy(buf + 8,&op,2);
+	memcpy(buf + 10,&st,2);
+}
+
+//包头解码：网络字节序 ---> 主机字节序
+static inline void bin_decode_header(const char *buf,bin_header &h){
+	uint32_t l,id;
+	uint16_t op,st;
+	memcpy(&l,buf,4);
+	memcpy(&id,buf + 4,4);
+	memcpy(&op,buf + 8,2);
+	memcpy(&st,buf + 10,2);
+	h.length = ntohl(l);
+	h.request_id = ntohl(id);
+	h.opcode = ntohs(op);
+	h.status = ntohs(st);
+}
+
+#endif
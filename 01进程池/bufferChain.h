@@ -0,0 +1,332 @@
+#ifndef __BUFFERCHAIN_H
+#define __BUFFERCHAIN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*
+链式缓冲区：用于进程池中模板类T（比如cgi_conn）的读写缓冲
+1.原来每个连接都有一个固定的char m_buffer[1024]，请求超过1023字节就永远读不完；请求很短又浪费了剩下的空间，65535个连接就是64M
+2.这里把缓冲区拆成固定大小的块（chunk），块从空闲链表中获取，用完之后归还空闲链表，空闲连接不持有任何块，内存几乎为0
+3.使用readv一次系统调用读入多个块，解析时直接在块链上查找，不需要把数据拷贝成一整块
+注意：子进程是单线程的，空闲链表不需要加锁；fork之后每个子进程各自拥有一份空闲链表
+*/
+
+//缓冲块：块头 + 数据区，数据区中[m_start,m_end)是有效数据
+struct buffer_chunk
+{
+	static const int CHUNK_SIZE = 2048;								//每个块的数据区大小
+
+	buffer_chunk *m_next;											//单链表，指向下一个块
+	int m_start;													//有效数据的起始位置（被consume之后向后移动）
+	int m_end;														//有效数据的结束位置（读入数据之后向后移动）
+	char m_data[CHUNK_SIZE];
+};
+
+//块的空闲链表，每个进程一份，避免频繁的malloc/free
+class chunk_freelist
+{
+public:
+	static chunk_freelist& instance(){								//函数内静态变量，头文件中定义也不会重复
+		static chunk_freelist s_freelist;
+		return s_freelist;
+	}
+
+	buffer_chunk *get(){
+		buffer_chunk *c = m_free;
+		if(c){
+			m_free = c->m_next;
+			m_free_count--;
+		}else{
+			c = (buffer_chunk*)malloc(sizeof(buffer_chunk));		//空闲链表为空，才向系统申请
+			if(c == NULL){
+				return NULL;
+			}
+		}
+		c->m_next = NULL;
+		c->m_start = c->m_end = 0;
+		return c;
+	}
+
+	void put(buffer_chunk *c){
+		if(m_free_count >= MAX_FREE_CHUNKS){						//空闲块太多，直接还给系统，防止峰值过后内存一直不下降
+			free(c);
+			return;
+		}
+		c->m_next = m_free;
+		m_free = c;
+		m_free_count++;
+	}
+
+	int free_count() const { return m_free_count; }
+
+private:
+	chunk_freelist() : m_free(NULL),m_free_count(0){}
+	~chunk_freelist(){
+		while(m_free){
+			buffer_chunk *n = m_free->m_next;
+			free(m_free);
+			m_free = n;
+		}
+	}
+
+private:
+	static const int MAX_FREE_CHUNKS = 4096;						//空闲链表最多缓存的块数量（8M）
+
+	buffer_chunk *m_free;
+	int m_free_count;
+};
+
+//链式缓冲区
+class buffer_chain
+{
+public:
+	static const int MAX_READ_IOV = 8;								//一次readv最多使用的块数量，即一次最多读入16K
+
+	buffer_chain() : m_head(NULL),m_tail(NULL),m_size(0){}
+	~buffer_chain(){ clear(); }
+
+	int size() const { return m_size; }								//缓冲区中有效数据的字节数
+	bool empty() const { return m_size == 0; }
+
+	//归还所有的块，连接关闭或者重新初始化时调用
+	void clear(){
+		while(m_head){
+			buffer_chunk *n = m_head->m_next;
+			chunk_freelist::instance().put(m_head);
+			m_head = n;
+		}
+		m_tail = NULL;
+		m_size = 0;
+	}
+
+	/*
+	从fd中读取数据，返回值与recv一致：>0读取的字节数，0对方关闭，-1出错（errno为EAGAIN表示读完了）
+	第一个iovec是尾块剩余的空间，后面的iovec是从空闲链表中新取的块，没有用上的块再还回去
+	*/
+	int read_fd(int fd){
+		struct iovec iov[MAX_READ_IOV + 1];
+		buffer_chunk *fresh[MAX_READ_IOV];
+		int iovcnt = 0;
+
+		bool use_tail = m_tail && m_tail->m_end < buffer_chunk::CHUNK_SIZE;
+		if(use_tail){												//尾块还有空间，先填满尾块
+			iov[iovcnt].iov_base = m_tail->m_data + m_tail->m_end;
+			iov[iovcnt].iov_len = buffer_chunk::CHUNK_SIZE - m_tail->m_end;
+			iovcnt++;
+		}
+
+		int nfresh = 0;
+		for(;nfresh < MAX_READ_IOV;nfresh++){
+			fresh[nfresh] = chunk_freelist::instance().get();
+			if(fresh[nfresh] == NULL){
+				break;
+			}
+			iov[iovcnt].iov_base = fresh[nfresh]->m_data;
+			iov[iovcnt].iov_len = buffer_chunk::CHUNK_SIZE;
+			iovcnt++;
+		}
+
+		if(iovcnt == 0){
+			errno = ENOMEM;
+			return -1;
+		}
+
+		int ret = readv(fd,iov,iovcnt);
+		int n = ret > 0 ? ret : 0;
+
+		if(use_tail && n > 0){										//先填入尾块
+			int room = buffer_chunk::CHUNK_SIZE - m_tail->m_end;
+			int used = n < room ? n : room;
+			m_tail->m_end += used;
+			m_size += used;
+			n -= used;
+		}
+
+		for(int i = 0;i < nfresh;i++){								//再把用到的新块挂到链表尾部，没用到的还回去
+			if(n > 0){
+				int used = n < buffer_chunk::CHUNK_SIZE ? n : buffer_chunk::CHUNK_SIZE;
+				fresh[i]->m_end = used;
+				append_chunk(fresh[i]);
+				m_size += used;
+				n -= used;
+			}else{
+				chunk_freelist::instance().put(fresh[i]);
+			}
+		}
+
+		return ret;
+	}
+
+	//追加数据到尾部（用于组织响应），必要时从空闲链表中取新块
+	int append(const char *data,int len){
+		int done = 0;
+		while(done < len){
+			if(m_tail == NULL || m_tail->m_end == buffer_chunk::CHUNK_SIZE){
+				buffer_chunk *c = chunk_freelist::instance().get();
+				if(c == NULL){
+					return -1;
+				}
+				append_chunk(c);
+			}
+			int room = buffer_chunk::CHUNK_SIZE - m_tail->m_end;
+			int n = (len - done) < room ? (len - done) : room;
+			memcpy(m_tail->m_data + m_tail->m_end,data + done,n);
+			m_tail->m_end += n;
+			m_size += n;
+			done += n;
+		}
+		return done;
+	}
+
+	/*
+	使用writev把缓冲区中的数据写入fd，写出去的部分会被consume掉
+	返回值与send一致：>=0写出的字节数，-1出错（errno为EAGAIN表示内核发送缓冲区满了）
+	*/
+	int write_fd(int fd){
+		struct iovec iov[MAX_READ_IOV];
+		int iovcnt = 0;
+		for(buffer_chunk *c = m_head;c && iovcnt < MAX_READ_IOV;c = c->m_next){
+			if(c->m_end > c->m_start){
+				iov[iovcnt].iov_base = c->m_data + c->m_start;
+				iov[iovcnt].iov_len = c->m_end - c->m_start;
+				iovcnt++;
+			}
+		}
+		if(iovcnt == 0){
+			return 0;
+		}
+
+		int ret = writev(fd,iov,iovcnt);
+		if(ret > 0){
+			consume(ret);
+		}
+		return ret;
+	}
+
+	//获取逻辑位置pos处的字节（pos相对于有效数据的起始位置），跨块访问，不拷贝
+	char at(int pos) const {
+		for(buffer_chunk *c = m_head;c;c = c->m_next){
+			int len = c->m_end - c->m_start;
+			if(pos < len){
+				return c->m_data[c->m_start + pos];
+			}
+			pos -= len;
+		}
+		assert(false);
+		return 0;
+	}
+
+	/*
+	从逻辑位置from开始查找长度为len的分隔符（比如"\r\n"），分隔符可以跨越块的边界
+	返回分隔符起始的逻辑位置，没找到返回-1。调用者可以记录上次查找到的位置，下次从这里继续查找，避免重复扫描
+	*/
+	int find(const char *delim,int len,int from = 0) const {
+		int base = 0;												//当前块第一个字节的逻辑位置
+		buffer_chunk *c = m_head;
+		while(c && base + (c->m_end - c->m_start) <= from){			//跳过from之前的块
+			base += c->m_end - c->m_start;
+			c = c->m_next;
+		}
+
+		int matched = 0;											//已经匹配的分隔符长度，可以跨块延续
+		int pos = from;
+		for(;c;c = c->m_next){
+			const char *p = c->m_data + c->m_start;
+			int clen = c->m_end - c->m_start;
+			for(int i = pos - base;i < clen;i++){
+				if(matched > 0 && p[i] != delim[matched]){			//分隔符很短（首字符不在后面重复），失配时从头匹配即可
+					matched = 0;
+				}
+				if(p[i] == delim[matched]){
+					if(++matched == len){
+						return base + i - len + 1;
+					}
+				}
+			}
+			base += clen;
+			pos = base;
+		}
+		return -1;
+	}
+
+	//把逻辑位置[0,len)的数据拷贝到dst中，不会consume。只有在需要连续内存时（比如文件名传给execl）才使用
+	int copy_out(char *dst,int len) const {
+		int done = 0;
+		for(buffer_chunk *c = m_head;c && done < len;c = c->m_next){
+			int n = c->m_end - c->m_start;
+			if(n > len - done){
+				n = len - done;
+			}
+			memcpy(dst + done,c->m_data + c->m_start,n);
+			done += n;
+		}
+		return done;
+	}
+
+	//把src头部len字节的数据追加到本缓冲区并从src中消费掉，块到块直接拷贝，不需要中间缓冲（比如回显请求的负载）
+	int append_chain(buffer_chain &src,int len){
+		int done = 0;
+		for(buffer_chunk *c = src.m_head;c && done < len;c = c->m_next){
+			int n = c->m_end - c->m_start;
+			if(n > len - done){
+				n = len - done;
+			}
+			if(append(c->m_data + c->m_start,n) < 0){
+				break;
+			}
+			done += n;
+		}
+		src.consume(done);
+		return done;
+	}
+
+	//丢弃头部len字节的数据，完全消费掉的块立即归还空闲链表
+	void consume(int len){
+		assert(len <= m_size);
+		m_size -= len;
+		while(len > 0 && m_head){
+			int n = m_head->m_end - m_head->m_start;
+			if(len < n){
+				m_head->m_start += len;
+				return;
+			}
+			len -= n;
+			buffer_chunk *next = m_head->m_next;
+			chunk_freelist::instance().put(m_head);
+			m_head = next;
+		}
+		if(m_head == NULL){
+			m_tail = NULL;
+		}
+	}
+
+private:
+	void append_chunk(buffer_chunk *c){
+		c->m_next = NULL;
+		if(m_tail){
+			m_tail->m_next = c;
+		}else{
+			m_head = c;
+		}
+		m_tail = c;
+	}
+
+	buffer_chain(const buffer_chain&);								//缓冲区持有块链，不允许拷贝
+	buffer_chain& operator=(const buffer_chain&);
+
+private:
+	buffer_chunk *m_head;											//从头部消费数据
+	buffer_chunk *m_tail;											//从尾部追加数据
+	int m_size;
+};
+
+#endif
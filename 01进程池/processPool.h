@@ -16,10 +16,17 @@
 #include <sys/epoll.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <signal.h>
+#include <stdint.h>
+#include <time.h>
 
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
+
+#include "sharedCache.h"
 
 
 //用于描述一个子进程的类
@@ -28,8 +35,62 @@ class process
 public:
 	pid_t m_pid;				//m_pid是目标子进程的PID
 	int m_pipefd[2];			//m_pipefd是子进程和父进程之间通信用的管道,父进程只对fd[0]进行读写操作,子进程只对fd[1]进行读写操作
+	bool m_draining;			//子进程卡住了（心跳超时），父进程不再给它分配新连接，直到心跳恢复
+	bool m_respawn;				//子进程是因为卡住被父进程杀死的，回收之后需要重新创建
+	uint64_t m_stall_since;		//开始卡住的时间（毫秒）
+	uint64_t m_last_loops;		//上次检查时子进程事件循环的迭代次数
 public:
-	process() : m_pid(-1){}
+	process() : m_pid(-1),m_draining(false),m_respawn(false),m_stall_since(0),m_last_loops(0){}
+};
+
+/*
+子进程的心跳信息，放在父子进程共享的内存中（fork之前mmap），子进程每次事件循环迭代都会更新
+每个子进程独占一个缓存行，避免多个子进程同时写造成伪共享
+*/
+struct process_status
+{
+	volatile uint64_t m_heartbeat_ms;										//最近一次事件循环迭代的时间（CLOCK_MONOTONIC，毫秒）
+	volatile uint64_t m_loops;												//事件循环迭代次数
+	char m_pad[48];
+};
+
+//父进程统计的健康检查指标
+struct pool_health_stats
+{
+	uint64_t stall_events;													//检测到子进程卡住的次数
+	uint64_t recoveries;													//卡住之后心跳恢复的次数
+	uint64_t kills;															//卡住太久被杀死的次数
+	uint64_t respawns;														//重新创建子进程的次数
+	uint64_t rerouted;														//因为子进程卡住，新连接被分配给其他子进程的次数
+};
+
+//子进程中额外监听的描述符（比如线程池完成通知用的eventfd）的回调函数
+typedef void (*fd_callback)(int fd,void *arg);
+
+struct fd_watcher
+{
+	int fd;
+	fd_callback cb;
+	void *arg;
+};
+
+//单调时钟的毫秒数，父子进程之间可以直接比较
+static uint64_t monotonic_ms(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//UDP模式的配置：每个子进程各自创建一个SO_REUSEPORT的数据报socket，由内核按照四元组把数据报分散到各个子进程
+#define UDP_FLAG_GRO	0x01												//接收端开启UDP GRO，内核把同一个流的多个数据报合并成一个大缓冲区交上来
+#define UDP_FLAG_GSO	0x02												//发送端开启UDP GSO，发给同一个对端的相同大小的响应合并成一次发送
+
+struct udp_config
+{
+	in_addr_t addr;															//绑定地址，网络字节序
+	int port;																//绑定端口
+	int batch;																//一次recvmmsg最多接收的数据报数量
+	int flags;																//UDP_FLAG_GRO | UDP_FLAG_GSO
 };
 
 //进程池类，定义为模板类，实现代码复用
@@ -37,7 +98,7 @@ template<typename T>
 class processpool
 {
 private:
-	processpool(int listenfd,int process_number=0);							//私有，单例模式访问
+	processpool(int listenfd,int process_number=0,const udp_config *udp=NULL);	//私有，单例模式访问
 public:
 	static processpool< T >* create(int listenfd,int process_number = 8){		//饿汉模式
 		if(!m_instance){
@@ -46,42 +107,128 @@ public:
 		return m_instance;
 	}
 
+	/*
+	UDP模式：没有监听socket，也不需要父进程分发连接，子进程各自绑定同一个端口（SO_REUSEPORT）
+	模板类T需要实现：int on_datagram(const char *data,int len,const sockaddr_in& peer,char *reply,int reply_size)
+	返回值是写入reply的响应长度，小于0表示不需要响应。UDP模式的进程池使用run_udp启动
+	*/
+	static processpool< T >* create_udp(const char *ip,int port,int process_number = 8,int batch = 64,int flags = 0){
+		if(!m_instance){
+			udp_config udp;
+			udp.addr = ip ? inet_addr(ip) : htonl(INADDR_ANY);
+			udp.port = port;
+			udp.batch = (batch > 0 && batch <= MAX_UDP_BATCH) ? batch : MAX_UDP_BATCH;
+			udp.flags = flags;
+			m_instance = new processpool< T >(-1,process_number,&udp);
+		}
+		return m_instance;
+	}
+
 	~processpool(){															//析构函数，释放子进程描述信息
 		delete[] m_sub_process;  
+		munmap(m_status,sizeof(process_status) * m_process_number);
+		if(m_cache){
+			m_cache->destroy();												//子进程中只解除自己的映射
+		}
+	}
+
+	/*
+	配置所有子进程共享的缓存，必须在create之前调用（缓存在构造函数中fork之前创建）
+	capacity是总条目数，value_size是单个值的最大长度，capacity为0表示不使用共享缓存
+	*/
+	static void set_shared_cache(int capacity,int value_size,int nstripes = 16){
+		m_cache_capacity = capacity;
+		m_cache_value_size = value_size;
+		m_cache_stripes = nstripes;
+	}
+
+	shared_cache *cache(){ return m_cache; }								//没有配置时为NULL
+
+	/*
+	设置父进程的健康检查参数（在run之前调用，只有父进程使用）
+	stall_ms：子进程心跳超过这个时间没有更新，就认为卡住了，不再给它分配新连接
+	kill_ms：卡住超过这个时间就杀死并重新创建子进程，0表示不杀死
+	stats_path：定期把健康检查指标写到这个文件（Prometheus文本格式），NULL表示不输出
+	*/
+	void set_health_check(int stall_ms,int kill_ms = 0,const char *stats_path = NULL){
+		m_stall_ms = stall_ms;
+		m_kill_ms = kill_ms;
+		m_stats_path = stats_path;
 	}
 
 	void run();																//启动进程池
+	void run_udp();															//启动UDP模式的进程池，只有使用UDP模式时T才需要实现on_datagram
+
+	static processpool< T >* instance(){ return m_instance; }
+
+	/*
+	子进程中额外监听一个描述符，可读时调用cb，而不是交给users[fd].process()
+	用于T自己创建的、不属于某个客户连接的描述符，比如线程池完成任务之后通知事件循环的eventfd。只能在子进程中调用
+	*/
+	int watch_fd(int fd,fd_callback cb,void *arg);
 
 private:
 	void setup_sig_pipe();
 	void run_parent();
 	void run_child();
+	void run_child_udp();
+	bool handle_child_signals();											//子进程处理信号管道中的信号
+	void heartbeat();														//子进程每次事件循环迭代时调用，更新共享内存中的心跳
+	int select_child(int start);											//父进程选择一个可以分配新连接的子进程
+	void check_children();													//父进程检查所有子进程的心跳
+	bool respawn(int idx);													//父进程重新创建子进程，返回true表示当前是新的子进程
+	void write_stats();
+	bool dispatch_watcher(int fd);											//fd是watch_fd注册的描述符则调用回调，返回true
 
 private:
 	static const int MAX_PROCESS_NUMBER = 16;								//进程所拥有的最大子进程数量
 	static const int USER_PER_PROCESS = 65535;								//每个子进程最多可以处理的客户数量
 	static const int MAX_EVENT_NUMBER = 10000;								//epoll最多能处理的事件数量
+	static const int MAX_UDP_BATCH = 256;									//recvmmsg/sendmmsg一次最多处理的数据报数量
+	static const int MAX_WATCHERS = 8;										//子进程最多额外监听的描述符数量
+	static const int HEARTBEAT_INTERVAL_MS = 200;							//空闲时epoll_wait的超时时间，保证没有事件时也能更新心跳，父进程也按这个间隔检查
 
 	int m_process_number;													//进程池中的进程总数
 	int m_idx;																//子进程在池中的序号，从0开始
 	int m_epollfd;															//每个进程都有一个epoll内核时间表，使用m_epollfd表示
 	int m_listenfd;															//监听socket
 	int m_stop;																//结束标识符，子进程通过m_stop决定是否停止
+	udp_config m_udp;														//UDP模式的配置，TCP模式下m_udp.port为0
 
 	process *m_sub_process;													//保存所有的子进程描述信息
+	process_status *m_status;												//所有子进程的心跳，父子进程共享
+
+	int m_stall_ms;															//心跳超时时间
+	int m_kill_ms;															//卡住多久之后杀死子进程，0表示不杀死
+	const char *m_stats_path;												//健康检查指标的输出文件
+	pool_health_stats m_health;
+
+	fd_watcher m_watchers[MAX_WATCHERS];									//子进程中额外监听的描述符
+	int m_nwatchers;
+
+	shared_cache *m_cache;													//所有子进程共享的缓存，父进程创建，子进程重启之后继续使用
 
 	static processpool< T > *m_instance;										//进程池的静态实例对象
+	static int m_cache_capacity;											//set_shared_cache的配置
+	static int m_cache_value_size;
+	static int m_cache_stripes;
 };
 
 template<typename T>
 processpool< T > *processpool< T >::m_instance = NULL;
+template<typename T>
+int processpool< T >::m_cache_capacity = 0;
+template<typename T>
+int processpool< T >::m_cache_value_size = 0;
+template<typename T>
+int processpool< T >::m_cache_stripes = 16;
 
 static int sig_pipefd[2];													//用于处理信号！！！！！的管道，以实现统一事件源
 
 /*
 实现对描述符设置为非阻塞状态
 */
-static int setnonblocking(int fd){											
+static inline int setnonblocking(int fd){											
 	int old_option = fcntl(fd,F_GETFL);
 	int new_option = old_option | O_NONBLOCK;
 	fcntl(fd,F_SETFL,new_option);
@@ -91,7 +238,7 @@ static int setnonblocking(int fd){
 /*
 添加新的文件描述符fd到epollfd中，进行监听
 */
-static void addfd(int epollfd,int fd){										
+static inline void addfd(int epollfd,int fd){										
 	epoll_event event;
 	event.data.fd = fd;
 	event.events = EPOLLIN | EPOLLET;
@@ -102,11 +249,21 @@ static void addfd(int epollfd,int fd){
 /*
 对应添加，这里进行删除操作。从epollfd表示的epoll内核事件表中删除fd上的所有注册事件
 */
-static void removefd(int epollfd,int fd){
+static inline void removefd(int epollfd,int fd){
 	epoll_ctl(epollfd,EPOLL_CTL_DEL,fd,0);
 	close(fd);
 }
 
+/*
+修改fd上注册的事件，比如发送缓冲区满了之后，需要额外监听EPOLLOUT，等待可写时继续发送
+*/
+static inline void modfd(int epollfd,int fd,int ev){
+	epoll_event event;
+	event.data.fd = fd;
+	event.events = ev | EPOLLET;
+	epoll_ctl(epollfd,EPOLL_CTL_MOD,fd,&event);
+}
+
 /*
 errno 是线程安全，即每个线程有自己的 errno，但不是异步信号安全。
 如果信号处理函数比较复杂，且调用了可能会改变 errno 值的库函数，必须考虑在信号处理函数开始时保存、结束的时候恢复被中断线程的 errno 值；
@@ -159,6 +316,249 @@ static void addsig(int sig,void(handler)(int),bool restart = true){		//设置信
 	assert(sigaction(sig,&sa,NULL) != -1);
 }
 
+/*
+UDP批量收发：recvmmsg一次系统调用接收多个数据报，处理完之后sendmmsg一次系统调用发送所有响应
+每个槽位一个接收缓冲区和一个响应缓冲区，开启GRO时接收缓冲区需要64K（内核会把多个数据报合并在一个缓冲区中）
+*/
+class udp_batch
+{
+public:
+	static const int DATAGRAM_SIZE = 2048;									//不开启GRO时单个数据报的最大长度，小查询足够
+	static const int GRO_BUFFER_SIZE = 65535;								//开启GRO时，一次最多合并64K
+	static const int REPLY_SIZE = 2048;										//单个响应的最大长度
+	static const int MAX_GSO_SEGMENTS = 64;									//内核限制：一次GSO最多64个分段
+
+	udp_batch(int batch,int flags) : m_batch(batch),m_flags(flags),m_nreply(0),m_rx(0),m_tx(0),m_drop(0){
+		m_bufsize = (flags & UDP_FLAG_GRO) ? GRO_BUFFER_SIZE : DATAGRAM_SIZE;
+		m_rbuf = new char[(size_t)batch * m_bufsize];
+		m_rmsgs = new mmsghdr[batch];
+		m_riov = new iovec[batch];
+		m_rpeer = new sockaddr_in[batch];
+		m_rctrl = new char[(size_t)batch * CTRL_SIZE];
+
+		//开启GRO时，一个接收缓冲区最多拆出64个数据报，响应槽位也要对应增加
+		m_reply_cap = (flags & UDP_FLAG_GRO) ? batch * MAX_GSO_SEGMENTS : batch;
+		m_reply = new char[(size_t)m_reply_cap * REPLY_SIZE];
+		m_reply_len = new int[m_reply_cap];
+		m_reply_peer = new sockaddr_in[m_reply_cap];
+		m_smsgs = new mmsghdr[m_reply_cap];
+		m_siov = new iovec[m_reply_cap];
+		m_sctrl = new char[(size_t)m_reply_cap * CTRL_SIZE];
+	}
+
+	~udp_batch(){
+		delete[] m_rbuf;
+		delete[] m_rmsgs;
+		delete[] m_riov;
+		delete[] m_rpeer;
+		delete[] m_rctrl;
+		delete[] m_reply;
+		delete[] m_reply_len;
+		delete[] m_reply_peer;
+		delete[] m_smsgs;
+		delete[] m_siov;
+		delete[] m_sctrl;
+	}
+
+	//接收一批数据报，返回接收到的消息数量，0表示没有数据了（EAGAIN），-1表示出错
+	int recv(int fd){
+		for(int i = 0;i < m_batch;i++){										//每次都要重新设置，内核会修改msg_namelen/msg_controllen
+			m_riov[i].iov_base = m_rbuf + (size_t)i * m_bufsize;
+			m_riov[i].iov_len = m_bufsize;
+			memset(&m_rmsgs[i].msg_hdr,0,sizeof(msghdr));
+			m_rmsgs[i].msg_hdr.msg_name = &m_rpeer[i];
+			m_rmsgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			m_rmsgs[i].msg_hdr.msg_iov = &m_riov[i];
+			m_rmsgs[i].msg_hdr.msg_iovlen = 1;
+			if(m_flags & UDP_FLAG_GRO){
+				m_rmsgs[i].msg_hdr.msg_control = m_rctrl + (size_t)i * CTRL_SIZE;
+				m_rmsgs[i].msg_hdr.msg_controllen = CTRL_SIZE;
+			}
+		}
+
+		int n = recvmmsg(fd,m_rmsgs,m_batch,MSG_DONTWAIT,NULL);
+		if(n < 0){
+			return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+		}
+		return n;
+	}
+
+	/*
+	把第i个消息拆成数据报交给handler处理，响应暂存起来，等flush时一起发送
+	开启GRO时，控制消息中带有分段大小gso_size，缓冲区中是多个连续的gso_size大小的数据报（最后一个可以更短）
+	*/
+	template<typename H>
+	void dispatch(int i,H &handler){
+		mmsghdr &m = m_rmsgs[i];
+		const char *data = (const char*)m_riov[i].iov_base;
+		int total = m.msg_len;
+		if(m.msg_hdr.msg_flags & MSG_TRUNC){								//数据报超过缓冲区，丢弃
+			m_drop++;
+			return;
+		}
+
+		int seg = total;
+#ifdef UDP_GRO
+		if(m_flags & UDP_FLAG_GRO){
+			for(cmsghdr *c = CMSG_FIRSTHDR(&m.msg_hdr);c;c = CMSG_NXTHDR(&m.msg_hdr,c)){
+				if(c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO){
+					int gso_size = 0;
+					memcpy(&gso_size,CMSG_DATA(c),sizeof(int));
+					if(gso_size > 0){
+						seg = gso_size;
+					}
+				}
+			}
+		}
+#endif
+
+		for(int off = 0;off < total || (total == 0 && off == 0);off += (seg > 0 ? seg : 1)){
+			int len = (total - off) < seg ? (total - off) : seg;
+			m_rx++;
+			if(m_nreply >= m_reply_cap){
+				m_drop++;
+				continue;
+			}
+			char *reply = m_reply + (size_t)m_nreply * REPLY_SIZE;
+			int rlen = handler.on_datagram(data + off,len,m_rpeer[i],reply,REPLY_SIZE);
+			if(rlen >= 0){
+				m_reply_len[m_nreply] = rlen < REPLY_SIZE ? rlen : REPLY_SIZE;
+				m_reply_peer[m_nreply] = m_rpeer[i];
+				m_nreply++;
+			}
+			if(total == 0){
+				break;
+			}
+		}
+	}
+
+	/*
+	sendmmsg一次发送所有暂存的响应
+	开启GSO时，发给同一个对端、大小相同的连续响应合并成一个消息（最后一个可以更短），带上UDP_SEGMENT控制消息，由内核（或网卡）切分
+	有的内核定义了UDP_SEGMENT但是发送时拒绝（4.18之前返回EINVAL，网卡不支持校验和卸载时返回EIO）：
+	合并的消息发送失败时关闭GSO，从这个消息开始不合并重新发送，之后的flush也不再合并
+	*/
+	void flush(int fd){
+		int first = 0;														//第一个还没有发送的响应
+		while(first < m_nreply){
+			int nmsg = build_msgs(first);
+			int err = 0;
+			int sent = 0;
+			while(sent < nmsg){
+				int ret = sendmmsg(fd,m_smsgs + sent,nmsg - sent,MSG_DONTWAIT);
+				if(ret <= 0){
+					err = ret < 0 ? errno : 0;
+					if(err == EINTR){
+						continue;
+					}
+					break;													//发送缓冲区满了，UDP直接丢弃剩下的响应
+				}
+				sent += ret;
+			}
+			m_tx += count_segments(0,sent);
+			if(sent < nmsg && m_smsgs[sent].msg_hdr.msg_iovlen > 1 && (err == EINVAL || err == EIO)){
+				printf("UDP_SEGMENT rejected by kernel (errno %d), GSO disabled\n",err);
+				m_flags &= ~UDP_FLAG_GSO;
+				first = (int)(m_smsgs[sent].msg_hdr.msg_iov - m_siov);	//iov和响应的下标相同
+				continue;
+			}
+			m_drop += count_segments(sent,nmsg);
+			break;
+		}
+		m_nreply = 0;
+	}
+
+	long rx() const { return m_rx; }
+	long tx() const { return m_tx; }
+	long drop() const { return m_drop; }
+
+private:
+	static const int CTRL_SIZE = 64;										//控制消息缓冲区大小
+
+	//从第first个响应开始组装发送的消息，返回消息数量
+	int build_msgs(int first){
+		int nmsg = 0;
+		for(int i = first;i < m_nreply;){
+			int j = i + 1;
+#ifdef UDP_SEGMENT
+			if(m_flags & UDP_FLAG_GSO){
+				size_t bytes = m_reply_len[i];
+				while(j < m_nreply && j - i < MAX_GSO_SEGMENTS
+					&& m_reply_len[j - 1] == m_reply_len[i]					//前面的分段必须等长，最后一个可以更短
+					&& m_reply_len[j] <= m_reply_len[i] && m_reply_len[i] > 0
+					&& bytes + m_reply_len[j] <= 65000
+					&& m_reply_peer[j].sin_addr.s_addr == m_reply_peer[i].sin_addr.s_addr
+					&& m_reply_peer[j].sin_port == m_reply_peer[i].sin_port){
+					bytes += m_reply_len[j];
+					j++;
+				}
+			}
+#endif
+			for(int k = i;k < j;k++){
+				m_siov[k].iov_base = m_reply + (size_t)k * REPLY_SIZE;
+				m_siov[k].iov_len = m_reply_len[k];
+			}
+
+			msghdr &h = m_smsgs[nmsg].msg_hdr;
+			memset(&h,0,sizeof(msghdr));
+			h.msg_name = &m_reply_peer[i];
+			h.msg_namelen = sizeof(sockaddr_in);
+			h.msg_iov = &m_siov[i];
+			h.msg_iovlen = j - i;
+#ifdef UDP_SEGMENT
+			if(j - i > 1){
+				h.msg_control = m_sctrl + (size_t)nmsg * CTRL_SIZE;
+				h.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+				cmsghdr *c = CMSG_FIRSTHDR(&h);
+				c->cmsg_level = SOL_UDP;
+				c->cmsg_type = UDP_SEGMENT;
+				c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+				uint16_t gso_size = m_reply_len[i];
+				memcpy(CMSG_DATA(c),&gso_size,sizeof(gso_size));
+			}
+#endif
+			nmsg++;
+			i = j;
+		}
+		return nmsg;
+	}
+
+	long count_segments(int from,int to){									//统计[from,to)消息中的响应个数
+		long n = 0;
+		for(int i = from;i < to;i++){
+			n += m_smsgs[i].msg_hdr.msg_iovlen;
+		}
+		return n;
+	}
+
+	udp_batch(const udp_batch&);
+	udp_batch& operator=(const udp_batch&);
+
+private:
+	int m_batch;
+	int m_flags;
+	int m_bufsize;
+
+	char *m_rbuf;															//接收缓冲区
+	mmsghdr *m_rmsgs;
+	iovec *m_riov;
+	sockaddr_in *m_rpeer;
+	char *m_rctrl;
+
+	int m_reply_cap;
+	int m_nreply;															//暂存的响应数量
+	char *m_reply;															//响应缓冲区
+	int *m_reply_len;
+	sockaddr_in *m_reply_peer;
+	mmsghdr *m_smsgs;
+	iovec *m_siov;
+	char *m_sctrl;
+
+	long m_rx;																//统计：接收的数据报
+	long m_tx;																//统计：发送的响应
+	long m_drop;															//统计：丢弃的数据报/响应
+};
+
 //==============================================模板类的实现想要与头文件放在一起！！！================================================
 //另外一种方法，避免惊群问题！！！，注意查看父进程的信息
 //方法一：专门使用父进程accept接收客户端的连接，然后将连接发送给子进程处理
@@ -171,10 +571,38 @@ static void addsig(int sig,void(handler)(int),bool restart = true){		//设置信
 参数process_number是指定进程池中的子进程数量
 */
 template<typename T>
-processpool< T >::processpool(int listenfd,int process_number)
+processpool< T >::processpool(int listenfd,int process_number,const udp_config *udp)
 	:m_process_number(process_number),m_listenfd(listenfd),m_stop(false),m_idx(-1){		//注意：m_idx=-1表示为主进程
 		assert((process_number > 0) && (process_number <= MAX_PROCESS_NUMBER));
 
+		memset(&m_udp,0,sizeof(m_udp));
+		if(udp){																		//UDP模式的配置要在fork之前保存，子进程才能拿到
+			m_udp = *udp;
+		}
+
+		m_nwatchers = 0;
+		m_stall_ms = 2000;
+		m_kill_ms = 0;
+		m_stats_path = NULL;
+		memset(&m_health,0,sizeof(m_health));
+
+		//心跳区域必须在fork之前创建，MAP_SHARED的匿名映射在fork之后父子进程看到的是同一块物理内存；子进程重启之后继续使用同一个槽位
+		m_status = (process_status*)mmap(NULL,sizeof(process_status) * process_number,PROT_READ | PROT_WRITE,
+											MAP_SHARED | MAP_ANONYMOUS,-1,0);
+		assert(m_status != MAP_FAILED);
+		uint64_t now = monotonic_ms();
+		for(int i=0;i<process_number;i++){
+			m_status[i].m_heartbeat_ms = now;
+			m_status[i].m_loops = 0;
+		}
+
+		//共享缓存同样要在fork之前创建
+		m_cache = NULL;
+		if(m_cache_capacity > 0){
+			m_cache = shared_cache::create(m_cache_capacity,m_cache_value_size,m_cache_stripes);
+			assert(m_cache);
+		}
+
 		m_sub_process =new process[process_number];										//设置进程描述符个数
 		assert(m_sub_process);
 
@@ -232,6 +660,26 @@ void processpool< T >::run(){
 		return;
 	}
 	run_parent();																		//运行父进程
+	if(m_idx != -1){																	//父进程重新创建的子进程，从run_parent中返回之后开始运行子进程
+		run_child();
+	}
+}
+
+/*
+UDP模式的主运行函数：父进程只负责信号处理和回收子进程，数据报由内核通过SO_REUSEPORT直接分给各个子进程
+单独一个函数，是为了只有使用UDP模式的T才需要实现on_datagram（模板类的成员函数只有被调用时才会实例化）
+*/
+template<typename T>
+void processpool< T >::run_udp(){
+	assert(m_udp.port > 0);
+	if(m_idx != -1){
+		run_child_udp();
+		return;
+	}
+	run_parent();
+	if(m_idx != -1){
+		run_child_udp();
+	}
 }
 
 //先查看父进程，父进程将到达的客户端连接，交给子进程处理，避免了惊群现象的出现！！！
@@ -239,7 +687,9 @@ template<typename T>
 void processpool< T >::run_parent(){														//运行父进程
 	setup_sig_pipe();																	//创建epoll池，监听listenfd,将接受到的客户端描述符交给子进程进行通信。并且注册信号处理函数
 
-	addfd(m_epollfd,m_listenfd);														//添加listenfd进行监听新的客户端的到达
+	if(m_listenfd >= 0){																//UDP模式下没有监听socket
+		addfd(m_epollfd,m_listenfd);													//添加listenfd进行监听新的客户端的到达
+	}
 
 	epoll_event events[MAX_EVENT_NUMBER];
 
@@ -250,29 +700,30 @@ void processpool< T >::run_parent(){														//运行父进程
 	int number = 0;																		//标识epoll响应的事件个数
 	int ret = -1;																		//充当recv接收数据标识符
 
+	uint64_t last_check = monotonic_ms();												//上一次检查子进程心跳的时间
+
 	//开始处理
 	while(!m_stop){
-		number = epoll_wait(m_epollfd,events,MAX_EVENT_NUMBER,-1);
+		number = epoll_wait(m_epollfd,events,MAX_EVENT_NUMBER,HEARTBEAT_INTERVAL_MS);	//带超时，没有连接到达时也要定期检查子进程的心跳
 		if((number < 0) && (errno != EINTR)){											//没有事件，并且不是中断
 			printf("epoll failure!\n");
 			break;
 		}
 
+		uint64_t now = monotonic_ms();
+		if(now - last_check >= (uint64_t)HEARTBEAT_INTERVAL_MS){
+			check_children();
+			last_check = now;
+		}
+
 		//遍历事件
 		for(int i = 0;i<number;i++){
 			int sockfd = events[i].data.fd;												//获取描述符
 			if(sockfd == m_listenfd){													//有客户端打算连接，停止子进程去accept操作
-				int i = sub_process_index;												//获取应该选取的子进程索引位置
-				do
-				{
-					if(m_sub_process[i].m_pid != -1){									//!=-1表示，该子进程存在，可以处理任务
-						break;
-					}
-					i = (i + 1) % m_process_number;										//+1处理
-				}while(i != sub_process_index);											//从索引开始，去查找一圈子进程，找合适的子进程，如果无法找到合适的，就选择当前这个
+				int i = select_child(sub_process_index);								//从索引开始，去查找一圈子进程，跳过已经退出和卡住的子进程
 				
 				//下面判断是否找到了合适的索引子进程
-				if(m_sub_process[i].m_pid == -1){
+				if(i == -1){
 					m_stop = true;
 					break;																//没有子进程可用，退出算了
 				}
@@ -303,6 +754,9 @@ void processpool< T >::run_parent(){														//运行父进程
 											printf("child %d join\n", i);
 											close(m_sub_process[i].m_pipefd[0]);		//关闭与之通信的管道
 											m_sub_process[i].m_pid = -1;
+											if(m_sub_process[i].m_respawn && respawn(i)){
+												return;									//新的子进程，回到run中运行子进程的逻辑
+											}
 										}
 									}
 								}
@@ -322,6 +776,7 @@ void processpool< T >::run_parent(){														//运行父进程
 								//如果父进程接收到终止信号，那就杀死所有的子进程，并等待他们全部退出，最好使用信号，这里没有使用
 								printf("kill all the child now!\n");
 								for(int i=0;i<m_process_number;i++){
+									m_sub_process[i].m_respawn = false;					//正在退出，被杀死的子进程不再重新创建
 									int pid = m_sub_process[i].m_pid;
 									if(pid != -1){
 										kill(pid,SIGTERM);
@@ -343,6 +798,17 @@ void processpool< T >::run_parent(){														//运行父进程
 	}
 
 	//父进程退出循环，资源释放
+	write_stats();
+	printf("health: stall %llu, recover %llu, kill %llu, respawn %llu, rerouted %llu\n",
+		(unsigned long long)m_health.stall_events,(unsigned long long)m_health.recoveries,(unsigned long long)m_health.kills,
+		(unsigned long long)m_health.respawns,(unsigned long long)m_health.rerouted);
+	if(m_cache){
+		shared_cache_stats cs;
+		m_cache->stats(cs);
+		printf("cache: hits %llu, misses %llu, evictions %llu, entries %llu/%llu\n",
+			(unsigned long long)cs.hits,(unsigned long long)cs.misses,(unsigned long long)cs.evictions,
+			(unsigned long long)cs.entries,(unsigned long long)cs.capacity);
+	}
 	close(m_epollfd);
 }
 
@@ -364,7 +830,8 @@ void processpool< T >::run_child(){
 	int ret = -1;
 
 	while(!m_stop){
-		number = epoll_wait(m_epollfd,events,MAX_EVENT_NUMBER,-1);						//等待事件,其中我们是把所有监听的句柄设置为非阻塞的，所以会一直循环
+		heartbeat();																	//每次迭代都更新心跳，卡在process中时心跳就会停止
+		number = epoll_wait(m_epollfd,events,MAX_EVENT_NUMBER,HEARTBEAT_INTERVAL_MS);	//等待事件,其中我们是把所有监听的句柄设置为非阻塞的，所以会一直循环；带超时，空闲时也能更新心跳
 		if(number < 0){
 			if(errno==EINTR){
 				printf("EINTR\n");
@@ -386,52 +853,35 @@ void processpool< T >::run_child(){
 				if(((ret < 0) && (errno != EAGAIN)) || ret == 0){
 					continue;															//读取出错
 				}else{																	//开始进行处理，添加监听的描述符信息
-					struct sockaddr_in client_address;
-					socklen_t client_addrlength = sizeof(client_address);
-					int connfd = accept(m_listenfd,(struct sockaddr*)&client_address,
-												&client_addrlength);					//注意：m_listenfd是监听本地文件描述符，在创建进程池之前被实现
-
-					if(connfd < 0){
-						printf("errno is: %d\n",errno);									//连接出错
-						continue;
-					}
-
-					addfd(m_epollfd,connfd);											//添加连接的文件描述符，设置为非阻塞状态
-					//注意：模板类T必须实现init方法进行初始化客户连接。另外，我们使用数组实现直接使用connfd来索引逻辑处理对象（T）
-					users[connfd].init(m_epollfd,connfd,client_address);				//将获取的所有相关数据，传递给模板类，进行初始化
-				}
-			}
-			else if((sockfd == sig_pipefd[0]) && (events[i].events & EPOLLIN))			//有信号到达																	//下面处理子进程接收到的信号
-			{																		
-				int sig;
-				char signals[1024];
+					//父进程以边缘触发监听listenfd，同时到达的多个连接只会通知一次，所以这里要一直accept到EAGAIN，否则剩下的连接会一直留在队列中
+					while(true){
+						struct sockaddr_in client_address;
+						socklen_t client_addrlength = sizeof(client_address);
+						int connfd = accept(m_listenfd,(struct sockaddr*)&client_address,
+													&client_addrlength);				//注意：m_listenfd是监听本地文件描述符，在创建进程池之前被实现（父进程设置了非阻塞）
 
-				ret = recv(sig_pipefd[0],signals,sizeof(signals),0);					//接收多个信号,信号量原本是长整型，但是我们发送的时候转换为char类型，所以接收也同样使用char类型即可！！！
-				if(ret <= 0){
-					continue;															//没有信号到达
-				}else{
-					for(int i = 0; i < ret; i++){										//遍历所有的信号
-						switch(signals[i]){
-							case SIGCHLD:{												//SIGCHLD，在一个进程终止或者停止时，将SIGCHLD信号发送给其父进程
-								pid_t pid;
-								int stat;												//传出参数，可以设置为NULL
-								while((pid = waitpid(-1,&stat,WNOHANG))){				//-1表示任意子进程，WNOHANG表示不阻塞模式
-									continue;											//表示结束所有子进程，如果父进程接收到终止或者停止信号
-								}
-								break;
+						if(connfd < 0){
+							if(errno != EAGAIN && errno != EWOULDBLOCK){				//EAGAIN表示队列已经取空（可能被其他子进程取走了）
+								printf("errno is: %d\n",errno);							//连接出错
 							}
-							case SIGTERM:												//警告
-							case SIGINT:{												//中断
-								m_stop = true;											//可以退出循环，结束
-								break;									
-							}
-							default:
-								break;
+							break;
 						}
+
+						addfd(m_epollfd,connfd);										//添加连接的文件描述符，设置为非阻塞状态
+						//注意：模板类T必须实现init方法进行初始化客户连接。另外，我们使用数组实现直接使用connfd来索引逻辑处理对象（T）
+						users[connfd].init(m_epollfd,connfd,client_address);			//将获取的所有相关数据，传递给模板类，进行初始化
 					}
 				}
 			}
-			else if(events[i].events & EPOLLIN)											//有其他可读数据到达，客户端数据到达，需要进行处理。调用逻辑处理对象的process方法处理到达的数据
+			else if((sockfd == sig_pipefd[0]) && (events[i].events & EPOLLIN))			//有信号到达，下面处理子进程接收到的信号
+			{
+				handle_child_signals();
+			}
+			else if(dispatch_watcher(sockfd))											//T自己注册的描述符，已经调用了回调
+			{
+				continue;
+			}
+			else if(events[i].events & (EPOLLIN | EPOLLOUT))							//有其他可读数据到达，客户端数据到达，需要进行处理。调用逻辑处理对象的process方法处理到达的数据（注册了EPOLLOUT的连接，可写时也调用process继续发送）
 			{
 				users[sockfd].process();												//注意：由子进程决定调用哪一个模板类处理对应的socket数据到达！！！
 			}
@@ -450,4 +900,335 @@ void processpool< T >::run_child(){
 	//方法结束，子进程结束！！！
 }
 
+/*
+子进程处理信号管道中的信号，TCP模式和UDP模式的子进程共用
+*/
+template<typename T>
+bool processpool< T >::handle_child_signals(){
+	char signals[1024];
+
+	int ret = recv(sig_pipefd[0],signals,sizeof(signals),0);							//接收多个信号,信号量原本是长整型，但是我们发送的时候转换为char类型，所以接收也同样使用char类型即可！！！
+	if(ret <= 0){
+		return false;																	//没有信号到达
+	}
+
+	for(int i = 0; i < ret; i++){														//遍历所有的信号
+		switch(signals[i]){
+			case SIGCHLD:{																//SIGCHLD，在一个进程终止或者停止时，将SIGCHLD信号发送给其父进程
+				pid_t pid;
+				int stat;																//传出参数，可以设置为NULL
+				while((pid = waitpid(-1,&stat,WNOHANG)) > 0){							//-1表示任意子进程，WNOHANG表示不阻塞模式；没有子进程时返回-1，必须判断>0，否则死循环
+					continue;															//表示结束所有子进程，如果父进程接收到终止或者停止信号
+				}
+				break;
+			}
+			case SIGTERM:																//警告
+			case SIGINT:{																//中断
+				m_stop = true;															//可以退出循环，结束
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
+/*
+UDP模式的子进程：自己创建SO_REUSEPORT的数据报socket，recvmmsg批量接收，逐个交给T::on_datagram处理，sendmmsg批量发送响应
+*/
+template<typename T>
+void processpool< T >::run_child_udp(){
+	setup_sig_pipe();
+
+	int pipefd = m_sub_process[m_idx].m_pipefd[1];
+	addfd(m_epollfd,pipefd);
+
+	//每个子进程一个socket，绑定同一个地址和端口，内核按照四元组哈希选择socket，不需要父进程分发，也没有惊群
+	int udpfd = socket(AF_INET,SOCK_DGRAM,0);
+	assert(udpfd >= 0);
+
+	int reuse = 1;
+	setsockopt(udpfd,SOL_SOCKET,SO_REUSEADDR,&reuse,sizeof(reuse));
+	int ret = setsockopt(udpfd,SOL_SOCKET,SO_REUSEPORT,&reuse,sizeof(reuse));
+	assert(ret != -1);
+
+	int flags = m_udp.flags;
+#ifdef UDP_GRO
+	if(flags & UDP_FLAG_GRO){
+		int on = 1;
+		if(setsockopt(udpfd,SOL_UDP,UDP_GRO,&on,sizeof(on)) == -1){					//内核不支持则退回普通模式
+			printf("child %d: UDP_GRO not supported\n",m_idx);
+			flags &= ~UDP_FLAG_GRO;
+		}
+	}
+#else
+	flags &= ~UDP_FLAG_GRO;
+#endif
+#ifdef UDP_SEGMENT
+	if(flags & UDP_FLAG_GSO){
+		int gso_size = 0;															//0表示不设置默认的分段大小，只探测内核是否支持
+		if(setsockopt(udpfd,SOL_UDP,UDP_SEGMENT,&gso_size,sizeof(gso_size)) == -1){
+			printf("child %d: UDP_SEGMENT not supported\n",m_idx);
+			flags &= ~UDP_FLAG_GSO;
+		}
+	}
+#else
+	flags &= ~UDP_FLAG_GSO;
+#endif
+
+	struct sockaddr_in address;
+	bzero(&address,sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = m_udp.addr;
+	address.sin_port = htons(m_udp.port);
+	ret = bind(udpfd,(struct sockaddr*)&address,sizeof(address));
+	assert(ret != -1);
+
+	addfd(m_epollfd,udpfd);
+
+	T *handler = new T;																	//UDP没有连接，每个子进程一个处理对象
+	udp_batch *batch = new udp_batch(m_udp.batch,flags);
+
+	epoll_event events[MAX_EVENT_NUMBER];
+	int number = 0;
+
+	while(!m_stop){
+		heartbeat();
+		number = epoll_wait(m_epollfd,events,MAX_EVENT_NUMBER,HEARTBEAT_INTERVAL_MS);
+		if(number < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			printf("epoll failure\n");
+			break;
+		}
+
+		for(int i = 0;i < number;i++){
+			int sockfd = events[i].data.fd;
+
+			if((sockfd == udpfd) && (events[i].events & EPOLLIN)){
+				//边缘触发：一直接收到没有数据为止。每接收一批就处理一批、发送一批，响应不会积压
+				while(true){
+					int n = batch->recv(udpfd);
+					if(n <= 0){
+						break;
+					}
+					for(int k = 0;k < n;k++){
+						batch->dispatch(k,*handler);
+					}
+					batch->flush(udpfd);
+					if(n < m_udp.batch){											//没有收满，说明内核中已经没有数据了
+						break;
+					}
+				}
+			}
+			else if((sockfd == sig_pipefd[0]) && (events[i].events & EPOLLIN))
+			{
+				handle_child_signals();
+			}
+		}
+	}
+
+	printf("child %d: rx %ld, tx %ld, drop %ld\n",m_idx,batch->rx(),batch->tx(),batch->drop());
+
+	delete batch;
+	delete handler;
+	close(udpfd);
+	close(pipefd);
+	close(m_epollfd);
+}
+
+template<typename T>
+void processpool< T >::heartbeat(){
+	process_status &st = m_status[m_idx];
+	st.m_heartbeat_ms = monotonic_ms();
+	st.m_loops = st.m_loops + 1;														//只有本子进程写，不需要原子操作
+}
+
+/*
+从start开始查找一圈，优先选择存活并且没有卡住的子进程
+如果所有存活的子进程都卡住了，仍然选择一个存活的（总比丢掉连接好），都退出了返回-1
+*/
+template<typename T>
+int processpool< T >::select_child(int start){
+	int fallback = -1;																	//第一个存活但是卡住的子进程
+	int i = start;
+	do
+	{
+		if(m_sub_process[i].m_pid != -1){												//!=-1表示，该子进程存在，可以处理任务
+			if(!m_sub_process[i].m_draining){
+				if(fallback != -1){														//轮到的子进程卡住了，连接改派给了这个子进程
+					m_health.rerouted++;
+				}
+				return i;
+			}
+			if(fallback == -1){
+				fallback = i;
+			}
+		}
+		i = (i + 1) % m_process_number;
+	}while(i != start);
+	return fallback;
+}
+
+/*
+检查所有子进程的心跳：
+1.心跳超过m_stall_ms没有更新，标记为draining，之后select_child会跳过它
+2.draining的子进程心跳恢复了（事件循环又开始迭代），重新参与分配
+3.卡住超过m_kill_ms，杀死子进程，SIGCHLD回收之后重新创建
+*/
+template<typename T>
+void processpool< T >::check_children(){
+	uint64_t now = monotonic_ms();
+	for(int i=0;i<m_process_number;i++){
+		process &p = m_sub_process[i];
+		if(p.m_pid == -1){
+			continue;
+		}
+
+		uint64_t beat = m_status[i].m_heartbeat_ms;
+		uint64_t loops = m_status[i].m_loops;
+		bool stalled = (now > beat) && (now - beat >= (uint64_t)m_stall_ms);
+
+		if(stalled && !p.m_draining){
+			p.m_draining = true;
+			p.m_stall_since = beat;
+			m_health.stall_events++;
+			printf("child %d stalled for %llums, stop sending new connections\n",i,(unsigned long long)(now - beat));
+		}
+		else if(!stalled && p.m_draining && loops != p.m_last_loops){
+			p.m_draining = false;
+			m_health.recoveries++;
+			printf("child %d recovered\n",i);
+		}
+
+		if(p.m_draining && m_kill_ms > 0 && !p.m_respawn && now - p.m_stall_since >= (uint64_t)m_kill_ms){
+			printf("child %d stalled too long, kill it\n",i);
+			p.m_respawn = true;
+			m_health.kills++;
+			kill(p.m_pid,SIGKILL);
+		}
+		p.m_last_loops = loops;
+	}
+	write_stats();
+}
+
+/*
+重新创建第idx个子进程，与构造函数中创建子进程的过程一样
+新的子进程需要关闭从父进程继承的、属于父进程的描述符，然后返回true，由run进入子进程的逻辑
+*/
+template<typename T>
+bool processpool< T >::respawn(int idx){
+	process &p = m_sub_process[idx];
+	p.m_respawn = false;
+	p.m_draining = false;
+	p.m_last_loops = 0;
+	m_status[idx].m_heartbeat_ms = monotonic_ms();										//新的子进程还没有开始迭代，先给它一个心跳
+	m_status[idx].m_loops = 0;
+
+	if(socketpair(PF_UNIX,SOCK_STREAM,0,p.m_pipefd) == -1){
+		return false;
+	}
+
+	fflush(stdout);																		//stdout重定向到文件时是全缓冲，不刷新的话子进程会把缓冲区中的内容再输出一遍
+	pid_t pid = fork();
+	if(pid < 0){
+		close(p.m_pipefd[0]);
+		close(p.m_pipefd[1]);
+		return false;
+	}
+	if(pid > 0){																		//父进程
+		close(p.m_pipefd[1]);
+		p.m_pid = pid;
+		m_health.respawns++;
+		printf("child %d respawned, pid %d\n",idx,pid);
+		return false;
+	}
+
+	//新的子进程：关闭父进程的epoll、信号管道以及与其他子进程通信的管道，run_child中会重新创建epoll和信号管道
+	close(p.m_pipefd[0]);
+	close(m_epollfd);
+	close(sig_pipefd[0]);
+	close(sig_pipefd[1]);
+	for(int i=0;i<m_process_number;i++){
+		if(i != idx && m_sub_process[i].m_pid != -1){
+			close(m_sub_process[i].m_pipefd[0]);
+		}
+	}
+	m_idx = idx;
+	m_stop = false;
+	return true;
+}
+
+//把健康检查指标以Prometheus文本格式写到文件中，先写临时文件再rename，读取方不会看到写了一半的文件
+template<typename T>
+void processpool< T >::write_stats(){
+	if(m_stats_path == NULL){
+		return;
+	}
+
+	char tmp[1024];
+	snprintf(tmp,sizeof(tmp),"%s.tmp",m_stats_path);
+	FILE *fp = fopen(tmp,"w");
+	if(fp == NULL){
+		return;
+	}
+
+	fprintf(fp,"processpool_stall_events_total %llu\n",(unsigned long long)m_health.stall_events);
+	fprintf(fp,"processpool_recoveries_total %llu\n",(unsigned long long)m_health.recoveries);
+	fprintf(fp,"processpool_kills_total %llu\n",(unsigned long long)m_health.kills);
+	fprintf(fp,"processpool_respawns_total %llu\n",(unsigned long long)m_health.respawns);
+	fprintf(fp,"processpool_rerouted_total %llu\n",(unsigned long long)m_health.rerouted);
+
+	uint64_t now = monotonic_ms();
+	for(int i=0;i<m_process_number;i++){
+		uint64_t beat = m_status[i].m_heartbeat_ms;
+		fprintf(fp,"processpool_child_alive{child=\"%d\"} %d\n",i,m_sub_process[i].m_pid != -1);
+		fprintf(fp,"processpool_child_draining{child=\"%d\"} %d\n",i,m_sub_process[i].m_draining);
+		fprintf(fp,"processpool_child_heartbeat_age_ms{child=\"%d\"} %llu\n",i,(unsigned long long)(now > beat ? now - beat : 0));
+		fprintf(fp,"processpool_child_loops_total{child=\"%d\"} %llu\n",i,(unsigned long long)m_status[i].m_loops);
+	}
+
+	if(m_cache){
+		shared_cache_stats cs;
+		m_cache->stats(cs);
+		fprintf(fp,"processpool_cache_hits_total %llu\n",(unsigned long long)cs.hits);
+		fprintf(fp,"processpool_cache_misses_total %llu\n",(unsigned long long)cs.misses);
+		fprintf(fp,"processpool_cache_hit_ratio %.4f\n",cs.hits + cs.misses ? (double)cs.hits / (cs.hits + cs.misses) : 0.0);
+		fprintf(fp,"processpool_cache_inserts_total %llu\n",(unsigned long long)cs.inserts);
+		fprintf(fp,"processpool_cache_updates_total %llu\n",(unsigned long long)cs.updates);
+		fprintf(fp,"processpool_cache_evictions_total %llu\n",(unsigned long long)cs.evictions);
+		fprintf(fp,"processpool_cache_recovered_stripes_total %llu\n",(unsigned long long)cs.recovered);
+		fprintf(fp,"processpool_cache_entries %llu\n",(unsigned long long)cs.entries);
+		fprintf(fp,"processpool_cache_capacity %llu\n",(unsigned long long)cs.capacity);
+	}
+	fclose(fp);
+	rename(tmp,m_stats_path);
+}
+
+template<typename T>
+int processpool< T >::watch_fd(int fd,fd_callback cb,void *arg){
+	if(m_idx == -1 || m_nwatchers >= MAX_WATCHERS){
+		return -1;
+	}
+	m_watchers[m_nwatchers].fd = fd;
+	m_watchers[m_nwatchers].cb = cb;
+	m_watchers[m_nwatchers].arg = arg;
+	m_nwatchers++;
+	addfd(m_epollfd,fd);
+	return 0;
+}
+
+template<typename T>
+bool processpool< T >::dispatch_watcher(int fd){
+	for(int i=0;i<m_nwatchers;i++){													//数量很少，直接遍历
+		if(m_watchers[i].fd == fd){
+			m_watchers[i].cb(fd,m_watchers[i].arg);
+			return true;
+		}
+	}
+	return false;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,391 @@
+#ifndef __SHAREDCACHE_H
+#define __SHAREDCACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+
+/*
+进程池中所有子进程共享的缓存：固定容量的哈希表，放在fork之前创建的MAP_SHARED匿名映射中
+1.每个子进程是独立的进程，普通的缓存会在每个子进程中各存一份、各自预热一遍；放在共享内存中只需要预热一次
+2.整个表按key的哈希值分成若干个分段（stripe），每个分段一把锁、一组桶、一组固定数量的条目，不同分段之间互不影响
+3.锁是进程间共享的健壮锁（PTHREAD_MUTEX_ROBUST）：持有锁的子进程被杀死之后，下一个加锁的进程会得到EOWNERDEAD，
+  此时分段中的数据可能只改了一半，直接清空这个分段再标记锁一致，缓存丢了可以重新加载，但不能读到损坏的数据
+4.淘汰策略是CLOCK：命中时设置引用位，分段满了之后时钟指针扫描条目，清除引用位，淘汰第一个引用位为0的条目
+5.共享内存属于父进程，子进程被重启之后继承同一块映射，缓存仍然是热的
+
+条目在共享内存中不能保存指针（各进程映射的地址虽然相同，但用下标更安全），桶和链表都使用分段内的下标
+*/
+
+#define SC_MAX_KEY			64												//key的最大长度
+#define SC_MAGIC			0x53434348										//"SCCH"
+
+//缓存统计，所有分段累加
+struct shared_cache_stats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;														//新插入的条目
+	uint64_t updates;														//覆盖已有key的写入
+	uint64_t evictions;														//CLOCK淘汰的条目
+	uint64_t recovered;														//持有锁的进程死亡之后被清空的分段次数
+	uint64_t entries;														//当前条目数
+	uint64_t capacity;
+};
+
+//一个分段，独占缓存行开头，避免不同分段的锁和计数器伪共享
+struct sc_stripe
+{
+	pthread_mutex_t lock;
+	int hand;																//CLOCK指针
+	int used;																//已经使用的条目数
+	int free_head;															//空闲条目链表
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t updates;
+	uint64_t evictions;
+	uint64_t recovered;
+} __attribute__((aligned(64)));
+
+//一个条目，后面紧跟value_size字节的值
+struct sc_entry
+{
+	uint64_t hash;
+	int next;																//桶链表（已使用）或者空闲链表（未使用）中的下一个条目，-1表示结束
+	uint16_t klen;
+	uint8_t used;
+	uint8_t ref;															//CLOCK引用位
+	uint32_t vlen;
+	char key[SC_MAX_KEY];
+	char value[0];
+};
+
+//共享内存的开头
+struct sc_header
+{
+	uint32_t magic;
+	int nstripes;
+	int per_stripe;															//每个分段的条目数
+	int nbuckets;															//每个分段的桶数
+	int value_size;
+	size_t entry_stride;													//一个条目（包括值）占用的字节数，按8字节对齐
+	size_t region_size;
+};
+
+class shared_cache
+{
+public:
+	/*
+	创建缓存：capacity是总条目数，value_size是单个值的最大长度，nstripes是分段数
+	必须在fork之前调用，返回NULL表示失败
+	*/
+	static shared_cache *create(int capacity,int value_size,int nstripes = 16){
+		if(capacity <= 0 || value_size <= 0 || nstripes <= 0){
+			return NULL;
+		}
+		if(capacity < nstripes){
+			nstripes = capacity;
+		}
+		int per_stripe = (capacity + nstripes - 1) / nstripes;
+		int nbuckets = 1;
+		while(nbuckets < per_stripe){										//桶数取不小于条目数的2的幂，链表平均长度不超过1
+			nbuckets <<= 1;
+		}
+		size_t stride = (sizeof(sc_entry) + value_size + 7) & ~(size_t)7;
+
+		size_t stripes_off = (sizeof(sc_header) + 63) & ~(size_t)63;
+		size_t buckets_off = stripes_off + sizeof(sc_stripe) * nstripes;
+		size_t entries_off = (buckets_off + sizeof(int) * nbuckets * nstripes + 63) & ~(size_t)63;
+		size_t size = entries_off + stride * per_stripe * nstripes;
+
+		void *base = mmap(NULL,size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_ANONYMOUS,-1,0);
+		if(base == MAP_FAILED){
+			return NULL;
+		}
+
+		sc_header *h = (sc_header*)base;
+		h->magic = SC_MAGIC;
+		h->nstripes = nstripes;
+		h->per_stripe = per_stripe;
+		h->nbuckets = nbuckets;
+		h->value_size = value_size;
+		h->entry_stride = stride;
+		h->region_size = size;
+
+		shared_cache *c = new shared_cache(base,stripes_off,buckets_off,entries_off);
+
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_setpshared(&attr,PTHREAD_PROCESS_SHARED);			//锁在共享内存中，多个进程使用
+		pthread_mutexattr_setrobust(&attr,PTHREAD_MUTEX_ROBUST);				//持有者死亡之后不会永远锁住
+		for(int s=0;s<nstripes;s++){
+			sc_stripe *st = c->stripe(s);
+			pthread_mutex_init(&st->lock,&attr);
+			c->reset_stripe(s);
+		}
+		pthread_mutexattr_destroy(&attr);
+		return c;
+	}
+
+	//解除本进程的映射并释放对象：父进程和delete进程池的子进程都会调用，共享内存在最后一个进程解除映射之后才释放，不影响其他进程
+	void destroy(){
+		munmap(m_base,m_header->region_size);
+		delete this;
+	}
+
+	int value_size() const { return m_header->value_size; }
+
+	/*
+	查找key，命中时把值拷贝到value（最多value_cap字节），*vlen是值的实际长度
+	命中返回true；值比value_cap长时也返回true，只拷贝前value_cap字节，调用者通过*vlen判断
+	*/
+	bool get(const char *key,int klen,void *value,int value_cap,int *vlen){
+		if(klen <= 0 || klen > SC_MAX_KEY){
+			return false;
+		}
+		uint64_t hash = hash_key(key,klen);
+		int s = stripe_of(hash);
+		sc_stripe *st = stripe(s);
+		if(!lock(s)){
+			return false;													//锁不可用，按未命中处理
+		}
+
+		int idx = find(s,hash,key,klen,NULL);
+		if(idx == -1){
+			st->misses++;
+			pthread_mutex_unlock(&st->lock);
+			return false;
+		}
+
+		sc_entry *e = entry(s,idx);
+		e->ref = 1;
+		int len = (int)e->vlen;
+		memcpy(value,e->value,len < value_cap ? len : value_cap);
+		if(vlen){
+			*vlen = len;
+		}
+		st->hits++;
+		pthread_mutex_unlock(&st->lock);
+		return true;
+	}
+
+	//写入key，已经存在则覆盖；分段满了则按CLOCK淘汰一个条目。值太长、key不合法或者分段的锁不可用返回false
+	bool put(const char *key,int klen,const void *value,int vlen){
+		if(klen <= 0 || klen > SC_MAX_KEY || vlen < 0 || vlen > m_header->value_size){
+			return false;
+		}
+		uint64_t hash = hash_key(key,klen);
+		int s = stripe_of(hash);
+		sc_stripe *st = stripe(s);
+		if(!lock(s)){
+			return false;
+		}
+
+		int idx = find(s,hash,key,klen,NULL);
+		if(idx != -1){
+			st->updates++;
+		}else{
+			idx = alloc_entry(s);
+			sc_entry *e = entry(s,idx);
+			e->hash = hash;
+			e->klen = klen;
+			memcpy(e->key,key,klen);
+			e->used = 1;
+			int *b = bucket(s,hash);										//头插到桶链表
+			e->next = *b;
+			*b = idx;
+			st->used++;
+			st->inserts++;
+		}
+
+		sc_entry *e = entry(s,idx);
+		e->ref = 1;
+		e->vlen = vlen;
+		memcpy(e->value,value,vlen);
+		pthread_mutex_unlock(&st->lock);
+		return true;
+	}
+
+	//删除key，存在返回true
+	bool erase(const char *key,int klen){
+		if(klen <= 0 || klen > SC_MAX_KEY){
+			return false;
+		}
+		uint64_t hash = hash_key(key,klen);
+		int s = stripe_of(hash);
+		sc_stripe *st = stripe(s);
+		if(!lock(s)){
+			return false;
+		}
+
+		int prev = -1;
+		int idx = find(s,hash,key,klen,&prev);
+		if(idx != -1){
+			unlink_entry(s,idx,prev);
+		}
+		pthread_mutex_unlock(&st->lock);
+		return idx != -1;
+	}
+
+	//汇总所有分段的统计，逐个分段加锁，每个分段的数据是一致的
+	void stats(shared_cache_stats &out){
+		memset(&out,0,sizeof(out));
+		for(int s=0;s<m_header->nstripes;s++){
+			sc_stripe *st = stripe(s);
+			if(!lock(s)){
+				continue;													//跳过不可用的分段
+			}
+			out.hits += st->hits;
+			out.misses += st->misses;
+			out.inserts += st->inserts;
+			out.updates += st->updates;
+			out.evictions += st->evictions;
+			out.recovered += st->recovered;
+			out.entries += st->used;
+			pthread_mutex_unlock(&st->lock);
+		}
+		out.capacity = (uint64_t)m_header->per_stripe * m_header->nstripes;
+	}
+
+private:
+	shared_cache(void *base,size_t stripes_off,size_t buckets_off,size_t entries_off)
+		: m_base((char*)base),m_header((sc_header*)base),
+		  m_stripes((sc_stripe*)((char*)base + stripes_off)),
+		  m_buckets((int*)((char*)base + buckets_off)),
+		  m_entries((char*)base + entries_off){}
+	shared_cache(const shared_cache&);
+	shared_cache& operator=(const shared_cache&);
+
+	//FNV-1a，最后用murmur3的fmix64打散：短key的FNV结果高位分布很差，直接用来选分段会让部分分段空着
+	static uint64_t hash_key(const char *key,int klen){
+		uint64_t h = 14695981039346656037ULL;
+		for(int i=0;i<klen;i++){
+			h ^= (unsigned char)key[i];
+			h *= 1099511628211ULL;
+		}
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	//高位选分段，低位选桶，两者互不相关
+	int stripe_of(uint64_t hash) const { return (int)((hash >> 32) % m_header->nstripes); }
+	sc_stripe *stripe(int s){ return &m_stripes[s]; }
+	int *bucket(int s,uint64_t hash){ return &m_buckets[s * m_header->nbuckets + (hash & (m_header->nbuckets - 1))]; }
+	sc_entry *entry(int s,int idx){
+		return (sc_entry*)(m_entries + ((size_t)s * m_header->per_stripe + idx) * m_header->entry_stride);
+	}
+
+	/*
+	加锁；上一个持有者在临界区中死亡时，分段可能是不一致的，清空之后恢复锁的一致性
+	其他错误（比如ENOTRECOVERABLE）返回false，此时没有持有锁，调用者不能访问分段，也不能解锁
+	*/
+	bool lock(int s){
+		sc_stripe *st = stripe(s);
+		int ret = pthread_mutex_lock(&st->lock);
+		if(ret == EOWNERDEAD){
+			uint64_t recovered = st->recovered;
+			reset_stripe(s);
+			st->recovered = recovered + 1;
+			pthread_mutex_consistent(&st->lock);
+		}else if(ret != 0){
+			return false;
+		}
+		return true;
+	}
+
+	//清空分段：所有桶置空，所有条目放回空闲链表，统计清零（锁保留）
+	void reset_stripe(int s){
+		sc_stripe *st = stripe(s);
+		st->hand = 0;
+		st->used = 0;
+		st->hits = st->misses = st->inserts = st->updates = st->evictions = st->recovered = 0;
+		int *b = &m_buckets[s * m_header->nbuckets];
+		for(int i=0;i<m_header->nbuckets;i++){
+			b[i] = -1;
+		}
+		for(int i=0;i<m_header->per_stripe;i++){
+			sc_entry *e = entry(s,i);
+			e->used = 0;
+			e->ref = 0;
+			e->next = (i + 1 < m_header->per_stripe) ? i + 1 : -1;
+		}
+		st->free_head = 0;
+	}
+
+	//在分段s中查找key，返回条目下标，prev返回桶链表中的前一个条目
+	int find(int s,uint64_t hash,const char *key,int klen,int *prev){
+		int p = -1;
+		for(int idx = *bucket(s,hash);idx != -1;){
+			sc_entry *e = entry(s,idx);
+			if(e->hash == hash && e->klen == klen && memcmp(e->key,key,klen) == 0){
+				if(prev){
+					*prev = p;
+				}
+				return idx;
+			}
+			p = idx;
+			idx = e->next;
+		}
+		return -1;
+	}
+
+	//从桶链表中摘下条目，放回空闲链表
+	void unlink_entry(int s,int idx,int prev){
+		sc_stripe *st = stripe(s);
+		sc_entry *e = entry(s,idx);
+		if(prev == -1){
+			*bucket(s,e->hash) = e->next;
+		}else{
+			entry(s,prev)->next = e->next;
+		}
+		e->used = 0;
+		e->ref = 0;
+		e->next = st->free_head;
+		st->free_head = idx;
+		st->used--;
+	}
+
+	//取一个空闲条目，没有则用CLOCK淘汰一个
+	int alloc_entry(int s){
+		sc_stripe *st = stripe(s);
+		if(st->free_head == -1){
+			while(true){													//最多转两圈：第一圈清除所有引用位，第二圈一定能找到
+				sc_entry *e = entry(s,st->hand);
+				int idx = st->hand;
+				st->hand = (st->hand + 1) % m_header->per_stripe;
+				if(e->ref){
+					e->ref = 0;
+					continue;
+				}
+				int prev = -1;
+				find(s,e->hash,e->key,e->klen,&prev);
+				unlink_entry(s,idx,prev);
+				st->evictions++;
+				break;
+			}
+		}
+		int idx = st->free_head;
+		st->free_head = entry(s,idx)->next;
+		return idx;
+	}
+
+private:
+	char *m_base;
+	sc_header *m_header;
+	sc_stripe *m_stripes;
+	int *m_buckets;
+	char *m_entries;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <vector>
+
+#include "binaryClient.h"
+
+using namespace std;
+
+/*
+二进制协议客户端
+交互模式：./testBinClient ip port                   输入文件路径，批量发送STAT和ECHO两个请求
+压测模式：./testBinClient ip port -l conns batch seconds [payload]
+          conns个连接（每个连接一个线程），每次批量发送batch个请求，收齐响应之后再发下一批，持续seconds秒
+          batch=1就相当于一问一答，对比batch=100/500可以看出批量对系统调用的摊薄效果
+*/
+
+struct load_arg
+{
+	const char *ip;
+	int port;
+	int batch;
+	int payload;
+	double seconds;
+
+	long requests;															//输出：完成的请求数
+	long batches;															//输出：完成的批次数
+	int error;
+};
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *load_thread(void *argv){
+	load_arg *arg = (load_arg*)argv;
+	bin_client client;
+	if(client.connect_to(arg->ip,arg->port) < 0){
+		arg->error = errno;
+		return NULL;
+	}
+
+	vector<char> payload(arg->payload,'x');
+	uint16_t opcode = arg->payload > 0 ? BIN_OP_ECHO : BIN_OP_NOOP;
+	vector<bin_request> reqs(arg->batch);
+	vector<bin_response> rsps(arg->batch);
+	for(int i = 0;i < arg->batch;i++){
+		reqs[i].opcode = opcode;
+		reqs[i].payload = payload.empty() ? NULL : &payload[0];
+		reqs[i].length = arg->payload;
+	}
+
+	double deadline = now_sec() + arg->seconds;
+	while(now_sec() < deadline){
+		if(client.call_batch(&reqs[0],arg->batch,&rsps[0]) < 0){
+			arg->error = errno ? errno : EPROTO;
+			break;
+		}
+		arg->requests += arg->batch;
+		arg->batches++;
+	}
+	return NULL;
+}
+
+static int run_load(const char *ip,int port,int conns,int batch,double seconds,int payload){
+	vector<pthread_t> tids(conns);
+	vector<load_arg> args(conns);
+
+	for(int i = 0;i < conns;i++){
+		memset(&args[i],0,sizeof(load_arg));
+		args[i].ip = ip;
+		args[i].port = port;
+		args[i].batch = batch;
+		args[i].payload = payload;
+		args[i].seconds = seconds;
+	}
+
+	double start = now_sec();
+	for(int i = 0;i < conns;i++){
+		pthread_create(&tids[i],NULL,load_thread,&args[i]);
+	}
+
+	long requests = 0,batches = 0;
+	for(int i = 0;i < conns;i++){
+		pthread_join(tids[i],NULL);
+		requests += args[i].requests;
+		batches += args[i].batches;
+		if(args[i].error){
+			printf("conn %d error: %s\n",i,strerror(args[i].error));
+		}
+	}
+	double spend = now_sec() - start;
+
+	printf("conns:%d batch:%d payload:%d seconds:%.2f\n",conns,batch,payload,spend);
+	printf("requests:%ld (%.0f req/s), batches:%ld (%.0f round trips/s)\n",
+		requests,requests / spend,batches,batches / spend);
+	return 0;
+}
+
+int main(int argc,char** argv)
+{
+	if(argc < 3)
+	{
+		cout<<"Input error! Usage should be : "<<argv[0]<<"  xxx.xxx.xxx.xxx(ip)  1234(port) [-l conns batch seconds [payload]]"<<endl;
+		return 0;
+	}
+
+	const char *ip = argv[1];
+	int port = atoi(argv[2]);
+
+	if(argc >= 7 && strcmp(argv[3],"-l") == 0){							//压测模式
+		int payload = argc > 7 ? atoi(argv[7]) : 0;
+		return run_load(ip,port,atoi(argv[4]),atoi(argv[5]),atof(argv[6]),payload);
+	}
+
+	bin_client client;
+	if(client.connect_to(ip,port) < 0){
+		cout<<"connet failed : "<<strerror(errno)<<endl;
+		return 0;
+	}
+	cout<<"connect success !"<<endl;
+
+	//一个连接可以发送多批请求，每批在一个数据包中
+	char path[1024];
+	while(true){
+		cout<<"(Client)send filename: ";
+		if(!(cin >> path)){
+			break;
+		}
+
+		bin_request reqs[2];
+		reqs[0].opcode = BIN_OP_STAT;
+		reqs[0].payload = path;
+		reqs[0].length = strlen(path);
+		reqs[1].opcode = BIN_OP_ECHO;
+		reqs[1].payload = path;
+		reqs[1].length = strlen(path);
+
+		bin_response rsps[2];
+		if(client.call_batch(reqs,2,rsps) < 0){
+			cout<<"call failed"<<endl;
+			break;
+		}
+
+		if(rsps[0].status == BIN_STATUS_OK && rsps[0].payload.size() == 8){
+			uint32_t size[2];
+			memcpy(size,&rsps[0].payload[0],8);
+			cout<<"Server return: size "<<(((uint64_t)ntohl(size[0]) << 32) | ntohl(size[1]));
+		}else{
+			cout<<"Server return: status "<<rsps[0].status;
+		}
+		cout<<", echo "<<string(rsps[1].payload.begin(),rsps[1].payload.end())<<endl;
+	}
+
+	client.close_conn();
+	return 0;
+}
+
+//g++ ./testBinClient.cpp -o testBinClient -lpthread
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "processPool.h"
+#include "bufferChain.h"
+#include "binaryProtocol.h"
+
+/*
+二进制协议的处理类，用于测试processpool的模板类
+与cgi_conn不同：连接不会在一个请求之后关闭，一次读入的数据中可能包含多个请求，全部处理完之后一次writev写回所有响应
+*/
+class bin_conn{
+public:
+	bin_conn(){}
+	~bin_conn(){}
+public:
+	void init(int epollfd,int sockfd,const sockaddr_in& client_addr);
+	void process();
+private:
+	bool parse_requests();													//解析输入缓冲区中所有完整的请求，响应追加到输出缓冲区
+	void handle_request(const bin_header &req);
+	void add_response(const bin_header &req,uint16_t status,const char *payload,uint32_t len);
+	bool flush();															//发送输出缓冲区，返回false表示连接出错
+	void close_conn();
+private:
+	static const int MAX_PENDING_OUTPUT = 4 * 1024 * 1024;					//输出缓冲区积压上限，客户端只发不收时停止读取
+	static int m_epollfd;
+
+	int m_sockfd;
+	sockaddr_in m_address;
+
+	buffer_chain m_in;														//输入缓冲区
+	buffer_chain m_out;														//输出缓冲区，同一批请求的响应攒在一起发送
+	bool m_want_write;														//是否注册了EPOLLOUT
+};
+
+int bin_conn::m_epollfd = -1;
+
+void bin_conn::init(int epollfd,int sockfd,const sockaddr_in& client_addr){
+	m_epollfd = epollfd;
+	m_sockfd = sockfd;
+	m_address = client_addr;
+	m_in.clear();
+	m_out.clear();
+	m_want_write = false;
+}
+
+void bin_conn::close_conn(){
+	removefd(m_epollfd,m_sockfd);
+	m_in.clear();
+	m_out.clear();
+	m_want_write = false;
+}
+
+void bin_conn::add_response(const bin_header &req,uint16_t status,const char *payload,uint32_t len){
+	bin_header rsp;
+	rsp.length = len;
+	rsp.request_id = req.request_id;										//响应带回请求的id，客户端据此匹配
+	rsp.opcode = req.opcode;
+	rsp.status = status;
+
+	char head[BIN_HEADER_LEN];
+	bin_encode_header(head,rsp);
+	m_out.append(head,BIN_HEADER_LEN);
+	if(len > 0){
+		m_out.append(payload,len);
+	}
+}
+
+//调用时包头已经被消费，m_in头部就是req.length字节的负载
+void bin_conn::handle_request(const bin_header &req){
+	switch(req.opcode){
+		case BIN_OP_NOOP:
+		{
+			m_in.consume(req.length);
+			add_response(req,BIN_STATUS_OK,NULL,0);
+			break;
+		}
+		case BIN_OP_ECHO:
+		{
+			bin_header rsp = req;
+			rsp.status = BIN_STATUS_OK;
+			char head[BIN_HEADER_LEN];
+			bin_encode_header(head,rsp);
+			m_out.append(head,BIN_HEADER_LEN);
+			m_out.append_chain(m_in,req.length);							//负载从输入块直接拷贝到输出块
+			break;
+		}
+		case BIN_OP_STAT:
+		{
+			char path[PATH_MAX];
+			if(req.length == 0 || req.length >= PATH_MAX){
+				m_in.consume(req.length);
+				add_response(req,BIN_STATUS_BAD_REQUEST,NULL,0);
+				break;
+			}
+			m_in.copy_out(path,req.length);
+			path[req.length] = '\0';
+			m_in.consume(req.length);
+
+			struct stat st;
+			if(stat(path,&st) == -1){
+				add_response(req,BIN_STATUS_NOT_FOUND,NULL,0);
+				break;
+			}
+			uint32_t size[2];												//8字节文件大小，网络字节序，高位在前
+			size[0] = htonl((uint32_t)((uint64_t)st.st_size >> 32));
+			size[1] = htonl((uint32_t)st.st_size);
+			add_response(req,BIN_STATUS_OK,(const char*)size,sizeof(size));
+			break;
+		}
+		default:
+		{
+			m_in.consume(req.length);
+			add_response(req,BIN_STATUS_BAD_REQUEST,NULL,0);
+			break;
+		}
+	}
+}
+
+//返回false表示收到非法数据
+bool bin_conn::parse_requests(){
+	char head[BIN_HEADER_LEN];
+	while(m_in.size() >= BIN_HEADER_LEN){
+		bin_header req;
+		m_in.copy_out(head,BIN_HEADER_LEN);									//只拷贝12字节的包头
+		bin_decode_header(head,req);
+
+		if(req.length > BIN_MAX_PAYLOAD){
+			return false;
+		}
+		if((uint32_t)m_in.size() < BIN_HEADER_LEN + req.length){			//负载还没有收全，等待更多数据
+			break;
+		}
+
+		m_in.consume(BIN_HEADER_LEN);
+		handle_request(req);
+	}
+	return true;
+}
+
+bool bin_conn::flush(){
+	while(!m_out.empty()){
+		int ret = m_out.write_fd(m_sockfd);
+		if(ret < 0){
+			if(errno == EAGAIN){											//内核发送缓冲区满了，注册EPOLLOUT，可写时继续发送
+				if(!m_want_write){
+					modfd(m_epollfd,m_sockfd,EPOLLIN | EPOLLOUT);
+					m_want_write = true;
+				}
+				return true;
+			}
+			return false;
+		}
+	}
+
+	if(m_want_write){														//全部发送完毕，不再关心可写事件
+		modfd(m_epollfd,m_sockfd,EPOLLIN);
+		m_want_write = false;
+	}
+	return true;
+}
+
+void bin_conn::process(){
+	while(true){
+		//边缘触发，需要一直读到EAGAIN。每读一次就解析一次，输入缓冲区只保留不完整的请求
+		bool backlog = false;												//是否因为输出积压而停止读取
+		while(true){
+			if(m_out.size() >= MAX_PENDING_OUTPUT){
+				backlog = true;
+				break;
+			}
+
+			int ret = m_in.read_fd(m_sockfd);
+			if(ret < 0){
+				if(errno != EAGAIN){
+					close_conn();
+					return;
+				}
+				break;
+			}
+			else if(ret == 0){
+				close_conn();
+				return;
+			}
+
+			if(!parse_requests()){
+				close_conn();
+				return;
+			}
+		}
+
+		//这一批请求的所有响应一次写回
+		if(!flush()){
+			close_conn();
+			return;
+		}
+
+		//内核中可能还有没读的数据，边缘触发不会再通知：积压发送完了就继续读，否则等可写之后process被再次调用
+		if(!backlog || !m_out.empty()){
+			break;
+		}
+	}
+}
+
+int main(int argc,char *argv[])
+{
+	if(argc <= 2){
+		printf("useage:%s ip_address port_number [process_number]\n",basename(argv[0]));
+		return 1;
+	}
+
+	int port = atoi(argv[2]);
+	int process_number = argc > 3 ? atoi(argv[3]) : 8;
+
+	int listenfd = socket(AF_INET,SOCK_STREAM,0);
+	assert(listenfd >= 0);
+
+	int ret = 0;
+	struct sockaddr_in address;
+	bzero(&address,sizeof(address));
+
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+
+	int reuse = 1;
+	setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	ret = bind(listenfd,(struct sockaddr*)&address,sizeof(address));
+	assert(ret != -1);
+
+	ret = listen(listenfd,128);
+	assert(ret != -1);
+
+	processpool< bin_conn > *pool = processpool< bin_conn >::create(listenfd,process_number);
+	if(pool){
+		pool->run();
+		delete pool;
+	}
+
+	close(listenfd);
+
+	return 0;
+}
+
+//g++ ./testBinServer.cpp -o testBinServer
@@ -19,6 +19,7 @@
 #include <arpa/inet.h>
 
 #include "processPool.h"
+#include "bufferChain.h"
 
 /*
 用于处理客户cgi请求的类，用于测试processpool的模板类
@@ -31,7 +32,9 @@ public:
 	void init(int epollfd,int sockfd,const sockaddr_in& client_addr);
 	void process();
 private:
-	static const int BUFFER_SIZE = 1024;									//读缓冲区大小
+	void close_conn();
+private:
+	static const int MAX_REQUEST_LEN = 4096;								//请求（程序名称+\r\n）的最大长度，超过还没有遇到\r\n就关闭连接
 	static int m_epollfd;													//注意：epoll句柄是子进程中固定的，对于子进程唯一
 
 	/*
@@ -42,8 +45,8 @@ private:
 	int m_sockfd;															//客户端文件句柄
 	sockaddr_in m_address;													//客户端地址
 
-	char m_buffer[BUFFER_SIZE];												//内部去获取我们要执行的程序的名称！！！使用\r\n标识结束，所以1024足够
-	int m_read_idx;															//标记读缓冲区中已经读入的客户端数据的最后一个字节的下一个位置
+	buffer_chain m_buffer;													//链式读缓冲区，按需从空闲链表取块，空闲连接不占用数据空间
+	int m_scan_idx;															//已经查找过\r\n的位置，下次从这里继续查找，避免重复扫描
 };
 
 int cgi_conn::m_epollfd = -1;
@@ -53,73 +56,86 @@ void cgi_conn::init(int epollfd,int sockfd,const sockaddr_in& client_addr){
 	m_epollfd = epollfd;
 	m_sockfd = sockfd;
 	m_address = client_addr;
-	memset(m_buffer,0,BUFFER_SIZE);
-	m_read_idx = 0;
+	m_buffer.clear();														//上一个使用该槽位的连接可能残留数据，归还所有块
+	m_scan_idx = 0;
+}
+
+//关闭连接，同时把缓冲块归还空闲链表
+void cgi_conn::close_conn(){
+	removefd(m_epollfd,m_sockfd);
+	m_buffer.clear();
+	m_scan_idx = 0;
 }
 
 void cgi_conn::process(){
-	int idx = 0;
 	int ret = -1;
 
 	//开始循环读取和分析客户端的数据，注意：我们只管读取这一次数据，后面数据到达会从子进程发送过来，会重新初始化上面的变量！！！包括类的变量
 	while(true){
-		printf("666666666666666666");
-		idx = m_read_idx;
-		ret = recv(m_sockfd,m_buffer+idx,BUFFER_SIZE-idx-1,0);				//开始读取数据
+		ret = m_buffer.read_fd(m_sockfd);									//readv一次读入多个块
 		
 		//如果读取操作出现错误，则关闭客户连接。如果没有数据读取，则退出循环
 		if(ret < 0){
 			if(errno != EAGAIN){
-				removefd(m_epollfd,m_sockfd);								//进程池中实现的函数
+				close_conn();
 			}
 			break;
 		}
 		else if(ret == 0){													//对方关闭连接，则服务端也关闭连接
-			removefd(m_epollfd,m_sockfd);
+			close_conn();
 			break;
 		}
 		else
 		{
-			m_read_idx += ret;
-			printf("user content is:%s\n",m_buffer);
-			//遍历数据，进行解析，如果没有遇到“\r\n”，则想要读取更多的客户数据。如果遇到\r\n则标识获取到了我们要执行的程序名称，使用execl去执行
-			for(;idx<m_read_idx;idx++){
-				if((idx >= 1) && (m_buffer[idx-1] == '\r') && (m_buffer[idx] == '\n')){
-					break;
-				}
-			}
+			//在块链上查找\r\n，可以跨越块的边界，不需要拷贝。如果没有遇到\r\n则想要读取更多的客户数据
+			int idx = m_buffer.find("\r\n",2,m_scan_idx);
 			
 			//如果没有遇到字符\r\n,则需要再读取更多的数据
-			if(idx == m_read_idx){	
+			if(idx == -1){
+				if(m_buffer.size() >= MAX_REQUEST_LEN){						//请求过长，防止恶意客户端无限占用缓冲块
+					close_conn();
+					break;
+				}
+				m_scan_idx = m_buffer.size() - 1;							//\r可能是最后一个字节，下次从它开始查找
 				continue;
 			}
 
-			//开始解析数据
-			m_buffer[idx-1] = '\0';											//将\r\n中\r置为0，方面读取名称
-			char *filename = m_buffer;
+			//一次read_fd可能读入超过MAX_REQUEST_LEN的数据，\r\n出现在后面时程序名称放不下filename
+			if(idx >= MAX_REQUEST_LEN){
+				close_conn();
+				break;
+			}
+
+			//开始解析数据：只有程序名称需要连续内存（传给access和execl），拷贝出来并以\0结尾
+			char filename[MAX_REQUEST_LEN];
+			m_buffer.copy_out(filename,idx);
+			filename[idx] = '\0';
+			m_buffer.consume(idx + 2);										//消费掉这一行，块归还空闲链表
+			m_scan_idx = 0;
+			printf("user content is:%s\n",filename);
 
 			//开始判断文件是否存在
 			if(access(filename,F_OK) == -1){
-				removefd(m_epollfd,m_sockfd);
+				close_conn();
 				break;
 			}
 
 			//创建子进程来执行cgi程序
 			ret = fork();
 			if(ret == -1){
-				removefd(m_epollfd,m_sockfd);
+				close_conn();
 				break;
 			}
 			else if(ret > 0)												//父进程，关闭连接
 			{
-				removefd(m_epollfd,m_sockfd);
+				close_conn();
 				break;
 			}
 			else															//子进程，将标准输出定向输出到m_sockfd,并执行CGI程序
 			{
 				close(STDOUT_FILENO);
 				dup(m_sockfd);												//将程序输出，输出到socket描述符中
-				execl(m_buffer,m_buffer,(char*)0);
+				execl(filename,filename,(char*)0);
 
 				exit(0);
 			}
@@ -131,7 +147,7 @@ void cgi_conn::process(){
 int main(int argc,char *argv[])
 {
 	if(argc <= 2){
-		printf("useage:%s ip_address port_number\n",basename(argv[0]));	//basename截取文件名
+		printf("useage:%s ip_address port_number [stall_ms] [kill_ms] [stats_path]\n",basename(argv[0]));	//basename截取文件名
 		return 1;
 	}
 
@@ -159,6 +175,9 @@ int main(int argc,char *argv[])
 	assert(ret != -1);
 
 	processpool< cgi_conn > *pool = processpool< cgi_conn >::create(listenfd);
+	if(pool && argc > 3){												//可选：子进程卡住检测的参数
+		pool->set_health_check(atoi(argv[3]),argc > 4 ? atoi(argv[4]) : 0,argc > 5 ? argv[5] : NULL);
+	}
 	if(pool){
 		pool->run();
 		delete pool;
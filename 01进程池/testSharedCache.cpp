@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "sharedCache.h"
+
+/*
+共享缓存的多进程测试：./testSharedCache [procs] [capacity] [keys] [seconds]
+1.父进程创建缓存之后fork出procs个子进程，子进程随机访问keys个key（80%的访问集中在20%的key上），未命中时"加载"之后写入
+2.第一轮正常结束，输出命中率
+3.第二轮运行中途用SIGKILL杀死所有子进程（模拟进程池杀死卡住的子进程），很可能有子进程死在临界区中，
+  然后再启动一轮新的子进程：加锁时发现EOWNERDEAD的分段会被清空，其余分段仍然是热的
+*/
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//子进程：持续访问缓存，直到时间结束或者被杀死
+static void worker(shared_cache *cache,int id,int keys,double seconds){
+	srand(getpid());
+	char key[32],value[256],out[256];
+	long ops = 0,loads = 0,corrupt = 0;
+	double deadline = now_sec() + seconds;
+
+	while(now_sec() < deadline){
+		for(int n=0;n<1000;n++){
+			int k = (rand() % 10 < 8) ? rand() % (keys / 5 + 1) : rand() % keys;	//80%的访问落在前20%的key
+			int klen = snprintf(key,sizeof(key),"key:%d",k);
+			int vlen = 0;
+			if(cache->get(key,klen,out,sizeof(out),&vlen)){
+				if(vlen != klen + 6 || memcmp(out,"value-",6) != 0 || memcmp(out + 6,key,klen) != 0){
+					corrupt++;												//值必须和key对应
+				}
+			}else{
+				vlen = snprintf(value,sizeof(value),"value-%s",key);			//模拟从后端加载
+				cache->put(key,klen,value,vlen);
+				loads++;
+			}
+			ops++;
+		}
+	}
+	printf("worker %d: ops %ld, loads %ld, corrupt %ld\n",id,ops,loads,corrupt);
+	exit(0);
+}
+
+static void print_stats(shared_cache *cache,const char *title){
+	shared_cache_stats st;
+	cache->stats(st);
+	printf("[%s] hits %llu, misses %llu, hit ratio %.2f%%, inserts %llu, updates %llu, evictions %llu, recovered stripes %llu, entries %llu/%llu\n",
+		title,(unsigned long long)st.hits,(unsigned long long)st.misses,
+		st.hits + st.misses ? 100.0 * st.hits / (st.hits + st.misses) : 0.0,
+		(unsigned long long)st.inserts,(unsigned long long)st.updates,(unsigned long long)st.evictions,
+		(unsigned long long)st.recovered,(unsigned long long)st.entries,(unsigned long long)st.capacity);
+}
+
+static void run_round(shared_cache *cache,int procs,int keys,double seconds,bool kill_midway){
+	pid_t pids[64];
+	fflush(stdout);
+	for(int i=0;i<procs;i++){
+		pids[i] = fork();
+		if(pids[i] == 0){
+			worker(cache,i,keys,seconds);
+		}
+	}
+
+	if(kill_midway){
+		usleep((useconds_t)(seconds * 1e6 / 2));
+		for(int i=0;i<procs;i++){
+			kill(pids[i],SIGKILL);
+		}
+	}
+	for(int i=0;i<procs;i++){
+		waitpid(pids[i],NULL,0);
+	}
+}
+
+int main(int argc,char *argv[])
+{
+	int procs = argc > 1 ? atoi(argv[1]) : 4;
+	int capacity = argc > 2 ? atoi(argv[2]) : 10000;
+	int keys = argc > 3 ? atoi(argv[3]) : 20000;
+	double seconds = argc > 4 ? atof(argv[4]) : 2;
+	if(procs <= 0 || procs > 64 || keys <= 0){
+		printf("useage:%s [procs(1-64)] [capacity] [keys] [seconds]\n",argv[0]);
+		return 1;
+	}
+
+	shared_cache *cache = shared_cache::create(capacity,256);				//必须在fork之前创建
+	if(cache == NULL){
+		printf("create shared cache failed\n");
+		return 1;
+	}
+
+	run_round(cache,procs,keys,seconds,false);
+	print_stats(cache,"round 1");
+
+	run_round(cache,procs,keys,seconds,true);
+	print_stats(cache,"round 2, killed");
+
+	run_round(cache,procs,keys,seconds,false);								//新的子进程继续使用同一块缓存
+	print_stats(cache,"round 3, restarted");
+
+	cache->destroy();
+	return 0;
+}
+
+//g++ ./testSharedCache.cpp -o testSharedCache -lpthread
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <assert.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "processPool.h"
+
+/*
+UDP模式的处理类，用于测试processpool的UDP模式：收到什么就回什么（小查询的回显）
+注意：同一个子进程中的所有数据报都由同一个对象处理，处理函数中不能阻塞
+*/
+class udp_echo{
+public:
+	udp_echo() : m_count(0){}
+	~udp_echo(){}
+public:
+	int on_datagram(const char *data,int len,const sockaddr_in& peer,char *reply,int reply_size){
+		(void)peer;															//回显不需要对端地址
+		m_count++;
+		int n = len < reply_size ? len : reply_size;
+		memcpy(reply,data,n);
+		return n;															//返回响应长度，返回-1表示不响应
+	}
+private:
+	long m_count;
+};
+
+int main(int argc,char *argv[])
+{
+	if(argc <= 2){
+		printf("useage:%s ip_address port_number [process_number] [batch] [gro] [gso]\n",basename(argv[0]));
+		return 1;
+	}
+
+	const char *ip = argv[1];
+	int port = atoi(argv[2]);
+	int process_number = argc > 3 ? atoi(argv[3]) : 8;
+	int batch = argc > 4 ? atoi(argv[4]) : 64;
+	int flags = 0;
+	if(argc > 5 && atoi(argv[5])){
+		flags |= UDP_FLAG_GRO;
+	}
+	if(argc > 6 && atoi(argv[6])){
+		flags |= UDP_FLAG_GSO;
+	}
+
+	processpool< udp_echo > *pool = processpool< udp_echo >::create_udp(ip,port,process_number,batch,flags);
+	if(pool){
+		pool->run_udp();
+		delete pool;
+	}
+
+	return 0;
+}
+
+//g++ ./testUdp.cpp -o testUdp
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <vector>
+
+using namespace std;
+
+/*
+UDP压测客户端：统计每秒发送和收到的数据报数量（pps）
+./testUdpClient ip port threads batch seconds [payload]
+每个线程一个socket（源端口不同，SO_REUSEPORT会把它们分散到不同的子进程），sendmmsg一次发送batch个数据报，
+再用recvmmsg收回响应，最多等待10ms，收不齐的认为丢包
+*/
+
+struct udp_arg
+{
+	const char *ip;
+	int port;
+	int batch;
+	int payload;
+	double seconds;
+
+	long sent;
+	long received;
+};
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *udp_thread(void *argv){
+	udp_arg *arg = (udp_arg*)argv;
+
+	int fd = socket(AF_INET,SOCK_DGRAM,0);
+	struct sockaddr_in addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(arg->port);
+	addr.sin_addr.s_addr = inet_addr(arg->ip);
+	connect(fd,(struct sockaddr*)&addr,sizeof(addr));						//connect之后sendmmsg不需要填写地址
+
+	struct timeval tv = {0,10000};
+	setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+
+	vector<char> out(arg->payload,'q');
+	vector<char> in((size_t)arg->batch * 2048);
+	vector<mmsghdr> smsgs(arg->batch),rmsgs(arg->batch);
+	vector<iovec> siov(arg->batch),riov(arg->batch);
+
+	for(int i = 0;i < arg->batch;i++){
+		siov[i].iov_base = &out[0];
+		siov[i].iov_len = out.size();
+		memset(&smsgs[i].msg_hdr,0,sizeof(msghdr));
+		smsgs[i].msg_hdr.msg_iov = &siov[i];
+		smsgs[i].msg_hdr.msg_iovlen = 1;
+
+		riov[i].iov_base = &in[(size_t)i * 2048];
+		riov[i].iov_len = 2048;
+		memset(&rmsgs[i].msg_hdr,0,sizeof(msghdr));
+		rmsgs[i].msg_hdr.msg_iov = &riov[i];
+		rmsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	double deadline = now_sec() + arg->seconds;
+	while(now_sec() < deadline){
+		int n = sendmmsg(fd,&smsgs[0],arg->batch,0);
+		if(n <= 0){
+			continue;
+		}
+		arg->sent += n;
+
+		int got = 0;
+		while(got < n){
+			int r = recvmmsg(fd,&rmsgs[0],n - got,MSG_WAITFORONE,NULL);		//至少收到一个就返回，超时说明丢包了
+			if(r <= 0){
+				break;
+			}
+			got += r;
+		}
+		arg->received += got;
+	}
+
+	close(fd);
+	return NULL;
+}
+
+int main(int argc,char** argv)
+{
+	if(argc < 6)
+	{
+		cout<<"Input error! Usage should be : "<<argv[0]<<"  ip port threads batch seconds [payload]"<<endl;
+		return 0;
+	}
+
+	int threads = atoi(argv[3]);
+	vector<pthread_t> tids(threads);
+	vector<udp_arg> args(threads);
+	for(int i = 0;i < threads;i++){
+		memset(&args[i],0,sizeof(udp_arg));
+		args[i].ip = argv[1];
+		args[i].port = atoi(argv[2]);
+		args[i].batch = atoi(argv[4]);
+		args[i].seconds = atof(argv[5]);
+		args[i].payload = argc > 6 ? atoi(argv[6]) : 32;
+	}
+
+	double start = now_sec();
+	for(int i = 0;i < threads;i++){
+		pthread_create(&tids[i],NULL,udp_thread,&args[i]);
+	}
+
+	long sent = 0,received = 0;
+	for(int i = 0;i < threads;i++){
+		pthread_join(tids[i],NULL);
+		sent += args[i].sent;
+		received += args[i].received;
+	}
+	double spend = now_sec() - start;
+
+	printf("threads:%d batch:%d payload:%d seconds:%.2f\n",threads,args[0].batch,args[0].payload,spend);
+	printf("sent:%ld (%.0f pps), received:%ld (%.0f pps), lost:%ld\n",
+		sent,sent / spend,received,received / spend,sent - received);
+	return 0;
+}
+
+//g++ ./testUdpClient.cpp -o testUdpClient -lpthread
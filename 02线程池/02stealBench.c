@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "threadPool.h"
+
+/*
+全局队列（THREADPOOL_SCHED_GLOBAL）和工作窃取（THREADPOOL_SCHED_STEALING）的扩展性对比：./02stealBench [jobs] [work] [max_workers]
+场景1 external：主线程提交jobs个任务，所有任务都经过注入队列，工作窃取只省掉了空闲线程的无效唤醒
+场景2 spawn：主线程提交少量根任务，每个任务在工作线程中再提交两个子任务（二叉树），子任务进入线程自己的双端队列，
+             这是工作窃取真正发挥作用的场景：全局队列模式下每个子任务都要竞争jobs_mtx
+work是每个任务的空循环次数，用于模拟任务的大小
+*/
+
+static nJob *jobs;							//预先分配所有任务，测的是调度开销而不是malloc
+static long nextJob;						//spawn场景中下一个可用的任务下标
+static long doneJobs;						//已经完成的任务数
+static int workLoops;
+static nThreadPool *benchPool;				//spawn场景中子任务提交到的线程池
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void do_work(){
+	for(volatile int i = 0;i < workLoops;i++){
+	}
+}
+
+static void external_job(nJob *job){
+	(void)job;
+	do_work();
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELAXED);
+}
+
+//user_data中保存剩余的深度，深度大于0时再提交两个子任务
+static void spawn_job(nJob *job){
+	long depth = (long)job->user_data;
+	if(depth > 0){
+		for(int i = 0;i < 2;i++){
+			nJob *child = &jobs[__atomic_fetch_add(&nextJob,1,__ATOMIC_RELAXED)];
+			child->job_function = spawn_job;
+			child->user_data = (void *)(depth - 1);
+			threadPoolQueue(benchPool,child);
+		}
+	}
+	do_work();
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELAXED);
+}
+
+static void wait_done(long total){
+	while(__atomic_load_n(&doneJobs,__ATOMIC_RELAXED) < total){
+		usleep(50);
+	}
+}
+
+static double run_external(int sched,int workers,long total){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = sched;
+
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	doneJobs = 0;
+
+	double start = now_sec();
+	for(long i = 0;i < total;i++){
+		jobs[i].job_function = external_job;
+		jobs[i].user_data = NULL;
+		threadPoolQueue(&pool,&jobs[i]);
+	}
+	wait_done(total);
+	double spend = now_sec() - start;
+
+	threadPoolShutdown(&pool);
+	return total / spend;
+}
+
+static double run_spawn(int sched,int workers,long total){
+	//每个根任务是一棵深度为depth的满二叉树，共2^(depth+1)-1个任务
+	int depth = 10;
+	long per_root = (1L << (depth + 1)) - 1;
+	long roots = total / per_root;
+	if(roots < 1){
+		roots = 1;
+	}
+	total = roots * per_root;
+
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = sched;
+
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	doneJobs = 0;
+	nextJob = roots;
+	benchPool = &pool;
+
+	double start = now_sec();
+	for(long i = 0;i < roots;i++){
+		jobs[i].job_function = spawn_job;
+		jobs[i].user_data = (void *)(long)depth;
+		threadPoolQueue(&pool,&jobs[i]);
+	}
+	wait_done(total);
+	double spend = now_sec() - start;
+
+	threadPoolShutdown(&pool);
+	return total / spend;
+}
+
+int main(int argc,char *argv[]){
+	long total = argc > 1 ? atol(argv[1]) : 1000000;
+	workLoops = argc > 2 ? atoi(argv[2]) : 100;
+	int max_workers = argc > 3 ? atoi(argv[3]) : 64;
+
+	jobs = (nJob *)calloc(total,sizeof(nJob));
+	if(jobs == NULL){
+		perror("calloc error!\n");
+		return 1;
+	}
+
+	printf("jobs:%ld work:%d cpus:%ld (jobs/s)\n",total,workLoops,sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%8s %14s %14s %14s %14s\n","workers","external-mtx","external-steal","spawn-mtx","spawn-steal");
+	for(int w = 1;w <= max_workers;w *= 2){
+		double em = run_external(THREADPOOL_SCHED_GLOBAL,w,total);
+		double es = run_external(THREADPOOL_SCHED_STEALING,w,total);
+		double sm = run_spawn(THREADPOOL_SCHED_GLOBAL,w,total);
+		double ss = run_spawn(THREADPOOL_SCHED_STEALING,w,total);
+		printf("%8d %14.0f %14.0f %14.0f %14.0f\n",w,em,es,sm,ss);
+	}
+
+	free(jobs);
+	return 0;
+}
+
+//gcc -O2 ./02stealBench.c ./threadPool.c -o 02stealBench -lpthread
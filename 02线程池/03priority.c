@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "threadPool.h"
+
+/*
+优先级通道和老化的演示：./03priority [aging_ms] [job_us]
+一个工作线程，一次性提交大量高优先级任务，中间夹杂普通和低优先级任务，每个任务忙等job_us微秒
+1.同一个通道内的任务必须按提交顺序执行（FIFO），用序号检查
+2.aging_ms=0时严格按优先级，低优先级任务要等所有高优先级任务执行完；打开老化之后低优先级的排队时间被限制在aging_ms左右
+*/
+
+#define HIGH_JOBS		20000
+#define NORMAL_JOBS		2000
+#define LOW_JOBS		200
+
+static int jobUs;
+static long lastSeq[THREADPOOL_LANES];		//每个通道上一个执行的序号
+static long outOfOrder;
+static long doneJobs;
+
+static void busy_us(int us){
+	struct timespec s,n;
+	clock_gettime(CLOCK_MONOTONIC,&s);
+	do{
+		clock_gettime(CLOCK_MONOTONIC,&n);
+	}while((n.tv_sec - s.tv_sec) * 1000000L + (n.tv_nsec - s.tv_nsec) / 1000 < us);
+}
+
+//user_data是任务在通道内的序号，只有一个工作线程，不需要加锁
+static void prio_job(nJob *job){
+	long seq = (long)job->user_data;
+	if(seq != lastSeq[job->priority] + 1){
+		outOfOrder++;
+	}
+	lastSeq[job->priority] = seq;
+	busy_us(jobUs);
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void print_lane(nThreadPool *pool,int lane,const char *name){
+	nHistogram h;
+	threadPoolLaneWait(pool,lane,&h);
+	printf("%-7s jobs:%6llu  wait(us) avg:%8llu p50:<%8llu p99:<%8llu max:%8llu\n",name,h.count,
+		h.count ? h.sum_us / h.count : 0,threadPoolHistPercentile(&h,50),threadPoolHistPercentile(&h,99),h.max_us);
+}
+
+int main(int argc,char *argv[]){
+	int aging = argc > 1 ? atoi(argv[1]) : THREADPOOL_AGING_MS;
+	jobUs = argc > 2 ? atoi(argv[2]) : 20;
+
+	int total = HIGH_JOBS + NORMAL_JOBS + LOW_JOBS;
+	nJob *jobs = (nJob *)calloc(total,sizeof(nJob));
+
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.aging_ms = aging;
+	attr.capacity = 0;							//一次性提交所有任务，不限制队列长度
+
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,1,&attr);
+
+	//按10:1:0.1的比例交错提交
+	long seq[THREADPOOL_LANES] = {0};
+	int h = 0,n = 0,l = 0,idx = 0;
+	while(h < HIGH_JOBS || n < NORMAL_JOBS || l < LOW_JOBS){
+		int lane;
+		if(l < LOW_JOBS && idx % 100 == 99){
+			lane = THREADPOOL_PRIO_LOW;
+			l++;
+		}else if(n < NORMAL_JOBS && idx % 10 == 9){
+			lane = THREADPOOL_PRIO_NORMAL;
+			n++;
+		}else if(h < HIGH_JOBS){
+			lane = THREADPOOL_PRIO_HIGH;
+			h++;
+		}else{
+			idx++;
+			continue;
+		}
+		nJob *job = &jobs[h + n + l - 1];
+		job->job_function = prio_job;
+		job->user_data = (void *)(++seq[lane]);
+		threadPoolQueuePriority(&pool,job,lane);
+		idx++;
+	}
+
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < total){
+		usleep(1000);
+	}
+
+	printf("aging:%dms job:%dus jobs:%d out of order:%ld\n",aging,jobUs,total,outOfOrder);
+	print_lane(&pool,THREADPOOL_PRIO_HIGH,"high");
+	print_lane(&pool,THREADPOOL_PRIO_NORMAL,"normal");
+	print_lane(&pool,THREADPOOL_PRIO_LOW,"low");
+
+	threadPoolShutdown(&pool);
+	free(jobs);
+	return 0;
+}
+
+//gcc -O2 ./03priority.c ./threadPool.c -o 03priority -lpthread
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "threadPool.h"
+
+/*
+单个提交和批量提交的对比：./04batch [jobs] [workers] [batch] [work]
+主线程提交jobs个小任务，分别测量：
+1.submit：提交所有任务花费的时间（threadPoolQueue逐个提交，或者threadPoolQueueBatch每次提交batch个）
+2.total：从开始提交到全部执行完的吞吐量
+dequeue_batch=1时工作线程每次加锁只取一个任务，用于对比取任务一侧的批量
+*/
+
+static nJob *jobs;
+static nJob **ptrs;
+static long doneJobs;
+static int workLoops;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void small_job(nJob *job){
+	(void)job;
+	for(volatile int i = 0;i < workLoops;i++){
+	}
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELAXED);
+}
+
+//batch为0表示逐个提交，结果通过submit和total返回（任务数/秒）
+static void run(int sched,int workers,long total,int batch,int dequeue_batch,double *submit,double *tput){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = sched;
+	attr.dequeue_batch = dequeue_batch;
+	attr.capacity = 0;							//一次性提交所有任务，不限制队列长度
+
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	doneJobs = 0;
+	for(long i = 0;i < total;i++){
+		jobs[i].job_function = small_job;
+		jobs[i].user_data = NULL;
+		ptrs[i] = &jobs[i];
+	}
+
+	double start = now_sec();
+	if(batch <= 0){
+		for(long i = 0;i < total;i++){
+			threadPoolQueue(&pool,&jobs[i]);
+		}
+	}else{
+		for(long i = 0;i < total;i += batch){
+			threadPoolQueueBatch(&pool,&ptrs[i],total - i < batch ? (int)(total - i) : batch);
+		}
+	}
+	double submitted = now_sec();
+	while(__atomic_load_n(&doneJobs,__ATOMIC_RELAXED) < total){
+		usleep(50);
+	}
+	double end = now_sec();
+
+	threadPoolShutdown(&pool);
+	*submit = total / (submitted - start);
+	*tput = total / (end - start);
+}
+
+int main(int argc,char *argv[]){
+	long total = argc > 1 ? atol(argv[1]) : 1000000;
+	int workers = argc > 2 ? atoi(argv[2]) : 4;
+	int batch = argc > 3 ? atoi(argv[3]) : 64;
+	workLoops = argc > 4 ? atoi(argv[4]) : 100;
+
+	jobs = (nJob *)calloc(total,sizeof(nJob));
+	ptrs = (nJob **)calloc(total,sizeof(nJob *));
+	if(jobs == NULL || ptrs == NULL){
+		perror("calloc error!\n");
+		return 1;
+	}
+
+	printf("jobs:%ld workers:%d batch:%d work:%d (jobs/s)\n",total,workers,batch,workLoops);
+	printf("%-8s %-22s %14s %14s\n","sched","mode","submit","total");
+	const char *names[] = {"global","stealing"};
+	for(int sched = THREADPOOL_SCHED_GLOBAL;sched <= THREADPOOL_SCHED_STEALING;sched++){
+		double s,t;
+		run(sched,workers,total,0,1,&s,&t);
+		printf("%-8s %-22s %14.0f %14.0f\n",names[sched],"single, dequeue 1",s,t);
+		run(sched,workers,total,0,THREADPOOL_DEQUEUE_BATCH,&s,&t);
+		printf("%-8s %-22s %14.0f %14.0f\n",names[sched],"single, dequeue batch",s,t);
+		run(sched,workers,total,batch,THREADPOOL_DEQUEUE_BATCH,&s,&t);
+		printf("%-8s %-22s %14.0f %14.0f\n",names[sched],"batch, dequeue batch",s,t);
+	}
+
+	free(ptrs);
+	free(jobs);
+	return 0;
+}
+
+//gcc -O2 ./04batch.c ./threadPool.c -o 04batch -lpthread
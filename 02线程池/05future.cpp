@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <atomic>
+#include <numeric>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "threadPoolFuture.h"
+
+/*
+pool_future和task_graph的演示：./05future [workers] [sched(0全局队列,1工作窃取)]
+1.submit/get、then链、异常传递
+2.when_all并行求和，when_any取最快的一个
+3.递归fib：每个任务提交两个子任务并在任务中get等待，线程数远小于同时等待的任务数，靠等待时帮忙执行任务才不会死锁
+4.任务图：菱形依赖检查执行顺序，节点异常之后后续节点不执行，有环时报错
+*/
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static nThreadPool pool;
+
+static long fib(int n){
+	if(n < 2){
+		return n;
+	}
+	if(n < 16){
+		return fib(n - 1) + fib(n - 2);					//太小的任务直接计算
+	}
+	pool_future<long> a = pool_submit(&pool,[n]{ return fib(n - 1); });
+	long b = fib(n - 2);
+	return a.get() + b;									//a还在队列中时，当前线程会自己把它取出来执行
+}
+
+int main(int argc,char *argv[]){
+	int workers = argc > 1 ? atoi(argv[1]) : 2;
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = argc > 2 ? atoi(argv[2]) : THREADPOOL_SCHED_STEALING;
+	threadPoolCreateEx(&pool,workers,&attr);
+
+	//1.submit、then、异常
+	pool_future<int> f = pool_submit(&pool,[]{ return 6 * 7; });
+	printf("submit: %d\n",f.get());
+
+	pool_future<std::string> chain = pool_submit(&pool,[]{ return 20; })
+		.then([](int v){ return v + 1; })
+		.then([](int v){ return std::to_string(v * 2); });
+	printf("then: %s\n",chain.get().c_str());
+
+	pool_future<int> bad = pool_submit(&pool,[]() -> int { throw std::runtime_error("job failed"); })
+		.then([](int v){ printf("never runs\n"); return v; });
+	try{
+		bad.get();
+	}catch(const std::exception &e){
+		printf("exception: %s\n",e.what());
+	}
+
+	//2.when_all / when_any
+	const long N = 10000000;
+	const int parts = 8;
+	std::vector<pool_future<long>> sums;
+	for(int i = 0;i < parts;i++){
+		long from = N / parts * i,to = N / parts * (i + 1);
+		sums.push_back(pool_submit(&pool,[from,to]{
+			long s = 0;
+			for(long x = from;x < to;x++){
+				s += x;
+			}
+			return s;
+		}));
+	}
+	std::vector<long> partial = when_all(sums).get();
+	printf("when_all: sum(0..%ld) = %ld, expect %ld\n",N - 1,std::accumulate(partial.begin(),partial.end(),0L),N * (N - 1) / 2);
+
+	std::vector<pool_future<int>> racers;
+	for(int i = 0;i < 4;i++){
+		racers.push_back(pool_submit(&pool,[i]{ usleep((4 - i) * 20000); return i; }));
+	}
+	size_t first = when_any(racers).get();
+	printf("when_any: first finished #%zu (value %d)\n",first,racers[first].get());
+	when_all(racers).wait();
+
+	//3.任务中等待子任务
+	double start = now_sec();
+	long r = fib(32);
+	printf("fib(32) = %ld with %d workers, %.3fs\n",r,workers,now_sec() - start);
+
+	//4.任务图：a -> (b,c) -> d
+	std::atomic<int> step(0);
+	int order[4] = {0};
+	task_graph g;
+	int a = g.add([&]{ order[0] = ++step; });
+	int b = g.add([&]{ order[1] = ++step; });
+	int c = g.add([&]{ order[2] = ++step; });
+	int d = g.add([&]{ order[3] = ++step; });
+	g.precede(a,b);
+	g.precede(a,c);
+	g.precede(b,d);
+	g.precede(c,d);
+	g.run(&pool).get();
+	printf("graph: a=%d b=%d c=%d d=%d (a first, d last)\n",order[0],order[1],order[2],order[3]);
+
+	int ran = 0;
+	task_graph failing;
+	int x = failing.add([]{ throw std::runtime_error("node x failed"); });
+	int y = failing.add([&]{ ran++; });
+	failing.precede(x,y);
+	try{
+		failing.run(&pool).get();
+	}catch(const std::exception &e){
+		printf("graph exception: %s, dependent ran %d times\n",e.what(),ran);
+	}
+
+	task_graph cyclic;
+	int p = cyclic.add([]{});
+	int q = cyclic.add([]{});
+	cyclic.precede(p,q);
+	cyclic.precede(q,p);
+	try{
+		cyclic.run(&pool).get();
+	}catch(const std::exception &e){
+		printf("graph exception: %s\n",e.what());
+	}
+
+	threadPoolShutdown(&pool);
+	return 0;
+}
+
+//g++ -O2 ./05future.cpp ./threadPool.c -o 05future -lpthread
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "threadPool.h"
+
+/*
+动态线程数的演示：./06dynamic [sched(0全局队列,1工作窃取)] [max_workers]
+任务模拟阻塞IO（usleep），CPU不忙但是线程都被占住，排队时间变长，线程池应该增加线程
+1.突发：一次提交大量阻塞任务，观察线程数增长和排队时间
+2.空闲：不再提交任务，线程空闲超过idle_timeout_ms之后退出，回到min_workers
+3.再来一次突发，重用退出线程留下的位置
+*/
+
+#define BURST_JOBS		2000
+#define JOB_SLEEP_US	2000
+
+static long doneJobs;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void io_job(nJob *job){
+	(void)job;
+	usleep(JOB_SLEEP_US);
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void burst(nThreadPool *pool,nJob *jobs,const char *name){
+	doneJobs = 0;
+	double start = now_sec();
+	for(int i = 0;i < BURST_JOBS;i++){
+		jobs[i].job_function = io_job;
+		threadPoolQueue(pool,&jobs[i]);
+	}
+	int peak = 0;
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < BURST_JOBS){
+		usleep(10000);
+		int size = threadPoolSize(pool);
+		peak = size > peak ? size : peak;
+	}
+	nHistogram h;
+	threadPoolLaneWait(pool,THREADPOOL_PRIO_NORMAL,&h);
+	printf("%s: %d jobs in %.2fs, peak size %d, wait p99 <%llu us (cumulative)\n",
+		name,BURST_JOBS,now_sec() - start,peak,threadPoolHistPercentile(&h,99));
+}
+
+int main(int argc,char *argv[]){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = argc > 1 ? atoi(argv[1]) : THREADPOOL_SCHED_STEALING;
+	attr.min_workers = 2;
+	attr.max_workers = argc > 2 ? atoi(argv[2]) : 64;
+	attr.idle_timeout_ms = 200;
+
+	nJob *jobs = (nJob *)calloc(BURST_JOBS,sizeof(nJob));
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,attr.min_workers,&attr);
+	printf("min:%d max:%d grow_wait:%dms grow_depth:%d idle_timeout:%dms, job sleeps %dus\n",
+		attr.min_workers,attr.max_workers,attr.grow_wait_ms,attr.grow_depth,attr.idle_timeout_ms,JOB_SLEEP_US);
+	printf("start: size %d\n",threadPoolSize(&pool));
+
+	burst(&pool,jobs,"burst 1");
+	for(int i = 0;i < 5;i++){
+		usleep(100000);
+		printf("idle %dms: size %d\n",(i + 1) * 100,threadPoolSize(&pool));
+	}
+	burst(&pool,jobs,"burst 2");
+	printf("spawned %llu, retired %llu, slots used %d\n",pool.spawned,pool.retired,pool.num_workers);
+
+	threadPoolShutdown(&pool);
+	free(jobs);
+	return 0;
+}
+
+//gcc -O2 ./06dynamic.c ./threadPool.c -o 06dynamic -lpthread
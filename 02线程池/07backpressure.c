@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "threadPool.h"
+
+/*
+有界队列的演示：./07backpressure [capacity] [jobs] [sched(0全局队列,1工作窃取)]
+生产者提交任务的速度远大于线程池的处理速度（每个任务忙等50微秒），分别用三种方式提交：
+1.block：threadPoolQueue，队列满了生产者被阻塞，提交速度自动降到处理速度
+2.try：threadPoolTryQueue，队列满了立即失败，生产者自己决定丢弃还是稍后重试（这里直接丢弃）
+3.timed：threadPoolQueueTimed，最多等待1毫秒
+每种方式都记录队列长度的最大值，不会超过capacity
+*/
+
+#define JOB_US		50
+
+static long doneJobs;
+static nJob *jobs;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void slow_job(nJob *job){
+	(void)job;
+	double end = now_sec() + JOB_US / 1e6;
+	while(now_sec() < end){
+	}
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void run(int sched,long capacity,long total,int mode,const char *name){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = sched;
+	attr.capacity = capacity;
+
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,2,&attr);
+	doneJobs = 0;
+
+	long accepted = 0,maxQueued = 0;
+	double start = now_sec();
+	for(long i = 0;i < total;i++){
+		jobs[i].job_function = slow_job;
+		int ret;
+		if(mode == 0){
+			ret = threadPoolQueue(&pool,&jobs[i]);
+		}else if(mode == 1){
+			ret = threadPoolTryQueue(&pool,&jobs[i]);
+		}else{
+			ret = threadPoolQueueTimed(&pool,&jobs[i],1);
+		}
+		if(ret == 0){
+			accepted++;
+		}
+		long q = __atomic_load_n(&pool.queued,__ATOMIC_RELAXED);
+		maxQueued = q > maxQueued ? q : maxQueued;
+	}
+	double submitted = now_sec() - start;
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < accepted){
+		usleep(1000);
+	}
+
+	printf("%-6s accepted %6ld/%ld in %.2fs, max queued %5ld, blocked %6llu, rejected %6llu, timeouts %6llu\n",
+		name,accepted,total,submitted,maxQueued,pool.blocked,pool.rejected,pool.timeouts);
+	threadPoolShutdown(&pool);
+}
+
+int main(int argc,char *argv[]){
+	long capacity = argc > 1 ? atol(argv[1]) : MAX_JOBS_COUNT;
+	long total = argc > 2 ? atol(argv[2]) : 20000;
+	int sched = argc > 3 ? atoi(argv[3]) : THREADPOOL_SCHED_STEALING;
+
+	jobs = (nJob *)calloc(total,sizeof(nJob));
+	printf("capacity:%ld jobs:%ld job:%dus workers:2\n",capacity,total,JOB_US);
+	run(sched,capacity,total,0,"block");
+	run(sched,capacity,total,1,"try");
+	run(sched,capacity,total,2,"timed");
+	free(jobs);
+	return 0;
+}
+
+//gcc -O2 ./07backpressure.c ./threadPool.c -o 07backpressure -lpthread
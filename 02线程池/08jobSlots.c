@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+
+#include <pthread.h>
+
+#include "threadPool.h"
+
+/*
+任务槽和malloc的对比：./08jobSlots [jobs] [workers] [slots]
+每个任务只是把参数中的两个数加起来，测的几乎全是提交和回收任务的开销
+1.malloc：和01threadPool.c原来的写法一样，生产者malloc nJob和user_data，工作线程free
+2.slots：threadPoolJobAlloc取任务槽，参数写在内联参数区，执行完线程池自动归还；槽用完时生产者让出CPU等待
+*/
+
+typedef struct {
+	long a;
+	long b;
+} add_args;
+
+static long doneJobs;
+static long sum;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void add_job_malloc(nJob *job){
+	add_args *args = (add_args *)job->user_data;
+	__atomic_add_fetch(&sum,args->a + args->b,__ATOMIC_RELAXED);
+	free(job->user_data);
+	free(job);
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void add_job_slot(nJob *job){
+	add_args *args = (add_args *)job->user_data;
+	__atomic_add_fetch(&sum,args->a + args->b,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static double run(int sched,int workers,long total,int slots,int use_slots,unsigned long long *exhausted){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = sched;
+	attr.capacity = 0;
+	attr.job_slots = use_slots ? slots : 0;
+
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	doneJobs = 0;
+	sum = 0;
+
+	double start = now_sec();
+	for(long i = 0;i < total;i++){
+		nJob *job;
+		if(use_slots){
+			while((job = threadPoolJobAlloc(&pool)) == NULL){
+				sched_yield();								//槽用完了，等工作线程归还
+			}
+			job->job_function = add_job_slot;
+		}else{
+			job = (nJob *)malloc(sizeof(nJob));
+			job->user_data = malloc(sizeof(add_args));
+			job->job_function = add_job_malloc;
+		}
+		add_args *args = (add_args *)job->user_data;
+		args->a = i;
+		args->b = 1;
+		threadPoolQueue(&pool,job);
+	}
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < total){
+		usleep(50);
+	}
+	double spend = now_sec() - start;
+
+	if(sum != total * (total - 1) / 2 + total){
+		printf("wrong sum %ld\n",sum);
+	}
+	*exhausted = pool.slot_exhausted;
+	threadPoolShutdown(&pool);
+	return total / spend;
+}
+
+int main(int argc,char *argv[]){
+	long total = argc > 1 ? atol(argv[1]) : 2000000;
+	int workers = argc > 2 ? atoi(argv[2]) : 4;
+	int slots = argc > 3 ? atoi(argv[3]) : 4096;
+
+	printf("jobs:%ld workers:%d slots:%d payload:%d bytes, slot size:%zu bytes (jobs/s)\n",
+		total,workers,slots,THREADPOOL_SLOT_PAYLOAD,sizeof(nJobSlot));
+	printf("%-8s %14s %14s %12s\n","sched","malloc","slots","exhausted");
+	const char *names[] = {"global","stealing"};
+	for(int sched = THREADPOOL_SCHED_GLOBAL;sched <= THREADPOOL_SCHED_STEALING;sched++){
+		unsigned long long exhausted = 0;
+		double m = run(sched,workers,total,slots,0,&exhausted);
+		double s = run(sched,workers,total,slots,1,&exhausted);
+		printf("%-8s %14.0f %14.0f %12llu\n",names[sched],m,s,exhausted);
+	}
+	return 0;
+}
+
+//gcc -O2 ./08jobSlots.c ./threadPool.c -o 08jobSlots -lpthread
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "threadPoolParallel.h"
+
+/*
+并行算法和顺序的std算法的对比：./09parallel [workers] [max_exp] [sched(0全局队列,1工作窃取)]
+元素个数从10^6到10^max_exp（默认10^8；10^9需要十几GB内存）
+for：a[i] = sqrt(i) * 1.5        对比 for循环
+reduce：sum(a)                  对比 std::accumulate
+scan：long的包含式前缀和          对比 std::inclusive_scan
+sort：随机的32位整数              对比 std::sort（并行版本是稳定排序，对比std::stable_sort更公平，这里也列出）
+每项输出 顺序时间/并行时间/加速比，并检查结果一致
+*/
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name,size_t n,double seq,double par,bool ok){
+	printf("%-12s n=%-11zu seq %8.3fs  par %8.3fs  speedup %5.2fx  %s\n",name,n,seq,par,seq / par,ok ? "ok" : "MISMATCH");
+}
+
+int main(int argc,char *argv[]){
+	int workers = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int max_exp = argc > 2 ? atoi(argv[2]) : 8;
+
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = argc > 3 ? atoi(argv[3]) : THREADPOOL_SCHED_STEALING;
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	printf("workers:%d cpus:%ld\n",workers,sysconf(_SC_NPROCESSORS_ONLN));
+
+	for(int e = 6;e <= max_exp;e++){
+		size_t n = 1;
+		for(int i = 0;i < e;i++){
+			n *= 10;
+		}
+
+		//for
+		std::vector<double> a(n),b(n);
+		double t0 = now_sec();
+		for(size_t i = 0;i < n;i++){
+			a[i] = sqrt((double)i) * 1.5;
+		}
+		double t1 = now_sec();
+		parallel_for(&pool,0,n,[&](size_t i){ b[i] = sqrt((double)i) * 1.5; });
+		double t2 = now_sec();
+		report("for",n,t1 - t0,t2 - t1,a == b);
+
+		//reduce，浮点加法的顺序不同，结果只要求相对误差很小
+		t0 = now_sec();
+		double s1 = std::accumulate(a.begin(),a.end(),0.0);
+		t1 = now_sec();
+		double s2 = parallel_reduce(&pool,0,n,0.0,
+			[&](size_t lo,size_t hi,double init){ for(size_t i = lo;i < hi;i++) init += a[i]; return init; },
+			[](double x,double y){ return x + y; });
+		t2 = now_sec();
+		report("reduce",n,t1 - t0,t2 - t1,fabs(s1 - s2) <= fabs(s1) * 1e-9);
+		std::vector<double>().swap(a);
+		std::vector<double>().swap(b);
+
+		//scan
+		std::vector<long> in(n),out1(n),out2(n);
+		for(size_t i = 0;i < n;i++){
+			in[i] = (long)(i % 7) - 3;
+		}
+		t0 = now_sec();
+		std::inclusive_scan(in.begin(),in.end(),out1.begin());
+		t1 = now_sec();
+		parallel_scan(&pool,in.begin(),in.end(),out2.begin());
+		t2 = now_sec();
+		report("scan",n,t1 - t0,t2 - t1,out1 == out2);
+		std::vector<long>().swap(in);
+		std::vector<long>().swap(out1);
+		std::vector<long>().swap(out2);
+
+		//sort
+		std::vector<unsigned int> v1(n);
+		std::mt19937 rng(12345);
+		for(size_t i = 0;i < n;i++){
+			v1[i] = rng();
+		}
+		std::vector<unsigned int> v2(v1),v3(v1);
+		t0 = now_sec();
+		std::sort(v1.begin(),v1.end());
+		t1 = now_sec();
+		parallel_sort(&pool,v2.begin(),v2.end());
+		t2 = now_sec();
+		double psort = t2 - t1;
+		report("sort",n,t1 - t0,psort,v1 == v2);
+		t0 = now_sec();
+		std::stable_sort(v3.begin(),v3.end());
+		t1 = now_sec();
+		report("stable_sort",n,t1 - t0,psort,v3 == v2);
+	}
+
+	threadPoolShutdown(&pool);
+	return 0;
+}
+
+//g++ -O2 ./09parallel.cpp ./threadPool.c -o 09parallel -lpthread
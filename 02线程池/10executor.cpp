@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "threadPoolExecutor.h"
+
+/*
+每个任务的开销对比：./10executor [tasks] [workers]
+任务本身只是把一个计数器加1，测的是提交、调度、执行、回收的总开销（纳秒/任务）
+1.C malloc：nJob和参数都malloc，任务中free（01threadPool.c原来的写法）
+2.C slots：任务槽和内联参数区
+3.post lambda：pool_executor.post，捕获两个指针，放在任务槽中
+4.post unique_ptr：捕获std::unique_ptr（只能移动），放在任务槽中
+5.post args：post(f,a,b)完美转发两个参数
+6.post big：捕获128字节的数组，放不下任务槽，走堆节点
+7.submit+get：返回pool_future，多一个共享状态的分配
+8.std::async：每个任务一个线程，任务数减少到1/100
+*/
+
+static std::atomic<long> counter(0);
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void wait_count(long total){
+	while(counter.load(std::memory_order_acquire) < total){
+		usleep(50);
+	}
+}
+
+static void c_malloc_job(nJob *job){
+	long *arg = (long *)job->user_data;
+	counter.fetch_add(*arg,std::memory_order_release);
+	free(job->user_data);
+	free(job);
+}
+
+static void c_slot_job(nJob *job){
+	counter.fetch_add(*(long *)job->user_data,std::memory_order_release);
+}
+
+static void report(const char *name,long tasks,double spend){
+	printf("%-18s %10.0f ns/task %12.0f tasks/s\n",name,spend * 1e9 / tasks,tasks / spend);
+}
+
+static nThreadPoolAttr make_attr(){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.job_slots = 4096;
+	return attr;
+}
+
+int main(int argc,char *argv[]){
+	long tasks = argc > 1 ? atol(argv[1]) : 1000000;
+	int workers = argc > 2 ? atoi(argv[2]) : 4;
+	printf("tasks:%ld workers:%d slot payload:%d bytes\n",tasks,workers,THREADPOOL_SLOT_PAYLOAD);
+	nThreadPoolAttr attr = make_attr();
+
+	{
+		nThreadPool pool;
+		threadPoolCreateEx(&pool,workers,&attr);
+		counter = 0;
+		double start = now_sec();
+		for(long i = 0;i < tasks;i++){
+			nJob *job = (nJob *)malloc(sizeof(nJob));
+			job->user_data = malloc(sizeof(long));
+			*(long *)job->user_data = 1;
+			job->job_function = c_malloc_job;
+			threadPoolQueue(&pool,job);
+		}
+		wait_count(tasks);
+		report("C malloc",tasks,now_sec() - start);
+
+		counter = 0;
+		start = now_sec();
+		for(long i = 0;i < tasks;i++){
+			nJob *job;
+			while((job = threadPoolJobAlloc(&pool)) == NULL){
+				sched_yield();
+			}
+			*(long *)job->user_data = 1;
+			job->job_function = c_slot_job;
+			threadPoolQueue(&pool,job);
+		}
+		wait_count(tasks);
+		report("C slots",tasks,now_sec() - start);
+		threadPoolShutdown(&pool);
+	}
+
+	{
+		pool_executor exec(workers,&attr);
+		long one = 1;
+		long *pone = &one;
+
+		counter = 0;
+		double start = now_sec();
+		for(long i = 0;i < tasks;i++){
+			exec.post([pone]{ counter.fetch_add(*pone,std::memory_order_release); });
+		}
+		exec.wait_idle();
+		report("post lambda",tasks,now_sec() - start);
+
+		counter = 0;
+		start = now_sec();
+		for(long i = 0;i < tasks;i++){
+			std::unique_ptr<long> p(new long(1));
+			exec.post([p = std::move(p)]{ counter.fetch_add(*p,std::memory_order_release); });
+		}
+		exec.wait_idle();
+		report("post unique_ptr",tasks,now_sec() - start);
+
+		counter = 0;
+		start = now_sec();
+		for(long i = 0;i < tasks;i++){
+			exec.post([](long a,long b){ counter.fetch_add(a - b,std::memory_order_release); },2L,1L);
+		}
+		exec.wait_idle();
+		report("post args",tasks,now_sec() - start);
+
+		counter = 0;
+		start = now_sec();
+		for(long i = 0;i < tasks;i++){
+			struct { long v[16]; } big;
+			big.v[0] = 1;
+			exec.post([big]{ counter.fetch_add(big.v[0],std::memory_order_release); });
+		}
+		exec.wait_idle();
+		report("post big (heap)",tasks,now_sec() - start);
+
+		counter = 0;
+		start = now_sec();
+		std::vector<pool_future<long>> results;
+		results.reserve(tasks);
+		for(long i = 0;i < tasks;i++){
+			results.push_back(exec.submit([](long x){ counter.fetch_add(1,std::memory_order_release); return x; },i));
+		}
+		long sum = 0;
+		for(auto &f : results){
+			sum += f.get();
+		}
+		report("submit+get",tasks,now_sec() - start);
+		if(sum != tasks * (tasks - 1) / 2){
+			printf("wrong sum %ld\n",sum);
+		}
+	}
+
+	{
+		long n = tasks / 100 > 0 ? tasks / 100 : 1;
+		counter = 0;
+		double start = now_sec();
+		std::vector<std::future<void>> fs;
+		fs.reserve(n);
+		for(long i = 0;i < n;i++){
+			fs.push_back(std::async(std::launch::async,[]{ counter.fetch_add(1,std::memory_order_release); }));
+		}
+		for(auto &f : fs){
+			f.get();
+		}
+		report("std::async",n,now_sec() - start);
+	}
+	return 0;
+}
+
+//g++ -O2 ./10executor.cpp ./threadPool.c -o 10executor -lpthread
@@ -0,0 +1,152 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE								//sched_getcpu
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <sched.h>
+
+#include "threadPool.h"
+
+/*
+CPU绑定和NUMA节点通道的演示：./11numa [nodes] [workers] [affinity(0不绑定,1绑定节点,2绑定CPU)] [cpu_list]
+nodes为0时读取/sys/devices/system/node中的节点，大于0时把CPU平均分成nodes组（单路机器上也能看到节点通道的效果）
+1.每个节点一块数据，由这个节点的线程第一次写入（first touch），内存页就分配在这个节点上
+2.把数据切成小块求和，每块一个任务，分别用threadPoolQueue（不指定节点）和threadPoolQueueNode（指定数据所在的节点）提交
+  统计任务在数据所在节点上执行的比例和耗时；双路机器上指定节点的方式没有跨节点的内存访问
+*/
+
+#define NODE_BYTES		(64L << 20)				//每个节点的数据大小
+#define CHUNK_BYTES		(256L << 10)			//每个任务处理的数据大小
+#define ROUNDS			10
+
+typedef struct {
+	nJob job;									//必须是第一个成员
+	int node;									//数据所在的节点
+	long *data;
+	long len;
+	int ranNode;								//实际执行的节点
+	int cpu;
+	long sum;
+} nChunkJob;
+
+static nThreadPool pool;
+static long *nodeData[THREADPOOL_MAX_NODES];
+static long doneJobs;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void wait_done(long total){
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < total){
+		usleep(100);
+	}
+}
+
+//在节点的线程中分配并写入数据
+static void touch_job(nJob *job){
+	nChunkJob *c = (nChunkJob *)job;
+	long n = NODE_BYTES / sizeof(long);
+	long *data = (long *)malloc(NODE_BYTES);
+	for(long i = 0;i < n;i++){
+		data[i] = i & 0xff;
+	}
+	nodeData[c->node] = data;
+	c->ranNode = threadPoolCurrentNode(&pool);
+	c->cpu = sched_getcpu();
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void sum_job(nJob *job){
+	nChunkJob *c = (nChunkJob *)job;
+	long sum = 0;
+	for(long i = 0;i < c->len;i++){
+		sum += c->data[i];
+	}
+	c->sum = sum;
+	c->ranNode = threadPoolCurrentNode(&pool);
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void run(nChunkJob *chunks,size_t count,int hinted,const char *name){
+	int nodes = threadPoolNodes(&pool);
+	long local = 0;
+	double start = now_sec();
+	for(int r = 0;r < ROUNDS;r++){
+		doneJobs = 0;
+		for(size_t i = 0;i < count;i++){
+			chunks[i].job.job_function = sum_job;
+			chunks[i].ranNode = -1;
+			if(hinted){
+				threadPoolQueueNode(&pool,&chunks[i].job,chunks[i].node);
+			}else{
+				threadPoolQueue(&pool,&chunks[i].job);
+			}
+		}
+		wait_done(count);
+		for(size_t i = 0;i < count;i++){
+			local += chunks[i].ranNode == chunks[i].node;
+		}
+	}
+	double spend = now_sec() - start;
+	printf("%-10s %8.3fs %8.2f GB/s  on data node %5.1f%%  remote pops:%llu steals:%llu\n",name,spend,
+		(double)NODE_BYTES * nodes * ROUNDS / spend / 1e9,100.0 * local / (count * ROUNDS),
+		pool.remote_pops,pool.remote_steals);
+}
+
+int main(int argc,char *argv[]){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.numa = 1;
+	attr.nodes = argc > 1 ? atoi(argv[1]) : 0;
+	int workers = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	attr.affinity = argc > 3 ? atoi(argv[3]) : THREADPOOL_AFFINITY_NODE;
+	attr.cpu_list = argc > 4 ? argv[4] : NULL;
+
+	if(threadPoolCreateEx(&pool,workers,&attr) != 0){
+		return 1;
+	}
+	int nodes = threadPoolNodes(&pool);
+	printf("workers:%d nodes:%d affinity:%d cpus:%ld\n",threadPoolSize(&pool),nodes,attr.affinity,sysconf(_SC_NPROCESSORS_ONLN));
+
+	nChunkJob touch[THREADPOOL_MAX_NODES];
+	memset(touch,0,sizeof(touch));
+	doneJobs = 0;
+	for(int n = 0;n < nodes;n++){
+		touch[n].node = n;
+		touch[n].job.job_function = touch_job;
+		threadPoolQueueNode(&pool,&touch[n].job,n);
+	}
+	wait_done(nodes);
+	for(int n = 0;n < nodes;n++){
+		printf("node %d: data written by a worker of node %d on cpu %d\n",n,touch[n].ranNode,touch[n].cpu);
+	}
+
+	size_t perNode = NODE_BYTES / CHUNK_BYTES;
+	size_t count = perNode * nodes;
+	nChunkJob *chunks = (nChunkJob *)calloc(count,sizeof(nChunkJob));
+	for(size_t i = 0;i < count;i++){
+		int n = (int)(i % nodes);								//各节点的数据块交替提交
+		chunks[i].node = n;
+		chunks[i].len = CHUNK_BYTES / sizeof(long);
+		chunks[i].data = nodeData[n] + (i / nodes) * chunks[i].len;
+	}
+
+	run(chunks,count,0,"no hint");
+	run(chunks,count,1,"node hint");
+
+	threadPoolShutdown(&pool);
+	for(int n = 0;n < nodes;n++){
+		free(nodeData[n]);
+	}
+	free(chunks);
+	return 0;
+}
+
+//gcc -O2 ./11numa.c ./threadPool.c -o 11numa -lpthread
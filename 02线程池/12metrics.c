@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "threadPool.h"
+
+/*
+线程池统计的演示：./12metrics [sched(0全局队列,1工作窃取)] [interval_ms]
+线程数在2到8之间变化，每interval_ms毫秒输出一次两次之间的统计，负载分成三个阶段：
+1.light：每200微秒提交一个100微秒的任务，线程大部分时间空闲
+2.burst：4个生产者连续提交，任务排队，线程忙碌比例接近100%，线程数增加
+3.idle：不提交任务，线程数逐渐回到最小值
+最后输出整个运行过程的累计统计
+*/
+
+#define JOB_US		100
+
+static nThreadPool pool;
+static long doneJobs;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void spin_job(nJob *job){
+	double end = now_sec() + JOB_US / 1e6;
+	while(now_sec() < end){
+	}
+	(void)job;
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELAXED);
+}
+
+static void submit_one(){
+	nJob *job;
+	while((job = threadPoolJobAlloc(&pool)) == NULL){
+		usleep(10);
+	}
+	job->job_function = spin_job;
+	threadPoolQueue(&pool,job);
+}
+
+static void *producer(void *arg){
+	double end = *(double *)arg;
+	while(now_sec() < end){
+		submit_one();
+	}
+	return NULL;
+}
+
+int main(int argc,char *argv[]){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = argc > 1 ? atoi(argv[1]) : THREADPOOL_SCHED_STEALING;
+	int interval = argc > 2 ? atoi(argv[2]) : 500;
+	attr.min_workers = 2;
+	attr.max_workers = 8;
+	attr.idle_timeout_ms = 300;
+	attr.job_slots = 4096;
+	threadPoolCreateEx(&pool,2,&attr);
+	threadPoolStatsStart(&pool,interval,stdout);
+
+	printf("=== light ===\n");
+	double end = now_sec() + 1.0;
+	while(now_sec() < end){
+		submit_one();
+		usleep(200);
+	}
+
+	printf("=== burst ===\n");
+	end = now_sec() + 1.0;
+	pthread_t producers[4];
+	for(int i = 0;i < 4;i++){
+		pthread_create(&producers[i],NULL,producer,&end);
+	}
+	for(int i = 0;i < 4;i++){
+		pthread_join(producers[i],NULL);
+	}
+
+	printf("=== idle ===\n");
+	usleep(1500 * 1000);
+
+	nThreadPoolStats stats;
+	threadPoolStats(&pool,&stats);
+	printf("=== total: %ld jobs ===\n",__atomic_load_n(&doneJobs,__ATOMIC_RELAXED));
+	threadPoolStatsPrint(&stats,NULL,stdout);
+	threadPoolShutdown(&pool);
+	return 0;
+}
+
+//gcc -O2 ./12metrics.c ./threadPool.c -o 12metrics -lpthread
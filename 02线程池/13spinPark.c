@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "threadPool.h"
+
+/*
+提交到开始执行的延迟：./13spinPark [workers] [jobs] [sched(0全局队列,1工作窃取)]
+每个任务在提交前记下时间，开始执行时计算延迟，统计p50/p99/max（纳秒）
+提交方式：每次提交burst个任务，然后停顿gap微秒，线程在停顿时变成空闲
+1.gap小于自旋时间：线程还在自旋，任务到达时直接取走，不需要睡眠和唤醒
+2.gap大于自旋时间：线程已经睡眠，和spin_us=0一样要经过futex唤醒
+对比spin_us为0（直接睡眠）和默认值、更长的自旋时间；只有一个CPU时自旋的线程和提交者抢CPU，自旋没有好处
+*/
+
+typedef struct {
+	unsigned long long submit_ns;
+} nLatencyArg;
+
+static unsigned long long *latency;
+static long doneJobs;
+
+static unsigned long long now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void latency_job(nJob *job){
+	nLatencyArg *arg = (nLatencyArg *)job->user_data;
+	unsigned long long now = now_ns();
+	long idx = __atomic_fetch_add(&doneJobs,1,__ATOMIC_RELAXED);
+	latency[idx] = now - arg->submit_ns;
+}
+
+static int cmp_ull(const void *a,const void *b){
+	unsigned long long x = *(const unsigned long long *)a,y = *(const unsigned long long *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void run(int sched,int workers,long jobs,int spin_us,int burst,int gap_us){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = sched;
+	attr.spin_us = spin_us;
+	attr.job_slots = 1024;
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	doneJobs = 0;
+
+	for(long i = 0;i < jobs;i += burst){
+		for(int b = 0;b < burst && i + b < jobs;b++){
+			nJob *job;
+			while((job = threadPoolJobAlloc(&pool)) == NULL){
+				sched_yield();
+			}
+			job->job_function = latency_job;
+			((nLatencyArg *)job->user_data)->submit_ns = now_ns();
+			threadPoolQueue(&pool,job);
+		}
+		usleep(gap_us);											//提交者睡眠，只有一个CPU时线程也能运行
+	}
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < jobs){
+		usleep(100);
+	}
+
+	nThreadPoolStats stats;
+	threadPoolStats(&pool,&stats);
+	threadPoolShutdown(&pool);
+
+	qsort(latency,jobs,sizeof(unsigned long long),cmp_ull);
+	printf("spin %4dus burst %d gap %4dus: p50 %8llu p99 %8llu max %9llu ns | spin hits %6llu parks %6llu unparks %6llu\n",
+		spin_us,burst,gap_us,latency[jobs / 2],latency[jobs * 99 / 100],latency[jobs - 1],stats.spin_hits,stats.parks,stats.unparks);
+}
+
+int main(int argc,char *argv[]){
+	int workers = argc > 1 ? atoi(argv[1]) : 4;
+	long jobs = argc > 2 ? atol(argv[2]) : 20000;
+	int sched = argc > 3 ? atoi(argv[3]) : THREADPOOL_SCHED_STEALING;
+	latency = (unsigned long long *)malloc(sizeof(unsigned long long) * jobs);
+	printf("workers:%d jobs:%ld cpus:%ld sched:%d\n",workers,jobs,sysconf(_SC_NPROCESSORS_ONLN),sched);
+
+	int spins[] = {0,THREADPOOL_SPIN_US,200};
+	int gaps[] = {20,100,1000};
+	for(int g = 0;g < 3;g++){
+		for(int s = 0;s < 3;s++){
+			run(sched,workers,jobs,spins[s],1,gaps[g]);
+		}
+	}
+	for(int s = 0;s < 3;s++){
+		run(sched,workers,jobs,spins[s],8,100);
+	}
+	free(latency);
+	return 0;
+}
+
+//gcc -O2 ./13spinPark.c ./threadPool.c -o 13spinPark -lpthread
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "threadPool.h"
+
+/*
+定时任务的演示：./14timers [timers] [workers] [sched(0全局队列,1工作窃取)]
+1.精度：1000个一次性任务，延迟在1到100毫秒之间，统计实际开始执行比到期时间晚多少（p50/p99/max，微秒）
+2.规模：timers个一次性任务（默认一百万），延迟在0到2秒之间，插入之后取消一半；统计插入和取消的平均耗时，
+  确认执行的个数等于插入的个数减去取消成功的个数
+3.周期任务：每10毫秒一次，500毫秒之后取消，统计执行次数和相邻两次的间隔；取消时正在执行的话等timer_state变回NONE再释放
+*/
+
+typedef struct {
+	nJob job;									//必须是第一个成员
+	unsigned long long due_ns;					//期望的执行时间
+	unsigned long long ran_ns;					//实际开始执行的时间
+} nTimerJob;
+
+static long doneJobs;
+
+static unsigned long long now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_ull(const void *a,const void *b){
+	unsigned long long x = *(const unsigned long long *)a,y = *(const unsigned long long *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void timer_job(nJob *job){
+	nTimerJob *t = (nTimerJob *)job;
+	t->ran_ns = now_ns();
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void wait_done(long total){
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < total){
+		usleep(1000);
+	}
+}
+
+static void accuracy(nThreadPool *pool){
+	int n = 1000;
+	nTimerJob *jobs = (nTimerJob *)calloc(n,sizeof(nTimerJob));
+	unsigned long long *late = (unsigned long long *)malloc(sizeof(unsigned long long) * n);
+	doneJobs = 0;
+	for(int i = 0;i < n;i++){
+		unsigned int delay = 1 + rand() % 100;
+		jobs[i].job.job_function = timer_job;
+		jobs[i].due_ns = now_ns() + delay * 1000000ULL;
+		threadPoolSchedule(pool,&jobs[i].job,delay);
+	}
+	wait_done(n);
+	for(int i = 0;i < n;i++){
+		late[i] = jobs[i].ran_ns > jobs[i].due_ns ? (jobs[i].ran_ns - jobs[i].due_ns) / 1000 : 0;
+	}
+	qsort(late,n,sizeof(unsigned long long),cmp_ull);
+	printf("accuracy: %d timers late(us) p50 %llu p99 %llu max %llu\n",n,late[n / 2],late[n * 99 / 100],late[n - 1]);
+	free(late);
+	free(jobs);
+}
+
+static void scale(nThreadPool *pool,long n){
+	nTimerJob *jobs = (nTimerJob *)calloc(n,sizeof(nTimerJob));
+	doneJobs = 0;
+	unsigned long long start = now_ns();
+	for(long i = 0;i < n;i++){
+		jobs[i].job.job_function = timer_job;
+		threadPoolSchedule(pool,&jobs[i].job,(unsigned int)(rand() % 2000));
+	}
+	unsigned long long inserted = now_ns();
+
+	long cancelled = 0;
+	for(long i = 0;i < n;i += 2){
+		cancelled += threadPoolCancel(pool,&jobs[i].job) == 0;
+	}
+	unsigned long long end = now_ns();
+	printf("scale: %ld timers insert %.0f ns/op cancel %.0f ns/op (%ld cancelled before firing)\n",
+		n,(double)(inserted - start) / n,(double)(end - inserted) / ((n + 1) / 2),cancelled);
+
+	wait_done(n - cancelled);
+	usleep(100 * 1000);											//多等一会儿，取消的任务不应该再执行
+	nThreadPoolStats stats;
+	threadPoolStats(pool,&stats);
+	printf("scale: fired %ld expected %ld pending timers %ld (%s)\n",__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE),n - cancelled,stats.timers,
+		__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) == n - cancelled && stats.timers == 0 ? "ok" : "WRONG");
+	free(jobs);
+}
+
+#define TICKS_MAX	256
+
+static unsigned long long ticks[TICKS_MAX];
+static long tickCount;
+
+static void tick_job(nJob *job){
+	long i = __atomic_fetch_add(&tickCount,1,__ATOMIC_RELAXED);
+	if(i < TICKS_MAX){
+		ticks[i] = now_ns();
+	}
+	(void)job;
+}
+
+static void periodic(nThreadPool *pool){
+	nJob job;
+	memset(&job,0,sizeof(job));
+	job.job_function = tick_job;
+	tickCount = 0;
+	threadPoolScheduleEvery(pool,&job,10,10);
+	usleep(500 * 1000);
+	int ret = threadPoolCancel(pool,&job);
+	while(__atomic_load_n(&job.timer_state,__ATOMIC_ACQUIRE) != THREADPOOL_TIMER_NONE){	//取消时正在执行，等线程池放手
+		usleep(100);
+	}
+
+	long n = tickCount < TICKS_MAX ? tickCount : TICKS_MAX;
+	unsigned long long minGap = ~0ULL,maxGap = 0,sum = 0;
+	for(long i = 1;i < n;i++){
+		unsigned long long gap = ticks[i] - ticks[i - 1];
+		minGap = gap < minGap ? gap : minGap;
+		maxGap = gap > maxGap ? gap : maxGap;
+		sum += gap;
+	}
+	printf("periodic: 10ms for 500ms ran %ld times (cancel returned %d) gap(us) avg %llu min %llu max %llu\n",
+		tickCount,ret,n > 1 ? sum / (n - 1) / 1000 : 0,n > 1 ? minGap / 1000 : 0,maxGap / 1000);
+}
+
+int main(int argc,char *argv[]){
+	long timers = argc > 1 ? atol(argv[1]) : 1000000;
+	int workers = argc > 2 ? atoi(argv[2]) : 4;
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = argc > 3 ? atoi(argv[3]) : THREADPOOL_SCHED_STEALING;
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	printf("timers:%ld workers:%d sched:%d\n",timers,workers,attr.sched);
+
+	accuracy(&pool);
+	scale(&pool,timers);
+	periodic(&pool);
+
+	nThreadPoolStats stats;
+	threadPoolStats(&pool,&stats);
+	threadPoolStatsPrint(&stats,NULL,stdout);
+	threadPoolShutdown(&pool);
+	return 0;
+}
+
+//gcc -O2 ./14timers.c ./threadPool.c -o 14timers -lpthread
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <vector>
+
+#include "threadPoolCoroutine.h"
+#include "threadPoolFuture.h"
+
+/*
+协程和线程池：./15coroutine [hops] [workers] [connections] [depth]
+1.深度递归：depth层pool_task一层层co_await，完成时对称转移回上一层，栈不会随深度增长（默认栈8MB，普通递归resume会溢出）
+  对称转移要编译成尾调用，需要-O2；-O0和sanitizer下不是尾调用，depth要改小
+2.切换线程的开销：协程中循环co_await schedule_on(pool)，每次挂起、提交、在工作线程中恢复；对比pool_submit+get
+3.when_all：一个协程中并发启动8个子任务，每个子任务先切换到线程池再计算
+4.epoll：connections个socketpair，服务端每个连接一个协程，co_await reactor.readable读到请求就回写（echo），
+  客户端线程逐个连接发送请求、阻塞读取回复，统计每秒往返次数；处理流程是顺序的代码，没有回调
+*/
+
+static nThreadPool pool;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//=========================1.深度递归=========================
+static pool_task<long> sum_to(long n){
+	if(n == 0){
+		co_return 0;
+	}
+	long below = co_await sum_to(n - 1);
+	co_return n + below;
+}
+
+//=========================2.切换线程=========================
+static pool_task<long> hop_loop(long hops){
+	long onPool = 0;
+	for(long i = 0;i < hops;i++){
+		co_await schedule_on(&pool);
+		onPool += threadPoolCurrentNode(&pool) >= 0;			//恢复之后在线程池的线程中
+	}
+	co_return onPool;
+}
+
+//=========================3.when_all=========================
+static pool_task<long> square_on_pool(long x){
+	co_await schedule_on(&pool);
+	co_return x * x;
+}
+
+static pool_task<void> fail_on_pool(){
+	co_await schedule_on(&pool);
+	throw std::runtime_error("child failed");
+}
+
+static pool_task<long> fan_out(){
+	auto [a,b,c,d] = co_await when_all(square_on_pool(1),square_on_pool(2),square_on_pool(3),square_on_pool(4));
+	std::vector<pool_task<long>> more;
+	for(long i = 5;i <= 8;i++){
+		more.push_back(square_on_pool(i));
+	}
+	std::vector<long> rest = co_await when_all(std::move(more));
+	long sum = a + b + c + d;
+	for(long v : rest){
+		sum += v;
+	}
+	co_return sum;
+}
+
+static pool_task<int> fan_out_error(){
+	try{
+		co_await when_all(square_on_pool(1),fail_on_pool());
+	}catch(const std::exception &e){
+		printf("when_all rethrew: %s\n",e.what());
+		co_return 1;
+	}
+	co_return 0;
+}
+
+//=========================4.epoll echo=========================
+static std::atomic<long> served(0);
+static std::atomic<int> closed(0);
+
+static pool_task<void> echo_session(pool_reactor *reactor,int fd){
+	char buf[256];
+	while(1){
+		int ev = co_await reactor->readable(fd);				//等待可读，在线程池中恢复
+		if(ev < 0){
+			break;
+		}
+		ssize_t n = read(fd,buf,sizeof(buf));
+		if(n == 0 || (n < 0 && errno != EAGAIN)){
+			break;												//客户端关闭
+		}
+		if(n > 0){
+			ssize_t ret = write(fd,buf,n);						//回复很短，socketpair的缓冲区一定放得下
+			(void)ret;
+			served.fetch_add(1,std::memory_order_relaxed);
+		}
+	}
+	reactor->forget(fd);
+	close(fd);
+	closed.fetch_add(1,std::memory_order_release);
+}
+
+static void echo_bench(int conns,long rounds){
+	pool_reactor reactor(&pool);
+	std::vector<int> clients(conns);
+	for(int i = 0;i < conns;i++){
+		int sv[2];
+		socketpair(AF_UNIX,SOCK_STREAM,0,sv);
+		fcntl(sv[1],F_SETFL,fcntl(sv[1],F_GETFL) | O_NONBLOCK);	//服务端非阻塞，客户端阻塞
+		clients[i] = sv[0];
+		pool_spawn(&pool,echo_session(&reactor,sv[1]));
+	}
+
+	double start = now_sec();
+	char req[32],resp[32];
+	for(long r = 0;r < rounds;r++){
+		int fd = clients[r % conns];
+		int len = snprintf(req,sizeof(req),"req %ld",r);
+		ssize_t ret = write(fd,req,len);
+		ret = read(fd,resp,sizeof(resp));
+		if(ret != len || memcmp(req,resp,len) != 0){
+			printf("echo mismatch at %ld\n",r);
+			break;
+		}
+	}
+	double spend = now_sec() - start;
+	printf("epoll echo: %d connections %ld round trips %.0f/s (%.1f us each)\n",conns,rounds,rounds / spend,spend * 1e6 / rounds);
+
+	for(int fd : clients){
+		close(fd);												//服务端协程读到0之后结束
+	}
+	while(closed.load(std::memory_order_acquire) < conns){		//协程都结束之后才能停止事件线程
+		usleep(100);
+	}
+}
+
+int main(int argc,char *argv[]){
+	long hops = argc > 1 ? atol(argv[1]) : 200000;
+	int workers = argc > 2 ? atoi(argv[2]) : 4;
+	int conns = argc > 3 ? atoi(argv[3]) : 16;
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	threadPoolCreateEx(&pool,workers,&attr);
+	printf("hops:%ld workers:%d connections:%d\n",hops,workers,conns);
+
+	long depth = argc > 4 ? atol(argv[4]) : 100000;
+	long sum = sync_wait(sum_to(depth));
+	printf("recursion depth %ld: sum %ld (%s)\n",depth,sum,sum == depth * (depth + 1) / 2 ? "ok" : "WRONG");
+
+	double start = now_sec();
+	long onPool = sync_wait(hop_loop(hops));
+	double spend = now_sec() - start;
+	printf("schedule_on: %ld hops %.0f ns/hop (%ld resumed on pool)\n",hops,spend * 1e9 / hops,onPool);
+
+	start = now_sec();
+	long total = 0;
+	for(long i = 0;i < hops;i++){
+		total += pool_submit(&pool,[]{ return 1L; }).get();
+	}
+	spend = now_sec() - start;
+	printf("pool_submit+get: %ld tasks %.0f ns/task\n",total,spend * 1e9 / hops);
+
+	long squares = sync_wait(fan_out());
+	printf("when_all: sum of squares 1..8 = %ld (%s)\n",squares,squares == 204 ? "ok" : "WRONG");
+	sync_wait(fan_out_error());
+
+	echo_bench(conns,hops / 4);
+
+	threadPoolShutdown(&pool);
+	return 0;
+}
+
+//g++ -std=c++20 -O2 ./15coroutine.cpp ./threadPool.c -o 15coroutine -lpthread
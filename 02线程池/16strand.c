@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+
+#include "threadPool.h"
+
+/*
+串行队列（strand）和每个会话一把锁的对比：./16strand [sessions] [producers] [jobs] [workers] [work]
+producers个提交线程，每个提交jobs个任务，轮流提交到各个会话；任务修改会话的状态，修改时空转work次（临界区的长度）
+1.mutex：任务直接放入线程池，执行时加会话自己的锁；同一个会话的任务在多个线程上同时执行时互相等待，占着线程阻塞
+2.strand：每个会话一个strand，任务提交到会话的strand，不加锁；同一个会话的任务不会同时执行，线程不会阻塞在会话上
+检查：每个会话的计数等于提交的任务数；strand中每个提交者的任务按提交顺序执行（序号递增），mutex版本不保证顺序
+sessions小的时候（几个热点会话）锁竞争最严重，strand把同一个会话的任务串行化，其他线程去执行其他会话的任务
+*/
+
+typedef struct {
+	pthread_mutex_t mtx;						//只有mutex版本使用
+	nStrand strand;								//只有strand版本使用
+	long count;									//会话的状态：执行的任务数
+	long last_seq[64];							//每个提交者最后执行的任务序号，用于检查顺序
+	long out_of_order;
+} __attribute__((aligned(64))) nSession;
+
+typedef struct {
+	nSession *session;
+	int producer;
+	long seq;
+} nSessionArg;
+
+static nThreadPool pool;
+static nSession *sessions;
+static int sessionCount;
+static long jobsPerProducer;
+static int work;
+static int useStrand;
+static long doneJobs;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void touch_session(nSessionArg *arg){
+	nSession *s = arg->session;
+	s->count++;
+	if(arg->seq <= s->last_seq[arg->producer]){
+		s->out_of_order++;
+	}
+	s->last_seq[arg->producer] = arg->seq;
+	for(volatile int i = 0;i < work;i++){
+	}
+}
+
+static void mutex_job(nJob *job){
+	nSessionArg *arg = (nSessionArg *)job->user_data;
+	pthread_mutex_lock(&arg->session->mtx);
+	touch_session(arg);
+	pthread_mutex_unlock(&arg->session->mtx);
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void strand_job(nJob *job){
+	nSessionArg *arg = (nSessionArg *)job->user_data;
+	touch_session(arg);											//只有这个会话的strand访问，不加锁
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void *producer(void *p){
+	int id = (int)(long)p;
+	for(long i = 0;i < jobsPerProducer;i++){
+		nJob *job;
+		while((job = threadPoolJobAlloc(&pool)) == NULL){
+			sched_yield();
+		}
+		nSessionArg *arg = (nSessionArg *)job->user_data;
+		arg->session = &sessions[(i + id) % sessionCount];
+		arg->producer = id;
+		arg->seq = i + 1;
+		if(useStrand){
+			job->job_function = strand_job;
+			threadPoolStrandPost(&arg->session->strand,job);
+		}else{
+			job->job_function = mutex_job;
+			threadPoolQueue(&pool,job);
+		}
+	}
+	return NULL;
+}
+
+static void run(int strand,int producers){
+	useStrand = strand;
+	doneJobs = 0;
+	memset(sessions,0,sizeof(nSession) * sessionCount);
+	for(int i = 0;i < sessionCount;i++){
+		pthread_mutex_init(&sessions[i].mtx,NULL);
+		threadPoolStrandInit(&pool,&sessions[i].strand);
+	}
+	nThreadPoolStats before;
+	threadPoolStats(&pool,&before);
+
+	double start = now_sec();
+	pthread_t threads[64];
+	for(int i = 0;i < producers;i++){
+		pthread_create(&threads[i],NULL,producer,(void *)(long)i);
+	}
+	for(int i = 0;i < producers;i++){
+		pthread_join(threads[i],NULL);
+	}
+	long total = jobsPerProducer * producers;
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < total){
+		usleep(100);
+	}
+	double spend = now_sec() - start;
+
+	nThreadPoolStats after;
+	threadPoolStats(&pool,&after);
+	long sum = 0,disorder = 0;
+	unsigned long long turns = 0,poolJobs = 0;
+	for(int i = 0;i < after.worker_count;i++){
+		poolJobs += after.workers[i].jobs - (i < before.worker_count ? before.workers[i].jobs : 0);
+	}
+	for(int i = 0;i < sessionCount;i++){
+		while(threadPoolStrandPending(&sessions[i].strand) != 0){	//最后一个任务计数之后runner还没有减pending
+			usleep(10);
+		}
+		sum += sessions[i].count;
+		disorder += sessions[i].out_of_order;
+		turns += sessions[i].strand.turns;
+		pthread_mutex_destroy(&sessions[i].mtx);
+	}
+	printf("%-6s sessions %4d: %.0f jobs/s pool jobs %8llu strand turns %8llu count %ld (%s) out of order %ld\n",
+		strand ? "strand" : "mutex",sessionCount,total / spend,poolJobs,turns,
+		sum,sum == total ? "ok" : "WRONG",disorder);
+}
+
+int main(int argc,char *argv[]){
+	int maxSessions = argc > 1 ? atoi(argv[1]) : 256;
+	int producers = argc > 2 ? atoi(argv[2]) : 4;
+	jobsPerProducer = argc > 3 ? atol(argv[3]) : 200000;
+	int workers = argc > 4 ? atoi(argv[4]) : 8;
+	work = argc > 5 ? atoi(argv[5]) : 200;
+	if(producers > 64){
+		producers = 64;
+	}
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.job_slots = 4096;
+	threadPoolCreateEx(&pool,workers,&attr);
+	printf("producers:%d jobs:%ld workers:%d work:%d cpus:%ld\n",producers,jobsPerProducer,workers,work,sysconf(_SC_NPROCESSORS_ONLN));
+
+	void *mem = NULL;
+	posix_memalign(&mem,64,sizeof(nSession) * maxSessions);		//会话按缓存行对齐，run中清零
+	sessions = (nSession *)mem;
+	for(sessionCount = 1;sessionCount <= maxSessions;sessionCount *= 16){
+		run(0,producers);
+		run(1,producers);
+	}
+	threadPoolShutdown(&pool);
+	free(sessions);
+	return 0;
+}
+
+//gcc -O2 ./16strand.c ./threadPool.c -o 16strand -lpthread
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "threadPool.h"
+
+/*
+任务的取消和截止时间：./17cancel [workers] [work_us] [deadline_ms] [seconds] [rate]
+1.过载：按rate个/秒均匀提交任务（默认是线程池处理能力的1.5倍），每个任务空转work_us微秒，请求方只等deadline_ms毫秒
+  不设截止时间：所有任务都执行，积压越来越多，后面的任务完成时请求方早就放弃了，CPU都花在没人要的结果上
+  设截止时间：开始时已经过期的任务直接丢弃，线程只执行还来得及的任务，积压不会无限增长
+  统计执行的个数、按时完成的个数（有效吞吐）、丢弃的个数和完成延迟的p50/p99
+2.取消：提交之后立即取消一半，确认取消成功的任务都没有执行、每个都调用了一次drop_function，执行数+丢弃数=提交数
+*/
+
+typedef struct {
+	nJob job;									//必须是第一个成员
+	unsigned long long submit_ns;
+	unsigned long long done_ns;
+	int ran;
+	int dropped;
+} nRequest;
+
+static int workUs;
+static unsigned long long deadlineNs;
+static long doneJobs;							//执行或者丢弃的任务数
+
+static unsigned long long now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_ull(const void *a,const void *b){
+	unsigned long long x = *(const unsigned long long *)a,y = *(const unsigned long long *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void request_job(nJob *job){
+	nRequest *req = (nRequest *)job;
+	unsigned long long end = now_ns() + workUs * 1000ULL;
+	while(now_ns() < end){
+	}
+	req->done_ns = now_ns();
+	req->ran++;
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void request_drop(nJob *job,int reason){
+	nRequest *req = (nRequest *)job;
+	req->dropped = reason;
+	__atomic_add_fetch(&doneJobs,1,__ATOMIC_RELEASE);
+}
+
+static void overload(nThreadPool *pool,int deadline,int seconds,long rate){
+	long n = rate * seconds;
+	nRequest *reqs = (nRequest *)calloc(n,sizeof(nRequest));
+	unsigned long long *latency = (unsigned long long *)malloc(sizeof(unsigned long long) * n);
+	nThreadPoolStats before,after;
+	threadPoolStats(pool,&before);
+	doneJobs = 0;
+
+	unsigned long long start = now_ns();
+	for(long i = 0;i < n;i++){
+		unsigned long long due = start + (unsigned long long)(i * 1e9 / rate);
+		unsigned long long now = now_ns();
+		if(due > now + 1000000){
+			usleep((due - now) / 1000);							//提前太多就睡一会儿，按均匀的速率提交
+		}
+		nRequest *req = &reqs[i];
+		req->job.job_function = request_job;
+		req->job.drop_function = request_drop;
+		req->submit_ns = now_ns();
+		if(deadline){
+			threadPoolQueueDeadline(pool,&req->job,THREADPOOL_PRIO_NORMAL,(unsigned int)(deadlineNs / 1000000));
+		}else{
+			threadPoolQueue(pool,&req->job);
+		}
+	}
+	unsigned long long submitted = now_ns();
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < n){
+		usleep(1000);
+	}
+	unsigned long long drained = now_ns();
+	threadPoolStats(pool,&after);
+
+	long ran = 0,onTime = 0,dropped = 0;
+	for(long i = 0;i < n;i++){
+		if(reqs[i].ran){
+			latency[ran++] = reqs[i].done_ns - reqs[i].submit_ns;
+			onTime += reqs[i].done_ns - reqs[i].submit_ns <= deadlineNs;
+		}
+		dropped += reqs[i].dropped != 0;
+	}
+	qsort(latency,ran,sizeof(unsigned long long),cmp_ull);
+	printf("%-11s submitted %ld in %.2fs, drained %.2fs later: ran %ld on time %ld (%.0f/s) dropped %ld | latency(ms) p50 %.1f p99 %.1f | stats executed %llu expired %llu\n",
+		deadline ? "deadline" : "no deadline",n,(submitted - start) / 1e9,(drained - submitted) / 1e9,ran,onTime,onTime / ((drained - start) / 1e9),dropped,
+		ran > 0 ? latency[ran / 2] / 1e6 : 0.0,ran > 0 ? latency[ran * 99 / 100] / 1e6 : 0.0,
+		after.executed - before.executed,after.dropped_expired - before.dropped_expired);
+	free(latency);
+	free(reqs);
+}
+
+static void cancel(nThreadPool *pool,long n){
+	nRequest *reqs = (nRequest *)calloc(n,sizeof(nRequest));
+	nThreadPoolStats before,after;
+	threadPoolStats(pool,&before);
+	doneJobs = 0;
+	long cancelled = 0;
+	for(long i = 0;i < n;i++){
+		reqs[i].job.job_function = request_job;
+		reqs[i].job.drop_function = request_drop;
+		threadPoolQueue(pool,&reqs[i].job);
+		if(i % 2 == 0){
+			cancelled += threadPoolJobCancel(pool,&reqs[i].job) == 0;	//已经开始的取消失败
+		}
+	}
+	while(__atomic_load_n(&doneJobs,__ATOMIC_ACQUIRE) < n){
+		usleep(1000);
+	}
+	threadPoolStats(pool,&after);
+
+	long ran = 0,dropped = 0,both = 0;
+	for(long i = 0;i < n;i++){
+		ran += reqs[i].ran;
+		dropped += reqs[i].dropped == THREADPOOL_DROP_CANCELLED;
+		both += reqs[i].ran && reqs[i].dropped;
+	}
+	int ok = dropped == cancelled && ran + dropped == n && both == 0 && after.dropped_cancelled - before.dropped_cancelled == (unsigned long long)cancelled;
+	printf("cancel: submitted %ld cancelled %ld ran %ld dropped %ld (%s)\n",n,cancelled,ran,dropped,ok ? "ok" : "WRONG");
+	free(reqs);
+}
+
+int main(int argc,char *argv[]){
+	int workers = argc > 1 ? atoi(argv[1]) : 4;
+	workUs = argc > 2 ? atoi(argv[2]) : 100;
+	int deadline = argc > 3 ? atoi(argv[3]) : 20;
+	int seconds = argc > 4 ? atoi(argv[4]) : 2;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	long capacity = (workers < cpus ? workers : cpus) * 1000000L / workUs;	//每秒能处理的任务数
+	long rate = argc > 5 ? atol(argv[5]) : capacity * 3 / 2;
+	deadlineNs = deadline * 1000000ULL;
+
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.capacity = 0;											//不限制队列长度，过载时积压全部留在队列中
+	nThreadPool pool;
+	threadPoolCreateEx(&pool,workers,&attr);
+	printf("workers:%d cpus:%ld work:%dus deadline:%dms rate:%ld/s (capacity about %ld/s)\n",workers,cpus,workUs,deadline,rate,capacity);
+
+	overload(&pool,0,seconds,rate);
+	overload(&pool,1,seconds,rate);
+	cancel(&pool,rate);
+
+	nThreadPoolStats stats;
+	threadPoolStats(&pool,&stats);
+	threadPoolStatsPrint(&stats,NULL,stdout);
+	threadPoolShutdown(&pool);
+	return 0;
+}
+
+//gcc -O2 ./17cancel.c ./threadPool.c -o 17cancel -lpthread
@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+
+#include <pthread.h>
+
+#include "threadPool.h"
+
+/*
+线程池基准测试：./18bench [-s 场景] [-w workers] [-p producers] [-g granularity_us] [-n jobs] [-q global|stealing|both] [-b batch] [-r repeat] [-S seed] [-f text|csv|json]
+场景（-s all运行全部，默认）：
+1.empty：空任务，只有提交、调度和完成计数的开销
+2.fixed：固定耗时的任务，-g指定耗时（微秒），没有指定时依次测1us、10us、1ms
+3.fanout：producers条链，每一轮由一个根任务在工作线程中提交fanout(-F，默认64)个子任务（耗时-g，默认1us），
+  最后一个完成的子任务（fan-in）提交下一轮的根任务；子任务的延迟从根任务提交它们开始算
+4.producer：多个提交者（没有指定-p时为8个）同时提交耗时为-g（默认0）的任务，提交端竞争最激烈
+5.mixed：按固定的随机种子混合三种耗时：89% 1us，10% 10us，1% 1ms，测大任务对小任务延迟的影响
+每个任务记录从提交到完成的时间，输出吞吐（任务数/从第一次提交到最后一个任务完成的时间）和延迟的p50/p90/p99/p99.9/max（微秒）
+任务数没有指定时按耗时自动选择，每种组合大约运行0.5秒（乘以CPU数），最多500000个；-q both对比全局队列和工作窃取两种调度方式
+-f csv/json输出机器可读的结果，每行（每个对象）一次运行，用于回归跟踪和对比不同的队列实现；repeat大于1时每种组合运行多次分别输出
+*/
+
+#define SCENE_EMPTY		0
+#define SCENE_FIXED		1
+#define SCENE_FANOUT	2
+#define SCENE_PRODUCER	3
+#define SCENE_MIXED		4
+#define SCENE_COUNT		5
+
+#define FORMAT_TEXT		0
+#define FORMAT_CSV		1
+#define FORMAT_JSON		2
+
+#define MAX_PRODUCERS	64
+
+static const char *sceneNames[SCENE_COUNT] = {"empty","fixed","fanout","producer","mixed"};
+
+typedef struct {
+	nJob job;									//必须是第一个成员
+	unsigned long long submit_ns;
+	unsigned int cost_ns;						//任务的耗时，0表示空任务
+	long index;									//在jobs数组中的下标，同时是latency的下标
+} nBenchJob;
+
+//一次运行的参数和结果
+typedef struct {
+	int scene;
+	int sched;
+	int workers;
+	int producers;
+	int granularity_us;							//mixed场景为-1
+	int batch;									//一次提交的任务数
+	int cpus;
+	long jobs;
+	double seconds;
+	double throughput;
+	unsigned long long p50,p90,p99,p999,max;	//微秒
+	double contended;							//jobs_mtx加锁时竞争的比例
+} nBenchResult;
+
+static nThreadPool pool;
+static nBenchJob *jobs;
+static unsigned long long *latency;				//每个任务从提交到完成的纳秒数
+static long totalJobs;
+static long doneJobs;
+static unsigned long long endNs;				//最后一个任务完成的时间
+static int batchSize = 1;
+static int fanout = 64;
+
+//fanout场景：第r轮的根任务是roots[r]，子任务是jobs[r*fanout..(r+1)*fanout)，remain是这一轮还没有完成的子任务数
+static nJob *roots;
+static long *remain;
+static long rounds;
+static int chains;
+
+static unsigned long long now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_ull(const void *a,const void *b){
+	unsigned long long x = *(const unsigned long long *)a,y = *(const unsigned long long *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void job_done(nBenchJob *bj){
+	unsigned long long now = now_ns();
+	latency[bj->index] = now - bj->submit_ns;
+	if(__atomic_add_fetch(&doneJobs,1,__ATOMIC_ACQ_REL) == totalJobs){
+		__atomic_store_n(&endNs,now,__ATOMIC_RELEASE);
+	}
+}
+
+static void spin_for(unsigned int cost_ns){
+	if(cost_ns == 0){
+		return;
+	}
+	unsigned long long end = now_ns() + cost_ns;
+	while(now_ns() < end){
+	}
+}
+
+static void bench_job(nJob *job){
+	nBenchJob *bj = (nBenchJob *)job;
+	spin_for(bj->cost_ns);
+	job_done(bj);
+}
+
+//=========================fanout=========================
+static void fanout_root(nJob *root);
+
+static void fanout_child(nJob *job){
+	nBenchJob *bj = (nBenchJob *)job;
+	long round = bj->index / fanout;
+	spin_for(bj->cost_ns);
+	int last = __atomic_sub_fetch(&remain[round],1,__ATOMIC_ACQ_REL) == 0;
+	job_done(bj);												//之后jobs可能已经全部完成，不再访问bj
+	if(last && round + chains < rounds){
+		roots[round + chains].job_function = fanout_root;		//fan-in：这一轮全部完成，开始这条链的下一轮
+		threadPoolQueue(&pool,&roots[round + chains]);
+	}
+}
+
+static void fanout_root(nJob *root){
+	long round = root - roots;
+	nJob *batch[256];
+	int n = 0;
+	unsigned long long now = now_ns();
+	for(long i = round * fanout;i < (round + 1) * fanout;i++){
+		jobs[i].job.job_function = fanout_child;
+		jobs[i].submit_ns = now;
+		batch[n++] = &jobs[i].job;
+		if(n == batchSize || n == 256){
+			if(n == 1){
+				threadPoolQueue(&pool,batch[0]);
+			}else{
+				threadPoolQueueBatch(&pool,batch,n);
+			}
+			n = 0;
+		}
+	}
+	if(n > 0){
+		threadPoolQueueBatch(&pool,batch,n);
+	}
+}
+
+//=========================提交者=========================
+typedef struct {
+	long begin;
+	long end;
+} nRange;
+
+static void *producer(void *p){
+	nRange *range = (nRange *)p;
+	nJob *batch[256];
+	int n = 0;
+	for(long i = range->begin;i < range->end;i++){
+		jobs[i].job.job_function = bench_job;
+		jobs[i].submit_ns = now_ns();
+		if(batchSize <= 1){
+			threadPoolQueue(&pool,&jobs[i].job);
+			continue;
+		}
+		batch[n++] = &jobs[i].job;
+		if(n == batchSize || n == 256 || i + 1 == range->end){
+			threadPoolQueueBatch(&pool,batch,n);
+			n = 0;
+		}
+	}
+	return NULL;
+}
+
+static void percentiles(nBenchResult *r,long n){
+	qsort(latency,n,sizeof(unsigned long long),cmp_ull);
+	r->p50 = latency[n / 2] / 1000;
+	r->p90 = latency[n * 90 / 100] / 1000;
+	r->p99 = latency[n * 99 / 100] / 1000;
+	r->p999 = latency[n * 999 / 1000] / 1000;
+	r->max = latency[n - 1] / 1000;
+}
+
+//按场景设置每个任务的耗时；mixed用固定种子的rand_r，每次运行相同
+static void setup_costs(int scene,int granularity_us,unsigned int seed){
+	for(long i = 0;i < totalJobs;i++){
+		memset(&jobs[i].job,0,sizeof(nJob));
+		jobs[i].index = i;
+		if(scene == SCENE_MIXED){
+			int x = rand_r(&seed) % 100;
+			jobs[i].cost_ns = x < 89 ? 1000 : x < 99 ? 10000 : 1000000;
+		}else{
+			jobs[i].cost_ns = scene == SCENE_EMPTY ? 0 : granularity_us * 1000;
+		}
+	}
+}
+
+static void run_once(nBenchResult *r,unsigned int seed){
+	nThreadPoolAttr attr;
+	threadPoolAttrInit(&attr);
+	attr.sched = r->sched;
+	threadPoolCreateEx(&pool,r->workers,&attr);
+	jobs = (nBenchJob *)malloc(sizeof(nBenchJob) * r->jobs);
+	latency = (unsigned long long *)malloc(sizeof(unsigned long long) * r->jobs);
+	totalJobs = r->jobs;
+	doneJobs = 0;
+	endNs = 0;
+	setup_costs(r->scene,r->granularity_us,seed);
+
+	nThreadPoolStats before,after;
+	threadPoolStats(&pool,&before);
+	unsigned long long start = now_ns();
+	if(r->scene == SCENE_FANOUT){
+		rounds = r->jobs / fanout;
+		chains = r->producers;
+		roots = (nJob *)calloc(rounds,sizeof(nJob));
+		remain = (long *)malloc(sizeof(long) * rounds);
+		for(long i = 0;i < rounds;i++){
+			remain[i] = fanout;
+		}
+		for(int c = 0;c < chains && c < rounds;c++){
+			roots[c].job_function = fanout_root;
+			threadPoolQueue(&pool,&roots[c]);
+		}
+	}else{
+		pthread_t threads[MAX_PRODUCERS];
+		nRange ranges[MAX_PRODUCERS];
+		for(int i = 0;i < r->producers;i++){
+			ranges[i].begin = r->jobs * i / r->producers;
+			ranges[i].end = r->jobs * (i + 1) / r->producers;
+			pthread_create(&threads[i],NULL,producer,&ranges[i]);
+		}
+		for(int i = 0;i < r->producers;i++){
+			pthread_join(threads[i],NULL);
+		}
+	}
+	while(__atomic_load_n(&endNs,__ATOMIC_ACQUIRE) == 0){
+		usleep(100);
+	}
+	threadPoolStats(&pool,&after);
+	threadPoolShutdown(&pool);
+	if(r->scene == SCENE_FANOUT){
+		free(roots);
+		free(remain);
+	}
+
+	r->seconds = (endNs - start) / 1e9;
+	r->throughput = r->jobs / r->seconds;
+	percentiles(r,r->jobs);
+	free(latency);
+	free(jobs);
+	unsigned long long locks = after.lock_acquires - before.lock_acquires;
+	r->contended = locks > 0 ? (double)(after.lock_contended - before.lock_contended) / locks : 0.0;
+}
+
+//=========================输出=========================
+static int format = FORMAT_TEXT;
+static int printed = 0;
+
+static void print_header(){
+	if(format == FORMAT_CSV){
+		printf("scenario,sched,cpus,workers,producers,granularity_us,batch,jobs,seconds,throughput,p50_us,p90_us,p99_us,p999_us,max_us,lock_contended\n");
+	}else if(format == FORMAT_JSON){
+		printf("[\n");
+	}else{
+		printf("%-9s %-8s %7s %9s %7s %9s %8s %12s %8s %8s %8s %8s %9s %6s\n",
+			"scenario","sched","workers","producers","gran_us","jobs","seconds","jobs/s","p50","p90","p99","p99.9","max","contend");
+	}
+}
+
+static void print_result(const nBenchResult *r){
+	const char *sched = r->sched == THREADPOOL_SCHED_GLOBAL ? "global" : "stealing";
+	if(format == FORMAT_CSV){
+		printf("%s,%s,%d,%d,%d,%d,%d,%ld,%.6f,%.0f,%llu,%llu,%llu,%llu,%llu,%.4f\n",
+			sceneNames[r->scene],sched,r->cpus,r->workers,r->producers,r->granularity_us,r->batch,r->jobs,r->seconds,r->throughput,
+			r->p50,r->p90,r->p99,r->p999,r->max,r->contended);
+	}else if(format == FORMAT_JSON){
+		printf("%s  {\"scenario\":\"%s\",\"sched\":\"%s\",\"cpus\":%d,\"workers\":%d,\"producers\":%d,\"granularity_us\":%d,\"batch\":%d,\"jobs\":%ld,\"seconds\":%.6f,"
+			"\"throughput\":%.0f,\"latency_us\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu},\"lock_contended\":%.4f}",
+			printed > 0 ? ",\n" : "",sceneNames[r->scene],sched,r->cpus,r->workers,r->producers,r->granularity_us,r->batch,r->jobs,r->seconds,r->throughput,
+			r->p50,r->p90,r->p99,r->p999,r->max,r->contended);
+	}else{
+		printf("%-9s %-8s %7d %9d %7d %9ld %8.3f %12.0f %8llu %8llu %8llu %8llu %9llu %5.1f%%\n",
+			sceneNames[r->scene],sched,r->workers,r->producers,r->granularity_us,r->jobs,r->seconds,r->throughput,
+			r->p50,r->p90,r->p99,r->p999,r->max,r->contended * 100);
+	}
+	printed++;
+	fflush(stdout);
+}
+
+static void print_footer(){
+	if(format == FORMAT_JSON){
+		printf("\n]\n");
+	}
+}
+
+//任务数：指定了就用指定的，否则大约0.5秒*CPU数的工作量，在[1000,500000]之间，fanout取整到轮数
+static long pick_jobs(long jobsArg,int scene,int granularity_us,int cpus){
+	long n = jobsArg;
+	if(n <= 0){
+		double cost_us = scene == SCENE_MIXED ? 0.89 + 0.1 * 10 + 0.01 * 1000 : granularity_us;
+		n = cost_us > 0 ? (long)(500000.0 * cpus / cost_us) : 1000000;
+		n = n < 1000 ? 1000 : n > 500000 ? 500000 : n;
+	}
+	if(scene == SCENE_FANOUT){
+		n = (n + fanout - 1) / fanout * fanout;
+	}
+	return n;
+}
+
+static void usage(const char *name){
+	fprintf(stderr,"usage: %s [-s all|empty|fixed|fanout|producer|mixed] [-w workers] [-p producers] [-g granularity_us] [-n jobs]\n"
+		"          [-F fanout] [-q global|stealing|both] [-b batch] [-r repeat] [-S seed] [-f text|csv|json]\n",name);
+}
+
+int main(int argc,char *argv[]){
+	int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int sceneMask = (1 << SCENE_COUNT) - 1;
+	int workers = cpus;
+	int producers = 0;											//0表示按场景选择
+	int granularity = -1;										//-1表示按场景选择
+	long jobsArg = 0;
+	int scheds[2] = {THREADPOOL_SCHED_GLOBAL,THREADPOOL_SCHED_STEALING};
+	int schedCount = 2;
+	int repeat = 1;
+	unsigned int seed = 12345;
+	int opt;
+	while((opt = getopt(argc,argv,"s:w:p:g:n:F:q:b:r:S:f:h")) != -1){
+		switch(opt){
+		case 's':
+			sceneMask = 0;
+			for(int i = 0;i < SCENE_COUNT;i++){
+				if(strcmp(optarg,sceneNames[i]) == 0){
+					sceneMask = 1 << i;
+				}
+			}
+			if(strcmp(optarg,"all") == 0){
+				sceneMask = (1 << SCENE_COUNT) - 1;
+			}
+			if(sceneMask == 0){
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'w': workers = atoi(optarg); break;
+		case 'p': producers = atoi(optarg); break;
+		case 'g': granularity = atoi(optarg); break;
+		case 'n': jobsArg = atol(optarg); break;
+		case 'F': fanout = atoi(optarg); break;
+		case 'b': batchSize = atoi(optarg); break;
+		case 'r': repeat = atoi(optarg); break;
+		case 'S': seed = (unsigned int)strtoul(optarg,NULL,10); break;
+		case 'q':
+			schedCount = 1;
+			if(strcmp(optarg,"global") == 0){
+				scheds[0] = THREADPOOL_SCHED_GLOBAL;
+			}else if(strcmp(optarg,"stealing") == 0){
+				scheds[0] = THREADPOOL_SCHED_STEALING;
+			}else{
+				schedCount = 2;
+			}
+			break;
+		case 'f':
+			format = strcmp(optarg,"csv") == 0 ? FORMAT_CSV : strcmp(optarg,"json") == 0 ? FORMAT_JSON : FORMAT_TEXT;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	workers = workers < 1 ? 1 : workers > MAX_THREADS_COUNT ? MAX_THREADS_COUNT : workers;
+	fanout = fanout < 1 ? 1 : fanout;
+	if(format == FORMAT_TEXT){
+		printf("cpus:%d workers:%d batch:%d fanout:%d seed:%u\n",cpus,workers,batchSize,fanout,seed);
+	}
+	print_header();
+
+	for(int scene = 0;scene < SCENE_COUNT;scene++){
+		if(!(sceneMask & (1 << scene))){
+			continue;
+		}
+		int grans[3] = {0,0,0};
+		int granCount = 1;
+		if(scene == SCENE_FIXED && granularity < 0){
+			grans[0] = 1;
+			grans[1] = 10;
+			grans[2] = 1000;
+			granCount = 3;
+		}else if(scene == SCENE_MIXED){
+			grans[0] = -1;
+		}else if(scene != SCENE_EMPTY){
+			grans[0] = granularity < 0 ? (scene == SCENE_FANOUT ? 1 : 0) : granularity;
+		}
+		int p = producers > 0 ? producers : scene == SCENE_PRODUCER ? 8 : 1;
+		p = p > MAX_PRODUCERS ? MAX_PRODUCERS : p;
+		for(int g = 0;g < granCount;g++){
+			for(int s = 0;s < schedCount;s++){
+				for(int k = 0;k < repeat;k++){
+					nBenchResult r;
+					memset(&r,0,sizeof(r));
+					r.scene = scene;
+					r.sched = scheds[s];
+					r.workers = workers;
+					r.producers = p;
+					r.granularity_us = grans[g];
+					r.batch = batchSize;
+					r.cpus = cpus;
+					r.jobs = pick_jobs(jobsArg,scene,grans[g],cpus < workers ? cpus : workers);
+					run_once(&r,seed);
+					print_result(&r);
+				}
+			}
+		}
+	}
+
+	print_footer();
+	return 0;
+}
+
+//gcc -O2 ./18bench.c ./threadPool.c -o 18bench -lpthread
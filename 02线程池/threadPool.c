@@ -0,0 +1,2179 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE								//cpu_set_t、pthread_attr_setaffinity_np
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdarg.h>								//可以用于处理变长参数
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "threadPool.h"
+
+//当前线程所属的worker，不是线程池中的线程则为NULL。用于判断任务是从哪里提交的
+static __thread nWorker *currentWorker = NULL;
+
+static unsigned long long nowNs(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//加jobs_mtx：先trylock，失败说明锁被占用，记一次竞争再阻塞加锁。计数在锁内修改
+static void lockJobs(nWorkQueue *wq){
+	if(pthread_mutex_trylock(&wq->jobs_mtx) != 0){
+		pthread_mutex_lock(&wq->jobs_mtx);
+		wq->lock_contended++;
+	}
+	wq->lock_acquires++;
+}
+
+//=========================直方图=========================
+static void histAdd(nHistogram *h,unsigned long long us){
+	int idx = us == 0 ? 0 : 64 - __builtin_clzll(us);		//us在[2^(idx-1),2^idx)中
+	if(idx >= THREADPOOL_HIST_BUCKETS){
+		idx = THREADPOOL_HIST_BUCKETS - 1;
+	}
+	__atomic_add_fetch(&h->buckets[idx],1,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&h->count,1,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&h->sum_us,us,__ATOMIC_RELAXED);
+	unsigned long long max = __atomic_load_n(&h->max_us,__ATOMIC_RELAXED);
+	while(us > max && !__atomic_compare_exchange_n(&h->max_us,&max,us,0,__ATOMIC_RELAXED,__ATOMIC_RELAXED)){
+	}
+}
+
+unsigned long long threadPoolHistPercentile(const nHistogram *hist,double p){
+	if(hist->count == 0){
+		return 0;
+	}
+	unsigned long long target = (unsigned long long)(hist->count * p / 100.0);
+	if(target == 0){
+		target = 1;
+	}
+	unsigned long long sum = 0;
+	for(int i = 0;i < THREADPOOL_HIST_BUCKETS;i++){
+		sum += hist->buckets[i];
+		if(sum >= target){
+			return 1ULL << i;
+		}
+	}
+	return hist->max_us;
+}
+
+//=========================动态线程数=========================
+static int spawnWorker(nWorkQueue *wq);
+
+//没有空闲线程，也没有正在启动的线程，并且还可以增加
+static int canGrow(nWorkQueue *wq){
+	return __atomic_load_n(&wq->live_workers,__ATOMIC_RELAXED) < wq->max_workers
+		&& __atomic_load_n(&wq->starting,__ATOMIC_RELAXED) == 0
+		&& __atomic_load_n(&wq->idle,__ATOMIC_RELAXED) == 0
+		&& !__atomic_load_n(&wq->shutdown,__ATOMIC_RELAXED);
+}
+
+//注入队列中平均每个线程的任务数超过grow_depth
+static int queueTooDeep(nWorkQueue *wq){
+	return wq->grow_depth > 0 && __atomic_load_n(&wq->queued,__ATOMIC_RELAXED) > (long)wq->grow_depth * __atomic_load_n(&wq->live_workers,__ATOMIC_RELAXED);
+}
+
+//需要持有jobs_mtx
+static void growLocked(nWorkQueue *wq){
+	if(canGrow(wq) && spawnWorker(wq) == 0){
+		wq->spawned++;
+	}
+}
+
+static void growWorker(nWorkQueue *wq){
+	if(!canGrow(wq)){											//先无锁检查，固定大小的线程池不会加锁
+		return;
+	}
+	lockJobs(wq);
+	growLocked(wq);
+	pthread_mutex_unlock(&wq->jobs_mtx);
+}
+
+//需要持有jobs_mtx：线程空闲退出，worker保留在worker_array中（其他线程可能正在窃取它的空队列），由之后的spawnWorker或者threadPoolShutdown回收线程
+static void retireWorker(nWorker *worker){
+	nWorkQueue *wq = worker->workqueue;
+	__atomic_store_n(&worker->active,0,__ATOMIC_RELAXED);
+	__atomic_sub_fetch(&wq->live_workers,1,__ATOMIC_RELAXED);
+	wq->retired++;
+	LL_REMOVE(worker,wq->workers);
+}
+
+//ms毫秒之后的截止时间，pthread_cond_timedwait使用CLOCK_REALTIME
+static void deadlineAfter(int ms,struct timespec *ts){
+	clock_gettime(CLOCK_REALTIME,ts);
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+	if(ts->tv_nsec >= 1000000000L){
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+//任务开始执行前调用，记录在对应优先级上的排队时间；排队太久说明线程不够，增加线程。返回开始执行的时间
+static unsigned long long recordWait(nWorkQueue *wq,nJob *job){
+	unsigned long long now = nowNs();
+	unsigned long long waited = now > job->enqueue_ns ? now - job->enqueue_ns : 0;
+	histAdd(&wq->lane_wait[job->priority],waited / 1000);
+	if(wq->grow_wait_ns > 0 && waited >= wq->grow_wait_ns){
+		growWorker(wq);
+	}
+	return now;
+}
+
+//=========================任务槽=========================
+/*
+空闲栈（Treiber栈）：slot_head把版本号和栈顶序号放在一个64位整数里一起CAS，
+一个槽被弹出、又被压回之后版本号已经变了，拿着旧的next的CAS一定失败（ABA问题）
+*/
+#define SLOT_INDEX(head)	((unsigned int)((head) & 0xffffffffULL))
+#define SLOT_TAG(head)		((head) >> 32)
+
+static int isSlot(nWorkQueue *wq,nJob *job){
+	return wq->slots != NULL && (char *)job >= (char *)wq->slots && (char *)job < (char *)(wq->slots + wq->slot_count);
+}
+
+static void slotPush(nWorkQueue *wq,nJobSlot *slot){
+	unsigned int idx = (unsigned int)(slot - wq->slots) + 1;
+	unsigned long long old = __atomic_load_n(&wq->slot_head,__ATOMIC_RELAXED);
+	unsigned long long next;
+	do{
+		__atomic_store_n(&slot->next,SLOT_INDEX(old),__ATOMIC_RELAXED);
+		next = ((SLOT_TAG(old) + 1) << 32) | idx;
+	}while(!__atomic_compare_exchange_n(&wq->slot_head,&old,next,1,__ATOMIC_RELEASE,__ATOMIC_RELAXED));
+}
+
+static nJobSlot *slotPop(nWorkQueue *wq){
+	unsigned long long old = __atomic_load_n(&wq->slot_head,__ATOMIC_ACQUIRE);
+	unsigned long long next;
+	do{
+		if(SLOT_INDEX(old) == 0){
+			return NULL;
+		}
+		//这个槽可能已经被其他线程弹出并改写了next，版本号保证这种情况下CAS失败
+		unsigned int below = __atomic_load_n(&wq->slots[SLOT_INDEX(old) - 1].next,__ATOMIC_RELAXED);
+		next = ((SLOT_TAG(old) + 1) << 32) | below;
+	}while(!__atomic_compare_exchange_n(&wq->slot_head,&old,next,1,__ATOMIC_ACQUIRE,__ATOMIC_ACQUIRE));
+	return &wq->slots[SLOT_INDEX(old) - 1];
+}
+
+static int slotsInit(nWorkQueue *wq,int count){
+	if(count <= 0){
+		return 0;
+	}
+	void *mem = NULL;
+	if(posix_memalign(&mem,64,sizeof(nJobSlot) * count) != 0){
+		return -1;
+	}
+	wq->slots = (nJobSlot *)mem;
+	wq->slot_count = count;
+	memset(wq->slots,0,sizeof(nJobSlot) * count);
+	for(int i = 0;i < count;i++){
+		wq->slots[i].next = i + 2 <= count ? i + 2 : 0;		//初始时按顺序链接
+	}
+	wq->slot_head = 1;
+	return 0;
+}
+
+static int timerRearm(nWorkQueue *wq,nJob *job);
+
+//开始执行之前检查取消和过期：丢弃的任务调用drop_function，任务槽归还，返回1；周期任务不检查
+static int jobDropped(nWorkQueue *wq,nJob *job){
+	if(__atomic_load_n(&job->timer_state,__ATOMIC_RELAXED) != THREADPOOL_TIMER_NONE){
+		return 0;
+	}
+	int reason;
+	int state = THREADPOOL_JOB_QUEUED;
+	if(!__atomic_compare_exchange_n(&job->run_state,&state,THREADPOOL_JOB_STARTED,0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)){
+		reason = THREADPOOL_DROP_CANCELLED;
+		__atomic_add_fetch(&wq->dropped_cancelled,1,__ATOMIC_RELAXED);
+	}else if(job->expire_ns != 0 && nowNs() > job->expire_ns){		//已经是STARTED，之后的取消返回-1
+		reason = THREADPOOL_DROP_EXPIRED;
+		__atomic_add_fetch(&wq->dropped_expired,1,__ATOMIC_RELAXED);
+	}else{
+		return 0;
+	}
+	int slot = isSlot(wq,job);
+	if(job->drop_function != NULL){
+		job->drop_function(job,reason);
+	}
+	if(slot){
+		slotPush(wq,(nJobSlot *)job);
+	}
+	return 1;
+}
+
+static void strandRun(nJob *runner);
+
+//执行一个任务：被取消或者过期的丢弃，记录排队时间，执行，记录执行时间和线程的忙碌时间，任务槽执行完之后归还；周期任务放回定时器
+static void runJob(nWorkQueue *wq,nJob *job){
+	if(job->job_function == strandRun){							//strand的runner只是载体，不计入统计，它取出的每个任务再经过runJob
+		strandRun(job);
+		return;
+	}
+	if(jobDropped(wq,job)){
+		return;
+	}
+	unsigned long long start = recordWait(wq,job);
+	int priority = job->priority;
+	int slot = isSlot(wq,job);									//任务函数返回之后job可能已经被调用者释放，先判断
+	int periodic = __atomic_load_n(&job->timer_state,__ATOMIC_RELAXED) != THREADPOOL_TIMER_NONE;	//周期任务在取消或者放回之前一直有效
+	nWorker *worker = currentWorker;
+	if(worker != NULL && worker->workqueue != wq){
+		worker = NULL;											//其他线程池的线程帮忙执行，不算在它的忙碌时间里
+	}
+	if(worker != NULL){
+		worker->depth++;
+	}
+	job->job_function(job);
+	unsigned long long spend = nowNs() - start;
+	histAdd(&wq->lane_run[priority],spend / 1000);
+	if(worker != NULL){
+		__atomic_store_n(&worker->jobs,worker->jobs + 1,__ATOMIC_RELAXED);
+		if(--worker->depth == 0){								//嵌套执行的时间已经包含在外层任务中
+			__atomic_store_n(&worker->busy_ns,worker->busy_ns + spend,__ATOMIC_RELAXED);
+		}
+	}
+	if(periodic && timerRearm(wq,job)){
+		slot = 0;												//放回了定时器，任务槽下次执行完再归还
+	}
+	if(slot){
+		slotPush(wq,(nJobSlot *)job);
+	}
+}
+
+//=========================CPU亲和性和NUMA节点=========================
+struct NTOPOLOGY {
+	cpu_set_t cpus[THREADPOOL_MAX_NODES];		//每个节点可以使用的CPU，已经和允许使用的CPU取了交集
+	int ids[THREADPOOL_MAX_NODES];				//系统的节点编号，人为划分或者没有节点信息时为-1
+};
+
+//解析"0-3,8,10-11"格式的列表（CPU编号或者节点编号），格式错误返回-1
+static int parseCpuList(const char *s,cpu_set_t *set){
+	CPU_ZERO(set);
+	while(*s != '\0' && *s != '\n'){
+		char *end;
+		long lo = strtol(s,&end,10);
+		if(end == s || lo < 0){
+			return -1;
+		}
+		long hi = lo;
+		s = end;
+		if(*s == '-'){
+			hi = strtol(s + 1,&end,10);
+			if(end == s + 1 || hi < lo){
+				return -1;
+			}
+			s = end;
+		}
+		for(long c = lo;c <= hi && c < CPU_SETSIZE;c++){
+			CPU_SET(c,set);
+		}
+		if(*s == ','){
+			s++;
+		}else if(*s != '\0' && *s != '\n'){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+//读取一个只有一行的sysfs文件并解析成集合
+static int readCpuList(const char *path,cpu_set_t *set){
+	char line[4096];
+	FILE *fp = fopen(path,"r");
+	if(fp == NULL){
+		return -1;
+	}
+	int ok = fgets(line,sizeof(line),fp) != NULL;
+	fclose(fp);
+	return ok ? parseCpuList(line,set) : -1;
+}
+
+//集合中的第n个CPU（从0开始）
+static int nthCpu(const cpu_set_t *set,int n){
+	for(int c = 0;c < CPU_SETSIZE;c++){
+		if(CPU_ISSET(c,set) && n-- == 0){
+			return c;
+		}
+	}
+	return -1;
+}
+
+//读取系统的节点，返回节点数。每个节点的CPU和allowed取交集，没有可用CPU的节点（例如只有内存的节点）跳过
+static int readNodes(struct NTOPOLOGY *topo,const cpu_set_t *allowed){
+	cpu_set_t online;
+	if(readCpuList("/sys/devices/system/node/online",&online) != 0){
+		return 0;
+	}
+	int count = 0;
+	for(int id = 0;id < CPU_SETSIZE && count < THREADPOOL_MAX_NODES;id++){
+		if(!CPU_ISSET(id,&online)){
+			continue;
+		}
+		char path[64];
+		snprintf(path,sizeof(path),"/sys/devices/system/node/node%d/cpulist",id);
+		if(readCpuList(path,&topo->cpus[count]) != 0){
+			continue;
+		}
+		CPU_AND(&topo->cpus[count],&topo->cpus[count],allowed);
+		if(CPU_COUNT(&topo->cpus[count]) > 0){
+			topo->ids[count++] = id;
+		}
+	}
+	return count;
+}
+
+//把allowed中的CPU按顺序平均分成nodes组，CPU比组少时多个组共用CPU
+static int splitNodes(struct NTOPOLOGY *topo,const cpu_set_t *allowed,int nodes){
+	int m = CPU_COUNT(allowed);
+	if(nodes > THREADPOOL_MAX_NODES){
+		nodes = THREADPOOL_MAX_NODES;
+	}
+	for(int j = 0;j < nodes;j++){
+		CPU_ZERO(&topo->cpus[j]);
+		for(int i = j * m / nodes;i < (j + 1) * m / nodes;i++){
+			CPU_SET(nthCpu(allowed,i),&topo->cpus[j]);
+		}
+		if(CPU_COUNT(&topo->cpus[j]) == 0){
+			CPU_SET(nthCpu(allowed,j % m),&topo->cpus[j]);
+		}
+		topo->ids[j] = -1;
+	}
+	return nodes;
+}
+
+//按创建参数确定节点和每个节点的CPU，不绑定也不分组时不需要拓扑，成功返回0
+static int topologyInit(nWorkQueue *wq,const nThreadPoolAttr *attr){
+	wq->num_nodes = 1;
+	wq->affinity = attr->affinity;
+	if(attr->affinity == THREADPOOL_AFFINITY_NONE && !attr->numa){
+		return 0;
+	}
+
+	cpu_set_t allowed;
+	if(sched_getaffinity(0,sizeof(allowed),&allowed) != 0){
+		perror("sched_getaffinity error!\n");
+		return -1;
+	}
+	if(attr->cpu_list != NULL){
+		cpu_set_t want;
+		if(parseCpuList(attr->cpu_list,&want) != 0){
+			fprintf(stderr,"bad cpu_list: %s\n",attr->cpu_list);
+			return -1;
+		}
+		CPU_AND(&allowed,&allowed,&want);
+	}
+	if(CPU_COUNT(&allowed) == 0){
+		fprintf(stderr,"no usable cpu in cpu_list\n");
+		return -1;
+	}
+
+	struct NTOPOLOGY *topo = (struct NTOPOLOGY *)calloc(1,sizeof(struct NTOPOLOGY));
+	if(topo == NULL){
+		perror("calloc error!\n");
+		return -1;
+	}
+	int count = 0;
+	if(attr->numa){
+		count = attr->nodes > 0 ? splitNodes(topo,&allowed,attr->nodes) : readNodes(topo,&allowed);
+	}
+	if(count == 0){												//不分组，或者读不到节点信息（例如容器中没有挂载sysfs）
+		topo->cpus[0] = allowed;
+		topo->ids[0] = -1;
+		count = 1;
+	}
+	wq->topology = topo;
+	wq->num_nodes = count;
+	return 0;
+}
+
+//新的worker所属的节点和CPU：节点轮流分配，线程数变化时各节点的线程数也保持均衡
+static void placeWorker(nWorkQueue *wq,nWorker *worker){
+	worker->node = worker->index % wq->num_nodes;
+	worker->cpu = -1;
+	if(wq->affinity == THREADPOOL_AFFINITY_CPU){
+		const cpu_set_t *cpus = &wq->topology->cpus[worker->node];
+		worker->cpu = nthCpu(cpus,(worker->index / wq->num_nodes) % CPU_COUNT(cpus));
+	}
+}
+
+//节点通道只在工作窃取模式并且多于一个节点时使用
+static int useNodeLanes(nWorkQueue *wq){
+	return wq->sched == THREADPOOL_SCHED_STEALING && wq->num_nodes > 1;
+}
+
+//=========================优先级通道=========================
+//以下几个函数都需要持有jobs_mtx
+
+/*
+从通道中取走了count个任务，通知阻塞的提交者
+只取走一个时只唤醒一个；队列空了或者一次取走多个时全部唤醒，批量提交者等待的空位数不同，避免唤醒了一个不能继续的提交者而其他提交者一直睡眠
+*/
+static void laneReleased(nWorkQueue *wq,long count){
+	if(wq->waiting_producers == 0){
+		return;
+	}
+	if(count > 1 || wq->queued == 0){
+		pthread_cond_broadcast(&wq->notfull_cond);
+	}else{
+		pthread_cond_signal(&wq->notfull_cond);
+	}
+}
+
+#define MAX_DEQUEUE_BATCH	64					//dequeue_batch的上限
+
+//把已经用next/prev链接好的first...last共count个任务整体接到通道尾部
+static void laneSplice(nWorkQueue *wq,int priority,nJob *first,nJob *last,long count){
+	nJobLane *lane = &wq->lanes[priority];
+	first->prev = lane->tail;
+	last->next = NULL;
+	if(lane->tail != NULL){
+		lane->tail->next = first;
+	}else{
+		lane->head = first;
+	}
+	lane->tail = last;
+	lane->count += count;
+	__atomic_store_n(&wq->queued,wq->queued + count,__ATOMIC_RELAXED);
+	if(wq->queued > wq->max_queued){
+		wq->max_queued = wq->queued;
+	}
+}
+
+//尾部插入，保证同一个通道内先提交的先执行。lane是优先级通道或者节点通道
+static void laneAppend(nWorkQueue *wq,nJobLane *lane,nJob *job){
+	job->next = NULL;
+	job->prev = lane->tail;
+	if(lane->tail != NULL){
+		lane->tail->next = job;
+	}else{
+		lane->head = job;
+	}
+	lane->tail = job;
+	lane->count++;
+	__atomic_store_n(&wq->queued,wq->queued + 1,__ATOMIC_RELAXED);
+	if(wq->queued > wq->max_queued){
+		wq->max_queued = wq->queued;
+	}
+}
+
+/*
+取出下一个任务：
+1.低优先级通道的队首等待超过aging_ns，说明被饿住了，先取等待最久的那个
+2.否则从最高优先级的非空通道头部取
+queued中也包括节点通道中的任务，优先级通道可能都是空的
+*/
+static nJob *lanePop(nWorkQueue *wq){
+	if(wq->queued == 0){
+		return NULL;
+	}
+
+	int pick = -1;
+	if(wq->aging_ns > 0){
+		unsigned long long now = nowNs();
+		unsigned long long oldest = 0;
+		for(int i = 1;i < THREADPOOL_LANES;i++){
+			nJob *head = wq->lanes[i].head;
+			if(head != NULL && now > head->enqueue_ns && now - head->enqueue_ns >= wq->aging_ns && now - head->enqueue_ns > oldest){
+				oldest = now - head->enqueue_ns;
+				pick = i;
+			}
+		}
+	}
+	if(pick == -1){
+		for(int i = 0;i < THREADPOOL_LANES;i++){
+			if(wq->lanes[i].head != NULL){
+				pick = i;
+				break;
+			}
+		}
+		if(pick == -1){
+			return NULL;
+		}
+	}
+
+	nJobLane *lane = &wq->lanes[pick];
+	nJob *job = lane->head;
+	lane->head = job->next;
+	if(lane->head != NULL){
+		lane->head->prev = NULL;
+	}else{
+		lane->tail = NULL;
+	}
+	lane->count--;
+	job->prev = job->next = NULL;
+	__atomic_store_n(&wq->queued,wq->queued - 1,__ATOMIC_RELAXED);
+	laneReleased(wq,1);
+	return job;
+}
+
+/*
+一次加锁取出多个任务，最多max个，并且不超过平均每个线程的份额，避免一个线程拿走所有任务而其他线程空闲
+第一个任务按优先级和老化规则选择，之后的任务只从同一个通道继续取，保证不会越过更高优先级的任务
+normalOnly：第一个任务不是普通优先级时只取一个（工作窃取模式下多取的任务放入线程自己的队列，只能放普通优先级，否则会打乱通道内的顺序）
+*/
+static int lanePopBatch(nWorkQueue *wq,nJob **out,int max,int normalOnly){
+	nJob *job = lanePop(wq);
+	if(job == NULL){
+		return 0;
+	}
+	out[0] = job;
+	if(normalOnly && job->priority != THREADPOOL_PRIO_NORMAL){
+		return 1;
+	}
+
+	long share = wq->queued / (wq->live_workers > 0 ? wq->live_workers : 1) + 1;
+	if(max > share + 1){
+		max = (int)share + 1;
+	}
+	nJobLane *lane = &wq->lanes[job->priority];
+	int n = 1;
+	while(n < max && lane->head != NULL){
+		if(job->priority != THREADPOOL_PRIO_HIGH && wq->lanes[THREADPOOL_PRIO_HIGH].head != NULL){
+			break;												//高优先级任务到达，不再多取
+		}
+		nJob *next = lane->head;
+		lane->head = next->next;
+		if(lane->head != NULL){
+			lane->head->prev = NULL;
+		}else{
+			lane->tail = NULL;
+		}
+		lane->count--;
+		next->prev = next->next = NULL;
+		out[n++] = next;
+	}
+	__atomic_store_n(&wq->queued,wq->queued - (n - 1),__ATOMIC_RELAXED);
+	if(n > 1){
+		laneReleased(wq,n - 1);
+	}
+	return n;
+}
+
+/*
+本节点的通道是否先于优先级通道：没有高优先级任务，没有老化的低优先级任务，并且队首比普通通道的队首提交得早
+两种通道中的普通优先级任务大致按提交顺序执行，节点通道不会饿死公共通道
+*/
+static int preferNodeLane(nWorkQueue *wq,int node){
+	nJob *head = wq->node_lanes[node].head;
+	if(head == NULL || wq->lanes[THREADPOOL_PRIO_HIGH].head != NULL){
+		return 0;
+	}
+	nJob *normal = wq->lanes[THREADPOOL_PRIO_NORMAL].head;
+	if(normal != NULL && normal->enqueue_ns < head->enqueue_ns){
+		return 0;
+	}
+	nJob *low = wq->lanes[THREADPOOL_PRIO_LOW].head;
+	if(low != NULL && wq->aging_ns > 0 && nowNs() >= low->enqueue_ns + wq->aging_ns){
+		return 0;
+	}
+	return 1;
+}
+
+//从第node个节点的通道头部取出最多max个任务，和lanePopBatch一样不超过平均每个线程的份额
+static int nodeLanePop(nWorkQueue *wq,int node,nJob **out,int max){
+	nJobLane *lane = &wq->node_lanes[node];
+	long share = wq->queued / (wq->live_workers > 0 ? wq->live_workers : 1) + 1;
+	if(max > share + 1){
+		max = (int)share + 1;
+	}
+	int n = 0;
+	while(n < max && lane->head != NULL){
+		nJob *job = lane->head;
+		lane->head = job->next;
+		if(lane->head != NULL){
+			lane->head->prev = NULL;
+		}else{
+			lane->tail = NULL;
+		}
+		lane->count--;
+		job->prev = job->next = NULL;
+		out[n++] = job;
+	}
+	if(n > 0){
+		__atomic_store_n(&wq->queued,wq->queued - n,__ATOMIC_RELAXED);
+		laneReleased(wq,n);
+	}
+	return n;
+}
+
+//=========================Chase-Lev双端队列=========================
+/*
+参考 "Correct and Efficient Work-Stealing for Weak Memory Models"（Lê等，PPoPP 2013）
+所有者在bottom端push/pop，窃取者在top端CAS；只有剩最后一个元素时所有者和窃取者才需要竞争同一个CAS
+*/
+#define DEQUE_EMPTY		((nJob *)0)
+#define DEQUE_ABORT		((nJob *)1)				//窃取时CAS失败（和其他线程竞争），可以换一个对象重试
+
+static int dequeInit(nJobDeque *dq,int size){
+	long cap = 1;
+	while(cap < size){							//容量取2的幂，下标用&代替%
+		cap <<= 1;
+	}
+	dq->buffer = (nJob **)calloc(cap,sizeof(nJob *));
+	if(dq->buffer == NULL){
+		return -1;
+	}
+	dq->top = 0;
+	dq->bottom = 0;
+	dq->mask = cap - 1;
+	return 0;
+}
+
+//所有者线程调用，队列满返回-1
+static int dequePush(nJobDeque *dq,nJob *job){
+	long b = __atomic_load_n(&dq->bottom,__ATOMIC_RELAXED);
+	long t = __atomic_load_n(&dq->top,__ATOMIC_ACQUIRE);
+	if(b - t > dq->mask){
+		return -1;
+	}
+	__atomic_store_n(&dq->buffer[b & dq->mask],job,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);	//任务写入之后才能让窃取者看到新的bottom
+	__atomic_store_n(&dq->bottom,b + 1,__ATOMIC_RELAXED);
+	return 0;
+}
+
+//所有者线程调用，从bottom端取出最新的任务
+static nJob *dequePop(nJobDeque *dq){
+	long b = __atomic_load_n(&dq->bottom,__ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&dq->bottom,b,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);	//先公开bottom-1，再读top，和窃取者的读顺序相反
+	long t = __atomic_load_n(&dq->top,__ATOMIC_RELAXED);
+
+	nJob *job = DEQUE_EMPTY;
+	if(t <= b){
+		job = __atomic_load_n(&dq->buffer[b & dq->mask],__ATOMIC_RELAXED);
+		if(t == b){								//最后一个元素，和窃取者竞争
+			if(!__atomic_compare_exchange_n(&dq->top,&t,t + 1,0,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED)){
+				job = DEQUE_EMPTY;				//被窃取了
+			}
+			__atomic_store_n(&dq->bottom,b + 1,__ATOMIC_RELAXED);
+		}
+	}else{										//队列本来就是空的，恢复bottom
+		__atomic_store_n(&dq->bottom,b + 1,__ATOMIC_RELAXED);
+	}
+	return job;
+}
+
+//其他线程调用，从top端窃取最早的任务
+static nJob *dequeSteal(nJobDeque *dq){
+	long t = __atomic_load_n(&dq->top,__ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	long b = __atomic_load_n(&dq->bottom,__ATOMIC_ACQUIRE);
+
+	if(t < b){
+		nJob *job = __atomic_load_n(&dq->buffer[t & dq->mask],__ATOMIC_RELAXED);
+		if(!__atomic_compare_exchange_n(&dq->top,&t,t + 1,0,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED)){
+			return DEQUE_ABORT;
+		}
+		return job;
+	}
+	return DEQUE_EMPTY;
+}
+
+//=========================自旋和睡眠=========================
+/*
+空闲线程先自旋spin_ns（每次检查之间执行pause），短时间内有任务到达就不需要睡眠和唤醒；自旋结束还没有任务才在futex上睡眠
+每个线程睡眠在自己的park_word上，睡眠的线程放在空闲栈park_list中，idle是栈中的线程数
+睡眠：parkPrepare把自己放入空闲栈（idle+1），然后检查有没有任务，没有才futex_wait(park_word,0)
+唤醒：任务放入队列之后看idle，为0时什么都不做（不需要加锁和系统调用）；否则从栈顶取走一个线程，设置它的park_word再futex_wake
+两边都是顺序一致的原子操作，要么睡眠的线程检查时看到了任务，要么提交者看到了idle>0。被取走的线程已经不在栈中，
+在它醒来之前的其他提交不会重复唤醒它（一个共享的futex字做不到这一点，每次提交都要系统调用）
+栈顶是最近睡眠的线程，缓存更热；栈底的线程一直睡眠，空闲超时后退出
+*/
+static inline void cpuRelax(){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+//自旋等待*counter大于0，最多spin_ns纳秒，等到了返回1
+static int spinForWork(nWorker *worker,long *counter){
+	nWorkQueue *wq = worker->workqueue;
+	if(wq->spin_ns == 0){
+		return 0;
+	}
+	unsigned long long deadline = nowNs() + wq->spin_ns;
+	for(int i = 1;;i++){
+		if(__atomic_load_n(counter,__ATOMIC_RELAXED) > 0 || __atomic_load_n(&worker->terminate,__ATOMIC_RELAXED)){
+			__atomic_add_fetch(&wq->spin_hits,1,__ATOMIC_RELAXED);
+			return 1;
+		}
+		cpuRelax();
+		if((i & 63) == 0 && nowNs() >= deadline){					//每64次看一次时间
+			return 0;
+		}
+	}
+}
+
+//放入空闲栈，之后调用者还要再检查一次有没有任务。有定时任务并且还没有线程负责时，由这个线程负责
+static void parkPrepare(nWorker *worker){
+	nWorkQueue *wq = worker->workqueue;
+	pthread_mutex_lock(&wq->park_mtx);
+	__atomic_store_n(&worker->park_word,0,__ATOMIC_RELAXED);
+	worker->parked = 1;
+	worker->park_next = wq->park_list;
+	wq->park_list = worker;
+	if(wq->timer_sleeper == NULL && __atomic_load_n(&wq->timer_next,__ATOMIC_RELAXED) != ULLONG_MAX){
+		__atomic_store_n(&wq->timer_sleeper,worker,__ATOMIC_RELAXED);
+	}
+	__atomic_add_fetch(&wq->idle,1,__ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&wq->park_mtx);
+}
+
+//需要持有park_mtx：把一个睡眠的线程从空闲栈中取出
+static void parkClaim(nWorkQueue *wq,nWorker *worker){
+	nWorker **pp = &wq->park_list;
+	while(*pp != worker){
+		pp = &(*pp)->park_next;
+	}
+	*pp = worker->park_next;
+	worker->parked = 0;
+	if(wq->timer_sleeper == worker){
+		__atomic_store_n(&wq->timer_sleeper,NULL,__ATOMIC_RELAXED);
+	}
+	__atomic_sub_fetch(&wq->idle,1,__ATOMIC_SEQ_CST);
+}
+
+//离开空闲栈，返回1表示已经被提交者取走了（唤醒已经发给自己）
+static int parkLeave(nWorker *worker){
+	nWorkQueue *wq = worker->workqueue;
+	pthread_mutex_lock(&wq->park_mtx);
+	int claimed = !worker->parked;
+	if(!claimed){
+		parkClaim(wq,worker);
+	}
+	pthread_mutex_unlock(&wq->park_mtx);
+	return claimed;
+}
+
+//parkPrepare之后发现有任务，不睡眠了；已经被取走的话，这次唤醒由自己消费（自己马上就去取任务）
+static void parkCancel(nWorker *worker){
+	parkLeave(worker);
+}
+
+/*
+睡眠直到被唤醒，或者timeout_ms毫秒之后（小于0表示不超时），超时返回ETIMEDOUT
+超时的同时被取走也算被唤醒；唤醒者取走线程之后被抢占、直到线程下一次睡眠才写park_word，这次会被当作超时，只会让线程提前检查一次空闲退出
+负责定时器的线程最多睡到最近的到期时间，因为定时器醒来时返回0（不是空闲超时），回去处理到期的任务
+*/
+static int parkWait(nWorker *worker,int timeout_ms){
+	nWorkQueue *wq = worker->workqueue;
+	long long timeout = timeout_ms >= 0 ? (long long)timeout_ms * 1000000LL : -1;
+	int timer = 0;
+	if(__atomic_load_n(&wq->timer_sleeper,__ATOMIC_RELAXED) == worker){
+		unsigned long long next = __atomic_load_n(&wq->timer_next,__ATOMIC_RELAXED);
+		unsigned long long now = nowNs();
+		long long left = next > now ? (long long)(next - now) : 0;
+		if(timeout < 0 || left < timeout){
+			timeout = left;
+			timer = 1;
+		}
+	}
+	struct timespec ts;
+	struct timespec *pts = NULL;
+	if(timeout >= 0){
+		ts.tv_sec = timeout / 1000000000LL;
+		ts.tv_nsec = timeout % 1000000000LL;
+		pts = &ts;
+	}
+	__atomic_add_fetch(&wq->parks,1,__ATOMIC_RELAXED);
+	while(__atomic_load_n(&worker->park_word,__ATOMIC_ACQUIRE) == 0){
+		if(syscall(SYS_futex,&worker->park_word,FUTEX_WAIT_PRIVATE,0,pts,NULL,0) == -1 && errno == ETIMEDOUT){
+			break;
+		}
+	}
+	if(parkLeave(worker)){
+		__atomic_add_fetch(&wq->wakeups,1,__ATOMIC_RELAXED);
+		return 0;
+	}
+	return timer ? 0 : ETIMEDOUT;
+}
+
+//唤醒unparkWorkers、kickTimers取出的线程：先写park_word再futex_wake
+static void wakeClaimed(nWorkQueue *wq,nWorker *wake){
+	while(wake != NULL){
+		nWorker *next = wake->park_next;						//设置park_word之后线程可能马上又睡眠，先取next
+		__atomic_store_n(&wake->park_word,1,__ATOMIC_RELEASE);
+		syscall(SYS_futex,&wake->park_word,FUTEX_WAKE_PRIVATE,1,NULL,NULL,0);
+		__atomic_add_fetch(&wq->unparks,1,__ATOMIC_RELAXED);
+		wake = next;
+	}
+}
+
+//唤醒最多n个睡眠的线程，没有线程睡眠时不加锁也不做系统调用；负责定时器的线程留到最后，让它继续等待到期时间
+static void unparkWorkers(nWorkQueue *wq,int n){
+	if(__atomic_load_n(&wq->idle,__ATOMIC_SEQ_CST) == 0){
+		return;
+	}
+	nWorker *wake = NULL;
+	pthread_mutex_lock(&wq->park_mtx);
+	while(n-- > 0 && wq->park_list != NULL){
+		nWorker *worker = wq->park_list;
+		if(worker == wq->timer_sleeper && worker->park_next != NULL){
+			worker = worker->park_next;
+		}
+		parkClaim(wq,worker);
+		worker->park_next = wake;
+		wake = worker;
+	}
+	pthread_mutex_unlock(&wq->park_mtx);
+	wakeClaimed(wq,wake);
+}
+
+//=========================定时任务=========================
+/*
+4叉最小堆：比二叉堆矮一半，下沉时一次比较4个孩子；元素是(到期时间,job)，16字节，
+数组偏移之后下标4i+1到4i+4的4个孩子正好在同一个缓存行中，几百万个定时器时比较孩子不需要读job
+每个job的timer_index记录自己在堆中的位置，取消时不需要查找
+*/
+typedef struct NTIMERENTRY {
+	unsigned long long deadline_ns;
+	nJob *job;
+} nTimerEntry;
+
+#define TIMER_HEAP_MIN		256
+
+static void heapSet(nWorkQueue *wq,long i,nTimerEntry e){
+	wq->timer_heap[i] = e;
+	e.job->timer_index = (int)i;
+}
+
+static void heapUp(nWorkQueue *wq,long i){
+	nTimerEntry e = wq->timer_heap[i];
+	while(i > 0){
+		long parent = (i - 1) / 4;
+		if(wq->timer_heap[parent].deadline_ns <= e.deadline_ns){
+			break;
+		}
+		heapSet(wq,i,wq->timer_heap[parent]);
+		i = parent;
+	}
+	heapSet(wq,i,e);
+}
+
+static void heapDown(nWorkQueue *wq,long i){
+	nTimerEntry e = wq->timer_heap[i];
+	while(1){
+		long child = 4 * i + 1;
+		if(child >= wq->timer_count){
+			break;
+		}
+		long best = child;
+		long end = child + 4 < wq->timer_count ? child + 4 : wq->timer_count;
+		for(long c = child + 1;c < end;c++){
+			if(wq->timer_heap[c].deadline_ns < wq->timer_heap[best].deadline_ns){
+				best = c;
+			}
+		}
+		if(wq->timer_heap[best].deadline_ns >= e.deadline_ns){
+			break;
+		}
+		heapSet(wq,i,wq->timer_heap[best]);
+		i = best;
+	}
+	heapSet(wq,i,e);
+}
+
+//容量翻倍：按缓存行对齐分配，再偏移3个元素，下标1落在缓存行的开头
+static int timerGrow(nWorkQueue *wq){
+	long cap = wq->timer_cap > 0 ? wq->timer_cap * 2 : TIMER_HEAP_MIN;
+	if(cap > INT_MAX){
+		return -1;
+	}
+	void *mem = NULL;
+	if(posix_memalign(&mem,64,sizeof(nTimerEntry) * (cap + 3)) != 0){
+		return -1;
+	}
+	nTimerEntry *heap = (nTimerEntry *)mem + 3;
+	if(wq->timer_count > 0){
+		memcpy(heap,wq->timer_heap,sizeof(nTimerEntry) * wq->timer_count);
+	}
+	free(wq->timer_mem);
+	wq->timer_mem = mem;
+	wq->timer_heap = heap;
+	wq->timer_cap = cap;
+	return 0;
+}
+
+//以下需要持有timer_mtx
+static int heapInsert(nWorkQueue *wq,nJob *job){
+	if(wq->timer_count == wq->timer_cap && timerGrow(wq) != 0){
+		return -1;
+	}
+	nTimerEntry e = {job->deadline_ns,job};
+	long i = wq->timer_count++;
+	heapSet(wq,i,e);
+	heapUp(wq,i);
+	return 0;
+}
+
+static void heapRemove(nWorkQueue *wq,long i){
+	long last = --wq->timer_count;
+	if(i < last){
+		nTimerEntry e = wq->timer_heap[last];
+		heapSet(wq,i,e);										//最后一个元素填到空位，比父节点早就上浮，否则下沉
+		if(i > 0 && wq->timer_heap[(i - 1) / 4].deadline_ns > e.deadline_ns){
+			heapUp(wq,i);
+		}else{
+			heapDown(wq,i);
+		}
+	}
+}
+
+static void timerNextUpdate(nWorkQueue *wq){
+	__atomic_store_n(&wq->timer_next,wq->timer_count > 0 ? wq->timer_heap[0].deadline_ns : ULLONG_MAX,__ATOMIC_RELAXED);
+}
+
+/*
+新的定时任务成为最早到期的：叫醒负责定时器的线程，按新的到期时间重新睡眠；还没有线程负责时叫醒一个睡眠的线程，它再睡眠时就会负责
+没有线程睡眠时什么都不做，忙碌的线程取任务时会看到到期的任务
+*/
+static void kickTimers(nWorkQueue *wq){
+	if(__atomic_load_n(&wq->idle,__ATOMIC_SEQ_CST) == 0){
+		return;
+	}
+	pthread_mutex_lock(&wq->park_mtx);
+	nWorker *worker = wq->timer_sleeper != NULL ? wq->timer_sleeper : wq->park_list;
+	if(worker != NULL){
+		parkClaim(wq,worker);
+		worker->park_next = NULL;
+	}
+	pthread_mutex_unlock(&wq->park_mtx);
+	wakeClaimed(wq,worker);
+}
+
+//把到期的任务放入普通优先级通道，返回放入的个数。没有定时任务时只是一次原子读取
+static int pollTimers(nWorkQueue *wq){
+	unsigned long long next = __atomic_load_n(&wq->timer_next,__ATOMIC_RELAXED);
+	if(next == ULLONG_MAX){
+		return 0;
+	}
+	unsigned long long now = nowNs();
+	if(next > now){
+		return 0;
+	}
+
+	nJob *first = NULL;
+	nJob *last = NULL;
+	long n = 0;
+	pthread_mutex_lock(&wq->timer_mtx);
+	while(wq->timer_count > 0 && wq->timer_heap[0].deadline_ns <= now){		//其他线程可能已经取走了
+		nJob *job = wq->timer_heap[0].job;
+		heapRemove(wq,0);
+		__atomic_store_n(&job->timer_state,job->period_ns > 0 ? THREADPOOL_TIMER_FIRED : THREADPOOL_TIMER_NONE,__ATOMIC_RELAXED);
+		job->priority = THREADPOOL_PRIO_NORMAL;
+		job->enqueue_ns = now;
+		job->prev = last;
+		job->next = NULL;
+		if(last != NULL){
+			last->next = job;
+		}else{
+			first = job;
+		}
+		last = job;
+		n++;
+	}
+	timerNextUpdate(wq);
+	int remain = wq->timer_count > 0;
+	pthread_mutex_unlock(&wq->timer_mtx);
+	if(n == 0){
+		return 0;
+	}
+
+	lockJobs(wq);
+	if(wq->shutdown){
+		pthread_mutex_unlock(&wq->jobs_mtx);
+		return 0;
+	}
+	if(wq->sched == THREADPOOL_SCHED_STEALING){
+		__atomic_add_fetch(&wq->pending,n,__ATOMIC_SEQ_CST);
+	}
+	laneSplice(wq,THREADPOOL_PRIO_NORMAL,first,last,n);
+	pthread_mutex_unlock(&wq->jobs_mtx);
+	__atomic_add_fetch(&wq->timers_fired,n,__ATOMIC_RELAXED);
+
+	//调用者是工作线程，自己执行一个，再叫醒n-1个；负责定时器的线程醒来之后不再负责，还有定时任务时多叫醒一个，它再睡眠时接着负责
+	long wake = n - 1 + (remain && __atomic_load_n(&wq->timer_sleeper,__ATOMIC_RELAXED) == NULL);
+	unparkWorkers(wq,wake > INT_MAX ? INT_MAX : (int)wake);
+	return (int)n;
+}
+
+//需要持有timer_mtx：放入定时器堆，成功返回0，*top表示成为了堆顶（调用者放开锁之后kickTimers）
+static int timerAddLocked(nWorkQueue *wq,nJob *job,int *top){
+	if(__atomic_load_n(&wq->shutdown,__ATOMIC_RELAXED) || heapInsert(wq,job) != 0){
+		return -1;
+	}
+	__atomic_store_n(&job->timer_state,THREADPOOL_TIMER_PENDING,__ATOMIC_RELAXED);
+	*top = job->timer_index == 0;
+	timerNextUpdate(wq);
+	return 0;
+}
+
+/*
+周期任务执行完之后调用：下一次到期时间是上一次的到期时间加周期，已经过去的节拍跳过
+被取消了或者线程池正在关闭时不再放回，返回0（此后线程池不再访问job）；放回了返回1
+检查取消和放回在同一次加锁中，threadPoolCancel要么在之前把它标记为取消，要么在之后从堆中删除它
+*/
+static int timerRearm(nWorkQueue *wq,nJob *job){
+	int top = 0;
+	pthread_mutex_lock(&wq->timer_mtx);
+	int ok = 0;
+	if(__atomic_load_n(&job->timer_state,__ATOMIC_RELAXED) != THREADPOOL_TIMER_CANCELLED){
+		unsigned long long now = nowNs();
+		unsigned long long next = job->deadline_ns + job->period_ns;
+		if(next <= now){
+			next += ((now - next) / job->period_ns + 1) * job->period_ns;
+		}
+		job->deadline_ns = next;
+		ok = timerAddLocked(wq,job,&top) == 0;
+	}
+	if(!ok){
+		__atomic_store_n(&job->timer_state,THREADPOOL_TIMER_NONE,__ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&wq->timer_mtx);
+	if(top){
+		kickTimers(wq);
+	}
+	return ok;
+}
+
+//=========================线程池的实现：包括线程池创建、线程执行方法、job任务添加=========================
+
+//线程工作方法：线程创建之后会开始执行该函数
+//在这个方法中：主要实现对任务的处理，在线程池中会一直循环去获取任务
+static void *workerThread(void *ptr){
+	nWorker *worker = (nWorker *)ptr;			//传递的参数，是nWorker类型
+	nWorkQueue *wq = worker->workqueue;
+	nJob *batch[MAX_DEQUEUE_BATCH];
+	currentWorker = worker;										//任务中再提交任务时不受容量限制
+	__atomic_sub_fetch(&wq->starting,1,__ATOMIC_RELAXED);
+
+	while(1){
+		pollTimers(wq);												//到期的定时任务先放入通道
+
+		//要读取任务先进行加锁
+		lockJobs(worker->workqueue);
+
+		int timedout = 0;
+		int spun = 0;
+		while(worker->workqueue->queued == 0){						//任务为空，则一直循环读取
+			if(worker->terminate)									//判断是否应该退出,线程结束
+				break;
+			if(timedout && wq->live_workers > wq->min_workers){		//空闲超时，线程数多于最小值，退出
+				retireWorker(worker);
+				pthread_mutex_unlock(&wq->jobs_mtx);
+				pthread_exit(NULL);
+			}
+			if(__atomic_load_n(&wq->timer_next,__ATOMIC_RELAXED) <= nowNs()){	//负责定时器的线程到时间醒来，放开锁处理到期的任务
+				pthread_mutex_unlock(&wq->jobs_mtx);
+				pollTimers(wq);
+				lockJobs(wq);
+				continue;
+			}
+
+			//先放开锁自旋一会儿，等到了任务重新加锁去取
+			if(!spun && wq->spin_ns > 0){
+				spun = 1;
+				pthread_mutex_unlock(&wq->jobs_mtx);
+				int found = spinForWork(worker,&wq->queued);
+				lockJobs(wq);
+				if(found){
+					continue;
+				}
+			}
+
+			//在持有锁的时候登记睡眠，提交者放入任务需要这把锁，之后一定能看到idle>0
+			parkPrepare(worker);
+			int idleMs = wq->live_workers > wq->min_workers ? wq->idle_timeout_ms : -1;	//live_workers只在持有锁时修改，放开锁之前读取
+			pthread_mutex_unlock(&wq->jobs_mtx);
+			timedout = parkWait(worker,idleMs) == ETIMEDOUT;
+			lockJobs(wq);
+			if(!timedout && wq->queued == 0 && !worker->terminate){
+				__atomic_add_fetch(&wq->spurious_wakeups,1,__ATOMIC_RELAXED);	//任务被其他线程先取走了，或者没有原因的唤醒
+			}
+			spun = 0;
+		}
+
+		//退出循环，标识有信号量到达，有新的任务被加入
+		//还是需要判断退出标识
+		if(worker->terminate){
+			pthread_mutex_unlock(&worker->workqueue->jobs_mtx);		//先进行解锁
+			break;													//退出循环,线程结束
+		}
+
+		//下面开始获取任务，是在加锁（前面实现）的情况下进行的，按优先级和老化规则取出，一次最多取dequeue_batch个
+		int n = lanePopBatch(worker->workqueue,batch,worker->workqueue->dequeue_batch,0);
+
+		//开始解锁
+		pthread_mutex_unlock(&worker->workqueue->jobs_mtx);
+
+		//注意：尽可能保持加锁的粒度足够小。所以任务的执行放在外面即可
+		for(int i = 0;i < n;i++){
+			runJob(worker->workqueue,batch[i]);						//传入job数据,给执行任务
+		}
+	}
+
+	pthread_exit(NULL);												//线程退出，worker由threadPoolShutdown在join之后释放
+}
+
+//有线程在睡眠才唤醒一个，和stealWorkerThread中的睡眠过程配合，不会丢失唤醒
+static void wakeWorker(nWorkQueue *wq){
+	unparkWorkers(wq,1);
+}
+
+/*
+从注入队列取任务，先无锁地看一眼是否为空，避免空闲线程反复竞争jobs_mtx
+一次加锁取出多个：返回第一个，其余的放入自己的双端队列（逆序放入，所有者仍然按FIFO执行；其他线程也可以窃取走）
+多取的任务还在pending中，和其他留在队列中的任务一样
+remote为0时取本节点的通道和公共的优先级通道，为1时取其他节点的通道（从下一个节点开始，不总是压在同一个节点上）
+*/
+static nJob *injectPop(nWorker *worker,int remote){
+	nWorkQueue *wq = worker->workqueue;
+	if(__atomic_load_n(&wq->queued,__ATOMIC_RELAXED) == 0){
+		return NULL;
+	}
+
+	nJobDeque *dq = &worker->deque;
+	long space = dq->mask + 1 - (__atomic_load_n(&dq->bottom,__ATOMIC_RELAXED) - __atomic_load_n(&dq->top,__ATOMIC_ACQUIRE));
+	int max = wq->dequeue_batch;
+	if(max > space + 1){
+		max = (int)space + 1;
+	}
+
+	nJob *batch[MAX_DEQUEUE_BATCH];
+	int n = 0;
+	lockJobs(wq);
+	if(!remote){
+		if(useNodeLanes(wq) && preferNodeLane(wq,worker->node)){
+			n = nodeLanePop(wq,worker->node,batch,max);
+		}
+		if(n == 0){
+			n = lanePopBatch(wq,batch,max,1);
+		}
+		if(n == 0 && useNodeLanes(wq)){
+			n = nodeLanePop(wq,worker->node,batch,max);			//公共通道是空的，本节点的通道中还有任务
+		}
+	}else{
+		for(int i = 1;i < wq->num_nodes && n == 0;i++){
+			n = nodeLanePop(wq,(worker->node + i) % wq->num_nodes,batch,max);
+		}
+		wq->remote_pops += n;
+	}
+	pthread_mutex_unlock(&wq->jobs_mtx);
+	if(n == 0){
+		return NULL;
+	}
+
+	for(int i = n - 1;i >= 1;i--){
+		dequePush(dq,batch[i]);									//空间已经预留，不会失败（窃取只会腾出空间）
+	}
+	if(n > 1){
+		wakeWorker(wq);											//多出来的任务可以被其他线程窃取
+	}
+	return batch[0];
+}
+
+/*
+随机选择其他线程窃取，最多尝试两轮
+remote为0时只窃取本节点的线程（不分节点时就是所有线程），为1时只窃取其他节点的线程
+*/
+static nJob *stealJob(nWorker *worker,int remote){
+	nWorkQueue *wq = worker->workqueue;
+	int n = __atomic_load_n(&wq->num_workers,__ATOMIC_ACQUIRE);		//新增加的线程先放入worker_array再增加num_workers
+	if(n <= 1 || (remote && !useNodeLanes(wq))){
+		return NULL;
+	}
+	for(int i = 0;i < 2 * n;i++){
+		int victim = rand_r(&worker->seed) % n;
+		if(victim == worker->index){
+			continue;
+		}
+		nWorker *other = __atomic_load_n(&wq->worker_array[victim],__ATOMIC_ACQUIRE);
+		if(useNodeLanes(wq) && (other->node != worker->node) != remote){
+			continue;
+		}
+		nJob *job = dequeSteal(&other->deque);
+		if(job != DEQUE_EMPTY && job != DEQUE_ABORT){
+			if(remote){
+				__atomic_add_fetch(&wq->remote_steals,1,__ATOMIC_RELAXED);
+			}
+			return job;
+		}
+	}
+	return NULL;
+}
+
+/*
+工作窃取模式的线程工作方法
+没有任务时先自旋，再睡眠：parkPrepare（idle+1）之后检查pending；提交：pending+1之后再检查idle。两边都是顺序一致的原子操作，
+所以至少有一方能看到对方的修改：要么线程看到pending>0不睡眠，要么提交者看到idle>0去唤醒（先写park_word再唤醒，唤醒不会在线程进入等待之前丢失）
+睡眠和唤醒都不需要jobs_mtx，只有空闲退出时加锁
+*/
+static void *stealWorkerThread(void *ptr){
+	nWorker *worker = (nWorker *)ptr;
+	nWorkQueue *wq = worker->workqueue;
+	currentWorker = worker;
+	__atomic_sub_fetch(&wq->starting,1,__ATOMIC_RELAXED);
+
+	while(!__atomic_load_n(&worker->terminate,__ATOMIC_ACQUIRE)){
+		pollTimers(wq);												//到期的定时任务先放入注入队列
+		nJob *job = NULL;
+		if(__atomic_load_n(&wq->lanes[THREADPOOL_PRIO_HIGH].count,__ATOMIC_RELAXED) > 0){
+			job = injectPop(worker,0);								//0.有高优先级任务，先于自己队列中的普通任务
+		}
+		if(job == NULL){
+			job = dequePop(&worker->deque);							//1.自己的队列，最近提交的任务，缓存最热
+		}
+		if(job == NULL){
+			job = injectPop(worker,0);								//2.外部提交的任务：本节点的通道和公共通道
+		}
+		if(job == NULL){
+			job = stealJob(worker,0);								//3.窃取本节点其他线程的任务
+		}
+		if(job == NULL){
+			job = injectPop(worker,1);								//4.本节点没有任务了，才取其他节点的通道
+		}
+		if(job == NULL){
+			job = stealJob(worker,1);								//5.窃取其他节点的线程
+		}
+
+		if(job != NULL){
+			__atomic_sub_fetch(&wq->pending,1,__ATOMIC_SEQ_CST);
+			runJob(wq,job);
+			continue;
+		}
+
+		if(__atomic_load_n(&wq->pending,__ATOMIC_SEQ_CST) > 0){		//有任务但是还没有出现在队列中（提交者先增加pending），或者窃取时竞争失败，再试一次
+			sched_yield();
+			continue;
+		}
+
+		if(spinForWork(worker,&wq->pending)){
+			continue;
+		}
+
+		parkPrepare(worker);
+		if(__atomic_load_n(&wq->pending,__ATOMIC_SEQ_CST) > 0 || __atomic_load_n(&worker->terminate,__ATOMIC_ACQUIRE)
+			|| __atomic_load_n(&wq->timer_next,__ATOMIC_RELAXED) <= nowNs()){
+			parkCancel(worker);
+			continue;
+		}
+		int timedout = parkWait(worker,__atomic_load_n(&wq->live_workers,__ATOMIC_RELAXED) > wq->min_workers ? wq->idle_timeout_ms : -1) == ETIMEDOUT;
+		int idleNow = __atomic_load_n(&wq->pending,__ATOMIC_SEQ_CST) == 0 && !__atomic_load_n(&worker->terminate,__ATOMIC_ACQUIRE);
+		if(!timedout){
+			if(idleNow){
+				__atomic_add_fetch(&wq->spurious_wakeups,1,__ATOMIC_RELAXED);
+			}
+			continue;
+		}
+
+		//空闲超时并且线程数多于最小值，退出。自己的队列一定是空的：只有自己会往里放任务
+		if(idleNow){
+			lockJobs(wq);
+			if(__atomic_load_n(&wq->pending,__ATOMIC_SEQ_CST) == 0 && !__atomic_load_n(&worker->terminate,__ATOMIC_ACQUIRE)
+				&& wq->live_workers > wq->min_workers){
+				retireWorker(worker);
+				pthread_mutex_unlock(&wq->jobs_mtx);
+				break;
+			}
+			pthread_mutex_unlock(&wq->jobs_mtx);
+		}
+	}
+
+	currentWorker = NULL;
+	pthread_exit(NULL);
+}
+
+//创建参数设置为默认值
+void threadPoolAttrInit(nThreadPoolAttr *attr){
+	attr->sched = THREADPOOL_SCHED_STEALING;
+	attr->deque_size = THREADPOOL_DEQUE_SIZE;
+	attr->aging_ms = THREADPOOL_AGING_MS;
+	attr->dequeue_batch = THREADPOOL_DEQUEUE_BATCH;
+	attr->min_workers = 0;
+	attr->max_workers = 0;
+	attr->grow_wait_ms = THREADPOOL_GROW_WAIT_MS;
+	attr->grow_depth = THREADPOOL_GROW_DEPTH;
+	attr->idle_timeout_ms = THREADPOOL_IDLE_TIMEOUT_MS;
+	attr->capacity = MAX_JOBS_COUNT;
+	attr->job_slots = 0;
+	attr->affinity = THREADPOOL_AFFINITY_NONE;
+	attr->cpu_list = NULL;
+	attr->numa = 0;
+	attr->nodes = 0;
+	attr->spin_us = -1;
+}
+
+/*
+启动一个线程，需要持有jobs_mtx
+优先重用已经退出的线程留下的worker（先回收那个线程），没有的话在worker_array中占用一个新的位置
+*/
+static int spawnWorker(nWorkQueue *wq){
+	nWorker *worker = NULL;
+	for(int i = 0;i < wq->num_workers;i++){
+		if(!wq->worker_array[i]->active){
+			worker = wq->worker_array[i];
+			break;
+		}
+	}
+
+	if(worker != NULL){
+		if(worker->thread){
+			pthread_join(worker->thread,NULL);				//退出的线程已经放开了jobs_mtx，马上就会结束
+			worker->thread = 0;
+		}
+	}else{
+		if(wq->num_workers >= wq->max_workers){
+			return -1;
+		}
+		//初始化线程worker空间
+		worker = (nWorker*)malloc(sizeof(nWorker));
+		if(worker == NULL){
+			perror("malloc error!\n");
+			return -1;
+		}
+		memset(worker,0,sizeof(nWorker));
+
+		//初始化worker数据结构
+		worker->workqueue = wq;
+		worker->index = wq->num_workers;
+		worker->seed = (unsigned int)(worker->index * 2654435761u + 1);
+		placeWorker(wq,worker);
+
+		if(wq->sched == THREADPOOL_SCHED_STEALING && dequeInit(&worker->deque,wq->deque_size) != 0){
+			perror("deque malloc error!\n");
+			free(worker);
+			return -1;
+		}
+
+		//先放入worker_array再增加num_workers，窃取的线程看到的位置都是有效的
+		__atomic_store_n(&wq->worker_array[worker->index],worker,__ATOMIC_RELEASE);
+		__atomic_store_n(&wq->num_workers,worker->index + 1,__ATOMIC_RELEASE);
+	}
+
+	worker->terminate = 0;
+	worker->active = 1;
+	__atomic_store_n(&worker->busy_ns,0,__ATOMIC_RELAXED);		//统计从这次启动开始
+	__atomic_store_n(&worker->jobs,0,__ATOMIC_RELAXED);
+	__atomic_store_n(&worker->start_ns,nowNs(),__ATOMIC_RELAXED);
+	__atomic_add_fetch(&wq->live_workers,1,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&wq->starting,1,__ATOMIC_RELAXED);
+
+	/*
+	线程创建：pthread_create
+	参数1：新创建的线程ID指向的内存单元。
+	参数2：线程属性，默认为NULL。比如可以设置线程分离。这里用来在线程启动前绑定CPU，线程的栈和第一次分配的内存就在所属的节点上
+	参数3：新创建的线程从参数3函数的地址开始运行。
+	参数4：默认为NULL。若上述函数需要参数，将参数放入结构中并将地址作为arg传入。
+	*/
+	pthread_attr_t thread_attr;
+	pthread_attr_t *pattr = NULL;
+	if(wq->affinity != THREADPOOL_AFFINITY_NONE){
+		cpu_set_t cpus;
+		if(worker->cpu >= 0){
+			CPU_ZERO(&cpus);
+			CPU_SET(worker->cpu,&cpus);
+		}else{
+			cpus = wq->topology->cpus[worker->node];
+		}
+		pthread_attr_init(&thread_attr);
+		pthread_attr_setaffinity_np(&thread_attr,sizeof(cpus),&cpus);
+		pattr = &thread_attr;
+	}
+	int ret = pthread_create(&worker->thread,pattr,
+					wq->sched == THREADPOOL_SCHED_STEALING ? stealWorkerThread : workerThread,(void *)worker);
+	if(pattr != NULL){
+		pthread_attr_destroy(pattr);
+	}
+	if(ret){
+		perror("pthread_create error!\n");
+		worker->thread = 0;
+		worker->active = 0;
+		__atomic_sub_fetch(&wq->live_workers,1,__ATOMIC_RELAXED);
+		__atomic_sub_fetch(&wq->starting,1,__ATOMIC_RELAXED);
+		return -1;
+	}
+
+	LL_ADD(worker,wq->workers);
+	return 0;
+}
+
+/*
+线程池的创建
+参数1：由调用该函数的方法传入，参数实际存放在栈中，所以不需要我们去释放
+*/
+int threadPoolCreate(nThreadPool *workqueue, int numWorkers){
+	return threadPoolCreateEx(workqueue,numWorkers,NULL);
+}
+
+int threadPoolCreateEx(nThreadPool *workqueue, int numWorkers, const nThreadPoolAttr *attr){
+	nThreadPoolAttr def;
+	if(attr == NULL){
+		threadPoolAttrInit(&def);
+		attr = &def;
+	}
+	if(numWorkers < 1){
+		numWorkers = 1;
+	}
+
+	memset(workqueue,0,sizeof(nThreadPool));	//初始化线程池
+
+	pthread_cond_t blank_cond = PTHREAD_COND_INITIALIZER;
+
+	pthread_mutex_t blank_mutex = PTHREAD_MUTEX_INITIALIZER;
+	memcpy(&workqueue->jobs_mtx,&blank_mutex,sizeof(workqueue->jobs_mtx));
+	memcpy(&workqueue->park_mtx,&blank_mutex,sizeof(workqueue->park_mtx));
+	memcpy(&workqueue->timer_mtx,&blank_mutex,sizeof(workqueue->timer_mtx));
+	memcpy(&workqueue->notfull_cond,&blank_cond,sizeof(workqueue->notfull_cond));
+	memcpy(&workqueue->stats_cond,&blank_cond,sizeof(workqueue->stats_cond));
+
+	workqueue->sched = attr->sched;
+	workqueue->aging_ns = attr->aging_ms > 0 ? (unsigned long long)attr->aging_ms * 1000000ULL : 0;
+	workqueue->dequeue_batch = attr->dequeue_batch < 1 ? 1 : (attr->dequeue_batch > MAX_DEQUEUE_BATCH ? MAX_DEQUEUE_BATCH : attr->dequeue_batch);
+	workqueue->deque_size = attr->deque_size;
+	workqueue->min_workers = attr->min_workers > 0 ? attr->min_workers : numWorkers;
+	workqueue->max_workers = attr->max_workers > 0 ? attr->max_workers : numWorkers;
+	if(workqueue->max_workers > MAX_THREADS_COUNT){				//threadPoolStats按worker_array的下标输出，最多MAX_THREADS_COUNT个
+		workqueue->max_workers = MAX_THREADS_COUNT;
+	}
+	if(workqueue->min_workers > workqueue->max_workers){
+		workqueue->min_workers = workqueue->max_workers;
+	}
+	if(numWorkers < workqueue->min_workers){
+		numWorkers = workqueue->min_workers;
+	}
+	if(numWorkers > workqueue->max_workers){
+		numWorkers = workqueue->max_workers;
+	}
+	workqueue->grow_wait_ns = attr->grow_wait_ms > 0 ? (unsigned long long)attr->grow_wait_ms * 1000000ULL : 0;
+	workqueue->grow_depth = attr->grow_depth;
+	workqueue->idle_timeout_ms = attr->idle_timeout_ms > 0 ? attr->idle_timeout_ms : THREADPOOL_IDLE_TIMEOUT_MS;
+	workqueue->capacity = attr->capacity > 0 ? attr->capacity : 0;
+	int spin_us = attr->spin_us;
+	if(spin_us < 0){
+		spin_us = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? THREADPOOL_SPIN_US : 0;	//只有一个CPU时自旋只会推迟提交者
+	}
+	workqueue->spin_ns = (unsigned long long)spin_us * 1000ULL;
+	workqueue->timer_next = ULLONG_MAX;
+	if(topologyInit(workqueue,attr) != 0){
+		return -1;
+	}
+	if(slotsInit(workqueue,attr->job_slots) != 0){
+		perror("job slots malloc error!\n");
+		free(workqueue->topology);
+		workqueue->topology = NULL;
+		return -1;
+	}
+
+	workqueue->worker_array = (nWorker **)calloc(workqueue->max_workers,sizeof(nWorker *));
+	if(workqueue->worker_array == NULL){
+		perror("calloc error!\n");
+		free(workqueue->slots);
+		workqueue->slots = NULL;
+		free(workqueue->topology);
+		workqueue->topology = NULL;
+		return -1;
+	}
+
+	lockJobs(workqueue);
+	for(int i = 0;i < numWorkers;i++){
+		if(spawnWorker(workqueue) != 0){
+			pthread_mutex_unlock(&workqueue->jobs_mtx);
+			threadPoolShutdown(workqueue);		//已经启动的线程由threadPoolShutdown结束并释放
+			return -1;
+		}
+	}
+	pthread_mutex_unlock(&workqueue->jobs_mtx);
+
+	return 0;
+}
+
+//=========================提交任务=========================
+#define SUBMIT_BLOCK	0						//队列满时阻塞
+#define SUBMIT_TRY		1						//队列满时立即失败
+#define SUBMIT_TIMED	2						//队列满时等到deadline
+
+/*
+需要持有jobs_mtx：等待注入队列中有n个空位，成功返回0
+队列为空时总是可以放入，所以n大于容量的批量提交也能完成
+*/
+static int waitForSpace(nWorkQueue *wq,long n,int mode,const struct timespec *deadline){
+	int counted = 0;
+	while(!wq->shutdown && wq->capacity > 0 && wq->queued > 0 && wq->queued + n > wq->capacity){
+		if(mode == SUBMIT_TRY){
+			wq->rejected++;
+			return -1;
+		}
+		if(!counted){
+			wq->blocked++;
+			counted = 1;
+		}
+		wq->waiting_producers++;
+		int ret = mode == SUBMIT_TIMED ? pthread_cond_timedwait(&wq->notfull_cond,&wq->jobs_mtx,deadline)
+									   : pthread_cond_wait(&wq->notfull_cond,&wq->jobs_mtx);
+		wq->waiting_producers--;
+		if(ret == ETIMEDOUT && !wq->shutdown && wq->queued > 0 && wq->queued + n > wq->capacity){
+			wq->timeouts++;
+			return -1;
+		}
+	}
+	return wq->shutdown ? -1 : 0;
+}
+
+//node是节点提示，-1表示没有；有效的节点提示只用于普通优先级。expire_ns是过期时间，0表示不过期
+static int queueJob(nWorkQueue *workQueue,nJob *job,int priority,int mode,int timeout_ms,int node,unsigned long long expire_ns){
+	if(priority < 0 || priority >= THREADPOOL_LANES){
+		priority = THREADPOOL_PRIO_NORMAL;
+	}
+	job->priority = priority;
+	job->timer_state = THREADPOOL_TIMER_NONE;
+	job->run_state = THREADPOOL_JOB_QUEUED;
+	job->expire_ns = expire_ns;
+	if(node >= workQueue->num_nodes || !useNodeLanes(workQueue)){
+		node = -1;
+	}
+
+	//线程池自己的线程提交的任务不受容量限制
+	nWorker *worker = currentWorker;
+	int internal = worker != NULL && worker->workqueue == workQueue;
+
+	//工作线程自己的队列只放普通优先级：所有者LIFO取（缓存热），窃取者从另一端FIFO取；指定了其他节点的任务放入那个节点的通道
+	if(workQueue->sched == THREADPOOL_SCHED_STEALING && internal && priority == THREADPOOL_PRIO_NORMAL && (node < 0 || node == worker->node)){
+		job->enqueue_ns = nowNs();
+		//先增加pending再让任务可见，取走任务的线程减pending时，pending一定已经加过了
+		__atomic_add_fetch(&workQueue->pending,1,__ATOMIC_SEQ_CST);
+		if(dequePush(&worker->deque,job) == 0){
+			wakeWorker(workQueue);
+			return 0;
+		}
+		__atomic_sub_fetch(&workQueue->pending,1,__ATOMIC_SEQ_CST);	//自己的队列满了，放入注入队列
+	}
+
+	struct timespec deadline;
+	if(mode == SUBMIT_TIMED){
+		deadlineAfter(timeout_ms > 0 ? timeout_ms : 0,&deadline);
+	}
+
+	lockJobs(workQueue);	//先进行加锁操作
+	if(internal ? workQueue->shutdown : waitForSpace(workQueue,1,mode,&deadline) != 0){
+		pthread_mutex_unlock(&workQueue->jobs_mtx);
+		return -1;
+	}
+
+	job->enqueue_ns = nowNs();					//排队时间从放入队列开始算，不包括等待空位的时间
+	if(workQueue->sched == THREADPOOL_SCHED_STEALING){
+		__atomic_add_fetch(&workQueue->pending,1,__ATOMIC_SEQ_CST);
+	}
+	//添加任务到对应通道的尾部，FIFO
+	laneAppend(workQueue,node >= 0 ? &workQueue->node_lanes[node] : &workQueue->lanes[priority],job);
+	if(queueTooDeep(workQueue)){
+		growLocked(workQueue);					//积压太多，增加线程
+	}
+	pthread_mutex_unlock(&workQueue->jobs_mtx);	//进行解锁操作
+
+	wakeWorker(workQueue);						//通知其他线程，有新的任务到达，可以读取执行了；没有线程睡眠时不需要系统调用
+	return 0;
+}
+
+//为线程池中添加任务
+int threadPoolQueue(nThreadPool *workQueue,nJob *job){
+	return queueJob(workQueue,job,THREADPOOL_PRIO_NORMAL,SUBMIT_BLOCK,0,-1,0);
+}
+
+int threadPoolQueuePriority(nThreadPool *workQueue,nJob *job,int priority){
+	return queueJob(workQueue,job,priority,SUBMIT_BLOCK,0,-1,0);
+}
+
+int threadPoolTryQueue(nThreadPool *workQueue,nJob *job){
+	return queueJob(workQueue,job,THREADPOOL_PRIO_NORMAL,SUBMIT_TRY,0,-1,0);
+}
+
+int threadPoolQueueTimed(nThreadPool *workQueue,nJob *job,int timeout_ms){
+	return queueJob(workQueue,job,THREADPOOL_PRIO_NORMAL,SUBMIT_TIMED,timeout_ms,-1,0);
+}
+
+int threadPoolQueueNode(nThreadPool *workQueue,nJob *job,int node){
+	return queueJob(workQueue,job,THREADPOOL_PRIO_NORMAL,SUBMIT_BLOCK,0,node,0);
+}
+
+/*
+批量添加任务：所有任务一次加锁接入普通优先级通道，唤醒的线程数不超过min(n,空闲线程数)
+任务之间的链接在锁外完成，锁内只是把整段接到通道尾部
+*/
+int threadPoolQueueBatch(nThreadPool *workQueue,nJob **jobs,int n){
+	if(n <= 0){
+		return 0;
+	}
+	unsigned long long now = nowNs();
+	for(int i = 0;i < n;i++){
+		jobs[i]->priority = THREADPOOL_PRIO_NORMAL;
+		jobs[i]->timer_state = THREADPOOL_TIMER_NONE;
+		jobs[i]->run_state = THREADPOOL_JOB_QUEUED;
+		jobs[i]->expire_ns = 0;
+		jobs[i]->enqueue_ns = now;								//放入自己队列的任务马上可以被窃取，先记录
+	}
+
+	//工作线程中提交，工作窃取模式下先放入自己的队列，放不下的再放入注入队列
+	nWorker *worker = currentWorker;
+	int internal = worker != NULL && worker->workqueue == workQueue;
+	int first = 0;
+	if(workQueue->sched == THREADPOOL_SCHED_STEALING && internal){
+		__atomic_add_fetch(&workQueue->pending,n,__ATOMIC_SEQ_CST);
+		while(first < n && dequePush(&worker->deque,jobs[first]) == 0){
+			first++;
+		}
+		__atomic_sub_fetch(&workQueue->pending,n - first,__ATOMIC_SEQ_CST);	//剩下的在放入注入队列时再加
+	}
+
+	for(int i = first;i < n;i++){
+		jobs[i]->prev = i > first ? jobs[i - 1] : NULL;
+		jobs[i]->next = i + 1 < n ? jobs[i + 1] : NULL;
+	}
+
+	//全部放进了自己的队列，不需要加锁（和单个提交一样由pending/idle的顺序保证不丢失唤醒）
+	if(first < n){
+		lockJobs(workQueue);
+		if(internal ? workQueue->shutdown : waitForSpace(workQueue,n - first,SUBMIT_BLOCK,NULL) != 0){
+			pthread_mutex_unlock(&workQueue->jobs_mtx);
+			return -1;
+		}
+		now = nowNs();												//和单个提交一样，排队时间不包括等待空位的时间
+		for(int i = first;i < n;i++){
+			jobs[i]->enqueue_ns = now;
+		}
+		if(workQueue->sched == THREADPOOL_SCHED_STEALING){
+			__atomic_add_fetch(&workQueue->pending,n - first,__ATOMIC_SEQ_CST);
+		}
+		laneSplice(workQueue,THREADPOOL_PRIO_NORMAL,jobs[first],jobs[n - 1],n - first);
+		if(queueTooDeep(workQueue)){
+			growLocked(workQueue);
+		}
+		pthread_mutex_unlock(&workQueue->jobs_mtx);
+	}
+	unparkWorkers(workQueue,n);										//一次系统调用唤醒最多n个线程
+	return 0;
+}
+
+//定时任务：到期时间从调用时开始算，job在取消或者执行完之前不能释放
+static int scheduleJob(nWorkQueue *workQueue,nJob *job,unsigned int delay_ms,unsigned int period_ms){
+	job->priority = THREADPOOL_PRIO_NORMAL;
+	job->run_state = THREADPOOL_JOB_QUEUED;
+	job->expire_ns = 0;
+	job->deadline_ns = nowNs() + (unsigned long long)delay_ms * 1000000ULL;
+	job->period_ns = (unsigned long long)period_ms * 1000000ULL;
+	int top = 0;
+	pthread_mutex_lock(&workQueue->timer_mtx);
+	int ret = timerAddLocked(workQueue,job,&top);
+	pthread_mutex_unlock(&workQueue->timer_mtx);
+	if(top){
+		kickTimers(workQueue);
+	}
+	return ret;
+}
+
+int threadPoolSchedule(nThreadPool *workQueue,nJob *job,unsigned int delay_ms){
+	return scheduleJob(workQueue,job,delay_ms,0);
+}
+
+int threadPoolScheduleEvery(nThreadPool *workQueue,nJob *job,unsigned int delay_ms,unsigned int period_ms){
+	if(period_ms == 0){
+		return -1;
+	}
+	return scheduleJob(workQueue,job,delay_ms,period_ms);
+}
+
+/*
+取消定时任务：还在堆中的直接删除，返回0，job归还调用者（任务槽用threadPoolJobFree归还）
+周期任务已经到期（在排队或执行）时标记为取消，返回-1，执行完这一次之后timer_state变为THREADPOOL_TIMER_NONE
+删除的是堆顶时不通知负责定时器的线程，它按原来的时间醒来，发现没有到期的任务再睡眠
+*/
+int threadPoolCancel(nThreadPool *workQueue,nJob *job){
+	int ret = -1;
+	pthread_mutex_lock(&workQueue->timer_mtx);
+	int state = __atomic_load_n(&job->timer_state,__ATOMIC_RELAXED);
+	if(state == THREADPOOL_TIMER_PENDING){
+		heapRemove(workQueue,job->timer_index);
+		__atomic_store_n(&job->timer_state,THREADPOOL_TIMER_NONE,__ATOMIC_RELAXED);
+		timerNextUpdate(workQueue);
+		ret = 0;
+	}else if(state == THREADPOOL_TIMER_FIRED){
+		__atomic_store_n(&job->timer_state,THREADPOOL_TIMER_CANCELLED,__ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&workQueue->timer_mtx);
+	return ret;
+}
+
+//过期时间从调用时开始算，等待队列空位的时间也算在内，等到过期还没有空位就返回-1
+int threadPoolQueueDeadline(nThreadPool *workQueue,nJob *job,int priority,unsigned int timeout_ms){
+	unsigned long long expire = nowNs() + (unsigned long long)timeout_ms * 1000000ULL;
+	return queueJob(workQueue,job,priority,SUBMIT_TIMED,(int)(timeout_ms > INT_MAX ? INT_MAX : timeout_ms),-1,expire);
+}
+
+//只是标记，任务留在队列中，取出它的线程丢弃并调用drop_function；队列中的位置到那时才释放
+int threadPoolJobCancel(nThreadPool *workQueue,nJob *job){
+	(void)workQueue;
+	int state = THREADPOOL_JOB_QUEUED;
+	return __atomic_compare_exchange_n(&job->run_state,&state,THREADPOOL_JOB_CANCELLED,0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE) ? 0 : -1;
+}
+
+//=========================串行队列（strand）=========================
+/*
+Vyukov的侵入式MPSC队列，用nJob的next链接：head是最早的任务，tail是最后提交的任务，stub保证队列中至少有一个节点
+提交：job->next=NULL，交换tail，再把前一个节点的next指向job；交换和链接之间队列是断开的，runner看不到job
+取出：head的next不为NULL时取走head；head是最后一个节点时先把stub放到队尾，才能取走它
+runner只在pending大于0时取任务，pending在交换tail之后才增加，所以要取的任务一定已经交换过，最多等提交者完成链接
+*/
+static __thread nStrand *currentStrand = NULL;			//调用线程正在执行的strand
+
+static void strandPush(nStrand *strand,nJob *job){
+	__atomic_store_n(&job->next,NULL,__ATOMIC_RELAXED);
+	nJob *prev = __atomic_exchange_n(&strand->tail,job,__ATOMIC_ACQ_REL);
+	__atomic_store_n(&prev->next,job,__ATOMIC_RELEASE);		//之后runner才能通过prev找到job
+}
+
+//取出队首的任务，只有runner调用；提交者还没有完成链接时返回NULL，调用者稍后再试
+static nJob *strandPop(nStrand *strand){
+	nJob *head = strand->head;
+	nJob *next = __atomic_load_n(&head->next,__ATOMIC_ACQUIRE);
+	if(head == &strand->stub){
+		if(next == NULL){
+			return NULL;
+		}
+		strand->head = head = next;								//跳过stub
+		next = __atomic_load_n(&head->next,__ATOMIC_ACQUIRE);
+	}
+	if(next != NULL){
+		strand->head = next;
+		return head;
+	}
+	if(head != __atomic_load_n(&strand->tail,__ATOMIC_ACQUIRE)){
+		return NULL;											//后面的任务已经交换了tail，还没有链接
+	}
+	strandPush(strand,&strand->stub);							//head是最后一个节点，放入stub之后它就有了后继
+	next = __atomic_load_n(&head->next,__ATOMIC_ACQUIRE);
+	if(next != NULL){
+		strand->head = next;
+		return head;
+	}
+	return NULL;												//stub之前又有任务交换了tail，还没有链接
+}
+
+//runner：执行这一轮开始时已经提交的任务，最多THREADPOOL_STRAND_BATCH个；还有剩余就把自己重新放入线程池
+static void strandRun(nJob *runner){
+	nStrand *strand = (nStrand *)runner->user_data;
+	nWorkQueue *wq = strand->workqueue;
+	nStrand *outer = currentStrand;								//strand的任务中调用threadPoolRunOne时可能嵌套
+	currentStrand = strand;
+	long todo = __atomic_load_n(&strand->pending,__ATOMIC_ACQUIRE);
+	if(todo > THREADPOOL_STRAND_BATCH){
+		todo = THREADPOOL_STRAND_BATCH;
+	}
+	for(long i = 0;i < todo;i++){
+		nJob *job;
+		for(int spin = 1;(job = strandPop(strand)) == NULL;spin++){
+			if((spin & 63) == 0){
+				sched_yield();									//提交者在交换和链接之间被切换出去了
+			}else{
+				cpuRelax();
+			}
+		}
+		runJob(wq,job);											//和直接放入线程池的任务一样统计、丢弃和归还任务槽
+	}
+	currentStrand = outer;
+	__atomic_store_n(&strand->executed,strand->executed + todo,__ATOMIC_RELAXED);
+	__atomic_store_n(&strand->turns,strand->turns + 1,__ATOMIC_RELAXED);
+	//减到0之后新的提交者会放入runner，这里不能再访问strand
+	if(__atomic_sub_fetch(&strand->pending,todo,__ATOMIC_ACQ_REL) > 0){
+		threadPoolQueue(wq,runner);								//工作线程提交不会阻塞；线程池已经关闭时剩下的任务被丢弃
+	}
+}
+
+void threadPoolStrandInit(nThreadPool *workQueue,nStrand *strand){
+	memset(strand,0,sizeof(nStrand));
+	strand->workqueue = workQueue;
+	strand->head = strand->tail = &strand->stub;
+	strand->runner.job_function = strandRun;
+	strand->runner.user_data = strand;
+}
+
+int threadPoolStrandPost(nStrand *strand,nJob *job){
+	job->priority = THREADPOOL_PRIO_NORMAL;
+	job->enqueue_ns = nowNs();									//排队时间包括在strand中等待前面任务的时间
+	job->timer_state = THREADPOOL_TIMER_NONE;
+	job->run_state = THREADPOOL_JOB_QUEUED;
+	job->expire_ns = 0;
+	strandPush(strand,job);
+	if(__atomic_fetch_add(&strand->pending,1,__ATOMIC_ACQ_REL) == 0){
+		return threadPoolQueue(strand->workqueue,&strand->runner);	//strand空闲，由这次提交放入runner
+	}
+	return 0;
+}
+
+int threadPoolStrandRunning(nStrand *strand){
+	return currentStrand == strand;
+}
+
+long threadPoolStrandPending(nStrand *strand){
+	return __atomic_load_n(&strand->pending,__ATOMIC_ACQUIRE);
+}
+
+/*
+在调用线程中执行一个还没有开始的任务，执行了返回1，没有可执行的任务返回0
+用于等待结果的线程帮忙执行任务，而不是阻塞：工作线程在任务中等待其他任务时，如果只是阻塞，所有线程都在等待就会死锁
+工作线程调用时先取自己的队列；外部线程调用时只从注入队列取，或者从工作线程的队列窃取
+*/
+int threadPoolRunOne(nThreadPool *workQueue){
+	nJob *job = NULL;
+	nWorker *worker = currentWorker;
+	if(worker != NULL && worker->workqueue != workQueue){
+		worker = NULL;												//其他线程池的工作线程，当作外部线程
+	}
+
+	if(workQueue->sched == THREADPOOL_SCHED_GLOBAL){
+		if(__atomic_load_n(&workQueue->queued,__ATOMIC_RELAXED) == 0){
+			return 0;
+		}
+		lockJobs(workQueue);
+		job = lanePop(workQueue);
+		pthread_mutex_unlock(&workQueue->jobs_mtx);
+	}else if(worker != NULL){
+		job = dequePop(&worker->deque);
+		if(job == NULL){
+			job = injectPop(worker,0);
+		}
+		if(job == NULL){
+			job = stealJob(worker,0);
+		}
+		if(job == NULL){
+			job = injectPop(worker,1);
+		}
+		if(job == NULL){
+			job = stealJob(worker,1);
+		}
+	}else{
+		if(__atomic_load_n(&workQueue->queued,__ATOMIC_RELAXED) > 0){
+			lockJobs(workQueue);
+			job = lanePop(workQueue);
+			for(int i = 0;job == NULL && useNodeLanes(workQueue) && i < workQueue->num_nodes;i++){
+				nodeLanePop(workQueue,i,&job,1);						//外部线程不属于任何节点，依次看各个节点的通道
+			}
+			pthread_mutex_unlock(&workQueue->jobs_mtx);
+		}
+		static __thread unsigned int seed = 0;
+		if(seed == 0){
+			seed = (unsigned int)(unsigned long)&seed | 1;
+		}
+		int n = __atomic_load_n(&workQueue->num_workers,__ATOMIC_ACQUIRE);
+		for(int i = 0;job == NULL && i < n;i++){
+			nJob *stolen = dequeSteal(&__atomic_load_n(&workQueue->worker_array[rand_r(&seed) % n],__ATOMIC_ACQUIRE)->deque);
+			if(stolen != DEQUE_EMPTY && stolen != DEQUE_ABORT){
+				job = stolen;
+			}
+		}
+	}
+
+	if(job == NULL){
+		return 0;
+	}
+	if(workQueue->sched == THREADPOOL_SCHED_STEALING){
+		__atomic_sub_fetch(&workQueue->pending,1,__ATOMIC_SEQ_CST);
+	}
+	runJob(workQueue,job);
+	return 1;
+}
+
+//线程池关闭退出
+void threadPoolShutdown(nThreadPool *workQueue){
+	nWorker *worker = NULL;
+
+	lockJobs(workQueue);		//加锁，清空任务
+	workQueue->shutdown = 1;						//之后不会再增加线程，worker_array不再变化
+
+	//遍历所有的线程worker，设置标识变量terminate
+	for(int i = 0;i < workQueue->num_workers;i++){
+		__atomic_store_n(&workQueue->worker_array[i]->terminate,1,__ATOMIC_RELEASE);
+	}
+	workQueue->workers = NULL;
+	memset(workQueue->lanes,0,sizeof(workQueue->lanes));
+	memset(workQueue->node_lanes,0,sizeof(workQueue->node_lanes));
+	__atomic_store_n(&workQueue->queued,0,__ATOMIC_RELAXED);
+
+	unparkWorkers(workQueue,INT_MAX);				//唤醒所有睡眠的线程，它们看到terminate之后退出
+	pthread_cond_broadcast(&workQueue->notfull_cond);	//阻塞的提交者返回-1
+	pthread_cond_broadcast(&workQueue->stats_cond);
+	pthread_mutex_unlock(&workQueue->jobs_mtx);		//解锁
+
+	if(workQueue->stats_interval_ms > 0){			//统计线程会读取worker，先停止它
+		pthread_join(workQueue->stats_thread,NULL);
+		workQueue->stats_interval_ms = 0;
+	}
+
+	//等待线程退出之后再释放worker和它的队列，线程可能还在窃取其他线程的队列。不能在线程池自己的线程中调用
+	//空闲退出的线程还没有被回收的也在这里回收
+	for(int i = 0;i < workQueue->num_workers;i++){
+		worker = workQueue->worker_array[i];
+		if(worker->thread){
+			pthread_join(worker->thread,NULL);
+		}
+	}
+	for(int i = 0;i < workQueue->num_workers;i++){
+		worker = workQueue->worker_array[i];
+		free(worker->deque.buffer);
+		free(worker);
+	}
+	free(workQueue->worker_array);
+	workQueue->worker_array = NULL;
+	free(workQueue->slots);						//还没有执行的任务槽随线程池一起释放
+	workQueue->slots = NULL;
+	workQueue->slot_count = 0;
+	free(workQueue->topology);
+	workQueue->topology = NULL;
+	free(workQueue->timer_mem);					//还没有到期的定时任务和通道中的任务一样丢弃
+	workQueue->timer_mem = NULL;
+	workQueue->timer_heap = NULL;
+	workQueue->timer_count = 0;
+	workQueue->timer_cap = 0;
+	workQueue->timer_next = ULLONG_MAX;
+	workQueue->num_workers = 0;
+	workQueue->live_workers = 0;
+	workQueue->pending = 0;
+}
+
+//取一个任务槽，参数区清零由调用者决定
+nJob *threadPoolJobAlloc(nThreadPool *workQueue){
+	nJobSlot *slot = slotPop(workQueue);
+	if(slot == NULL){
+		if(workQueue->slots != NULL){
+			__atomic_add_fetch(&workQueue->slot_exhausted,1,__ATOMIC_RELAXED);
+		}
+		return NULL;
+	}
+	slot->job.user_data = slot->payload;
+	slot->job.prev = slot->job.next = NULL;
+	slot->job.timer_state = THREADPOOL_TIMER_NONE;
+	slot->job.drop_function = NULL;
+	return &slot->job;
+}
+
+void threadPoolJobFree(nThreadPool *workQueue,nJob *job){
+	if(isSlot(workQueue,job)){
+		slotPush(workQueue,(nJobSlot *)job);
+	}
+}
+
+//当前正在运行的线程数
+int threadPoolSize(nThreadPool *workQueue){
+	return __atomic_load_n(&workQueue->live_workers,__ATOMIC_RELAXED);
+}
+
+int threadPoolNodes(nThreadPool *workQueue){
+	return workQueue->num_nodes;
+}
+
+int threadPoolCurrentNode(nThreadPool *workQueue){
+	nWorker *worker = currentWorker;
+	return worker != NULL && worker->workqueue == workQueue ? worker->node : -1;
+}
+
+//原子地逐个读取直方图的计数
+static void histCopy(nHistogram *out,const nHistogram *h){
+	out->count = __atomic_load_n(&h->count,__ATOMIC_RELAXED);
+	out->sum_us = __atomic_load_n(&h->sum_us,__ATOMIC_RELAXED);
+	out->max_us = __atomic_load_n(&h->max_us,__ATOMIC_RELAXED);
+	for(int i = 0;i < THREADPOOL_HIST_BUCKETS;i++){
+		out->buckets[i] = __atomic_load_n(&h->buckets[i],__ATOMIC_RELAXED);
+	}
+}
+
+//读取某个优先级的排队时间直方图（各个计数分别原子读取，整体不是一个快照）
+void threadPoolLaneWait(nThreadPool *workQueue,int priority,nHistogram *out){
+	memset(out,0,sizeof(nHistogram));
+	if(priority < 0 || priority >= THREADPOOL_LANES){
+		return;
+	}
+	histCopy(out,&workQueue->lane_wait[priority]);
+}
+
+//=========================统计=========================
+void threadPoolStats(nThreadPool *workQueue,nThreadPoolStats *out){
+	memset(out,0,sizeof(nThreadPoolStats));
+	pthread_mutex_lock(&workQueue->jobs_mtx);					//不用lockJobs，读取统计不算在加锁次数里
+	out->queued = workQueue->queued;
+	out->max_queued = workQueue->max_queued;
+	out->capacity = workQueue->capacity;
+	out->spawned = workQueue->spawned;
+	out->retired = workQueue->retired;
+	out->blocked = workQueue->blocked;
+	out->rejected = workQueue->rejected;
+	out->timeouts = workQueue->timeouts;
+	out->lock_acquires = workQueue->lock_acquires;
+	out->lock_contended = workQueue->lock_contended;
+	out->remote_pops = workQueue->remote_pops;
+	int n = workQueue->num_workers;
+	pthread_mutex_unlock(&workQueue->jobs_mtx);
+
+	out->time_ns = nowNs();
+	out->pending = __atomic_load_n(&workQueue->pending,__ATOMIC_RELAXED);
+	out->live_workers = __atomic_load_n(&workQueue->live_workers,__ATOMIC_RELAXED);
+	out->idle_workers = __atomic_load_n(&workQueue->idle,__ATOMIC_RELAXED);
+	out->wakeups = __atomic_load_n(&workQueue->wakeups,__ATOMIC_RELAXED);
+	out->spurious_wakeups = __atomic_load_n(&workQueue->spurious_wakeups,__ATOMIC_RELAXED);
+	out->parks = __atomic_load_n(&workQueue->parks,__ATOMIC_RELAXED);
+	out->unparks = __atomic_load_n(&workQueue->unparks,__ATOMIC_RELAXED);
+	out->spin_hits = __atomic_load_n(&workQueue->spin_hits,__ATOMIC_RELAXED);
+	out->slot_exhausted = __atomic_load_n(&workQueue->slot_exhausted,__ATOMIC_RELAXED);
+	out->remote_steals = __atomic_load_n(&workQueue->remote_steals,__ATOMIC_RELAXED);
+	pthread_mutex_lock(&workQueue->timer_mtx);
+	out->timers = workQueue->timer_count;
+	pthread_mutex_unlock(&workQueue->timer_mtx);
+	out->timers_fired = __atomic_load_n(&workQueue->timers_fired,__ATOMIC_RELAXED);
+	out->dropped_cancelled = __atomic_load_n(&workQueue->dropped_cancelled,__ATOMIC_RELAXED);
+	out->dropped_expired = __atomic_load_n(&workQueue->dropped_expired,__ATOMIC_RELAXED);
+	for(int i = 0;i < THREADPOOL_LANES;i++){
+		histCopy(&out->wait[i],&workQueue->lane_wait[i]);
+		histCopy(&out->run[i],&workQueue->lane_run[i]);
+	}
+
+	//worker_array中的worker在线程池关闭之前不会被释放
+	for(int i = 0;i < n && i < MAX_THREADS_COUNT;i++){
+		nWorker *worker = __atomic_load_n(&workQueue->worker_array[i],__ATOMIC_ACQUIRE);
+		nWorkerStats *ws = &out->workers[out->worker_count++];
+		unsigned long long start = __atomic_load_n(&worker->start_ns,__ATOMIC_RELAXED);
+		ws->index = worker->index;
+		ws->node = worker->node;
+		ws->active = __atomic_load_n(&worker->active,__ATOMIC_RELAXED);
+		ws->jobs = __atomic_load_n(&worker->jobs,__ATOMIC_RELAXED);
+		ws->busy_ns = __atomic_load_n(&worker->busy_ns,__ATOMIC_RELAXED);
+		ws->alive_ns = out->time_ns > start ? out->time_ns - start : 0;
+		out->executed += ws->jobs;
+	}
+}
+
+//两个直方图的差，max_us不能相减，用新的
+static void histDelta(nHistogram *out,const nHistogram *cur,const nHistogram *prev){
+	*out = *cur;
+	if(prev == NULL){
+		return;
+	}
+	out->count -= prev->count;
+	out->sum_us -= prev->sum_us;
+	for(int i = 0;i < THREADPOOL_HIST_BUCKETS;i++){
+		out->buckets[i] -= prev->buckets[i];
+	}
+}
+
+void threadPoolStatsPrint(const nThreadPoolStats *cur,const nThreadPoolStats *prev,FILE *fp){
+	static const char *laneNames[THREADPOOL_LANES] = {"high","normal","low"};
+#define STATS_DELTA(field)	(prev != NULL ? cur->field - prev->field : cur->field)
+	char title[32];
+	if(prev != NULL){
+		snprintf(title,sizeof(title),"+%.2fs",(cur->time_ns - prev->time_ns) / 1e9);
+	}else{
+		snprintf(title,sizeof(title),"total");
+	}
+
+	fprintf(fp,"[threadpool %s] workers %d idle %d | queued %ld max %ld capacity %ld pending %ld | spawned %llu retired %llu | executed %llu dropped %llu cancelled %llu expired\n",
+		title,cur->live_workers,cur->idle_workers,cur->queued,cur->max_queued,cur->capacity,cur->pending,
+		STATS_DELTA(spawned),STATS_DELTA(retired),STATS_DELTA(executed),STATS_DELTA(dropped_cancelled),STATS_DELTA(dropped_expired));
+	unsigned long long locks = STATS_DELTA(lock_acquires);
+	fprintf(fp,"  jobs_mtx %llu locks %.1f%% contended | spin hits %llu parks %llu unparks %llu wakeups %llu spurious %llu | blocked %llu rejected %llu timeouts %llu slots exhausted %llu | remote pops %llu steals %llu | timers %ld fired %llu\n",
+		locks,locks > 0 ? 100.0 * STATS_DELTA(lock_contended) / locks : 0.0,STATS_DELTA(spin_hits),STATS_DELTA(parks),STATS_DELTA(unparks),STATS_DELTA(wakeups),STATS_DELTA(spurious_wakeups),
+		STATS_DELTA(blocked),STATS_DELTA(rejected),STATS_DELTA(timeouts),STATS_DELTA(slot_exhausted),STATS_DELTA(remote_pops),STATS_DELTA(remote_steals),
+		cur->timers,STATS_DELTA(timers_fired));
+	for(int i = 0;i < THREADPOOL_LANES;i++){
+		nHistogram wait,run;
+		histDelta(&wait,&cur->wait[i],prev != NULL ? &prev->wait[i] : NULL);
+		histDelta(&run,&cur->run[i],prev != NULL ? &prev->run[i] : NULL);
+		if(wait.count == 0){
+			continue;
+		}
+		fprintf(fp,"  %-6s jobs %-9llu wait(us) avg %-7llu p50 %-7llu p99 %-7llu | run(us) avg %-7llu p50 %-7llu p99 %-7llu max %llu\n",
+			laneNames[i],wait.count,wait.sum_us / wait.count,threadPoolHistPercentile(&wait,50),threadPoolHistPercentile(&wait,99),
+			run.count > 0 ? run.sum_us / run.count : 0,threadPoolHistPercentile(&run,50),threadPoolHistPercentile(&run,99),run.max_us);
+	}
+	for(int i = 0;i < cur->worker_count;i++){
+		const nWorkerStats *ws = &cur->workers[i];
+		if(!ws->active){
+			continue;
+		}
+		unsigned long long jobs = ws->jobs,busy = ws->busy_ns,alive = ws->alive_ns;
+		const nWorkerStats *old = prev != NULL && i < prev->worker_count ? &prev->workers[i] : NULL;
+		if(old != NULL && old->active && alive >= old->alive_ns && busy >= old->busy_ns){	//两次快照之间重新启动过的线程用本次启动以来的值
+			jobs -= old->jobs;
+			busy -= old->busy_ns;
+			alive -= old->alive_ns;
+		}
+		double ratio = alive > 0 ? 100.0 * busy / alive : 0.0;
+		if(ratio > 100.0){
+			ratio = 100.0;										//执行时间在任务结束时才累加，跨过上一次快照的任务会整段算在这一次
+		}
+		fprintf(fp,"  worker %-3d node %d jobs %-9llu busy %5.1f%%\n",ws->index,ws->node,jobs,ratio);
+	}
+#undef STATS_DELTA
+}
+
+//定期输出统计，关闭线程池时退出
+static void *statsThread(void *ptr){
+	nWorkQueue *wq = (nWorkQueue *)ptr;
+	nThreadPoolStats *prev = (nThreadPoolStats *)malloc(sizeof(nThreadPoolStats));
+	nThreadPoolStats *cur = (nThreadPoolStats *)malloc(sizeof(nThreadPoolStats));
+	if(prev == NULL || cur == NULL){
+		free(prev);
+		free(cur);
+		return NULL;
+	}
+	threadPoolStats(wq,prev);
+
+	pthread_mutex_lock(&wq->jobs_mtx);
+	while(!wq->shutdown){
+		struct timespec ts;
+		deadlineAfter(wq->stats_interval_ms,&ts);
+		while(!wq->shutdown && pthread_cond_timedwait(&wq->stats_cond,&wq->jobs_mtx,&ts) != ETIMEDOUT){
+		}
+		if(wq->shutdown){
+			break;
+		}
+		pthread_mutex_unlock(&wq->jobs_mtx);
+
+		threadPoolStats(wq,cur);
+		threadPoolStatsPrint(cur,prev,wq->stats_fp);
+		fflush(wq->stats_fp);
+		nThreadPoolStats *tmp = prev;
+		prev = cur;
+		cur = tmp;
+
+		pthread_mutex_lock(&wq->jobs_mtx);
+	}
+	pthread_mutex_unlock(&wq->jobs_mtx);
+	free(prev);
+	free(cur);
+	return NULL;
+}
+
+int threadPoolStatsStart(nThreadPool *workQueue,int interval_ms,FILE *fp){
+	if(interval_ms <= 0 || fp == NULL || workQueue->stats_interval_ms > 0){
+		return -1;
+	}
+	workQueue->stats_fp = fp;
+	workQueue->stats_interval_ms = interval_ms;
+	if(pthread_create(&workQueue->stats_thread,NULL,statsThread,workQueue) != 0){
+		perror("pthread_create error!\n");
+		workQueue->stats_interval_ms = 0;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,421 @@
+#ifndef __THREADPOOL_H
+#define __THREADPOOL_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define MAX_THREADS_COUNT	80					//定义线程池最大线程数量
+#define MAX_JOBS_COUNT		1000				//定义最大任务数量：默认的队列容量
+
+//宏定义：链表插入，头插法;写成do...while可以防止宏定义导致的问题，使得插入代码块
+//注意：虽然是双向链表，但是我们这里先不设置list->prev,因为可能list为空，会出错。
+//具体设置在
+#define LL_ADD(item,list) do {					\
+	item->prev = NULL;							\
+	item->next = list;							\
+	if(list != NULL) list->prev = item;			\
+	list = item;								\
+}while(0)
+
+//宏定义：链表list中移除节点item，实际上就是从头部移除
+#define LL_REMOVE(item,list) do {							\
+	if(item->prev != NULL) item->prev->next = item->next;	\
+	if(item->next != NULL) item->next->prev = item->prev;	\
+	if(list == item) list = item->next;						\
+	item->prev = item->next = NULL;							\
+}while(0)
+
+//=========================调度方式=========================
+/*
+THREADPOOL_SCHED_GLOBAL：所有线程竞争一把jobs_mtx和一组任务通道（最初的实现）
+THREADPOOL_SCHED_STEALING：工作窃取
+	1.每个线程有一个自己的Chase-Lev双端队列，线程自己在底部push/pop不需要加锁，其他线程从顶部CAS窃取
+	2.工作线程中提交的任务放入自己的队列，外部线程提交的任务放入注入队列（lanes，仍然由jobs_mtx保护）
+	3.线程先取自己的队列，再取注入队列，最后随机选择其他线程窃取；都没有任务才睡眠
+*/
+#define THREADPOOL_SCHED_GLOBAL		0
+#define THREADPOOL_SCHED_STEALING	1
+
+#define THREADPOOL_DEQUE_SIZE		1024		//每个线程双端队列的默认容量（2的幂），满了之后放入注入队列
+
+/*
+优先级通道：注入队列分成几个FIFO通道，线程先取高优先级的通道
+低优先级通道的队首任务等待超过aging_ms之后，优先于高优先级通道被取走（老化），避免持续的高优先级负载饿死低优先级任务
+*/
+#define THREADPOOL_PRIO_HIGH		0
+#define THREADPOOL_PRIO_NORMAL		1
+#define THREADPOOL_PRIO_LOW			2
+#define THREADPOOL_LANES			3
+
+#define THREADPOOL_AGING_MS			50			//默认的老化时间
+#define THREADPOOL_DEQUEUE_BATCH	8			//线程一次加锁最多从通道中取出的任务数
+#define THREADPOOL_HIST_BUCKETS		32			//直方图桶数，第i个桶是[2^(i-1),2^i)微秒，第0个桶是小于1微秒
+
+/*
+动态线程数：线程数在[min_workers,max_workers]之间变化
+1.增加：排队时间超过grow_wait_ms，或者注入队列中平均每个线程的任务数超过grow_depth，并且没有空闲线程时，增加一个线程（同一时间只启动一个）
+2.减少：线程空闲超过idle_timeout_ms并且线程数大于min_workers时退出
+*/
+#define THREADPOOL_GROW_WAIT_MS		5			//默认的增加线程的排队时间阈值
+#define THREADPOOL_GROW_DEPTH		16			//默认的增加线程的队列深度阈值（平均每个线程）
+#define THREADPOOL_IDLE_TIMEOUT_MS	5000		//默认的空闲线程退出时间
+
+/*
+空闲等待：线程没有任务时先自旋spin_us微秒（pause指令），再在futex上睡眠；提交者只在有线程睡眠时才发出唤醒
+突发的任务在自旋期间到达时，不需要睡眠和唤醒的系统调用，提交到开始执行的延迟从几十微秒降到亚微秒
+*/
+#define THREADPOOL_SPIN_US			50			//默认的自旋时间（多于一个CPU时）
+
+/*
+有界队列：注入队列（lanes）中的任务数不超过capacity，外部线程提交时队列满了有三种处理方式
+1.threadPoolQueue/threadPoolQueuePriority/threadPoolQueueBatch：阻塞等待，直到有空位
+2.threadPoolTryQueue：立即返回-1
+3.threadPoolQueueTimed：最多等待timeout_ms，超时返回-1
+线程池自己的线程提交任务时从不等待（所有线程都阻塞在提交上就死锁了），工作窃取模式下这些任务本来也大多进入线程自己的有界双端队列
+*/
+
+/*
+任务槽：线程池预先分配的一组nJob，每个带一块内联的参数区（user_data指向它），小任务的提交和执行都不需要malloc/free
+空闲的槽放在无锁栈中，任务执行完之后线程池自动归还，任务函数不能释放它
+*/
+#define THREADPOOL_SLOT_PAYLOAD		48			//任务槽内联参数区的大小（字节）
+
+/*
+CPU亲和性和NUMA节点
+1.affinity：THREADPOOL_AFFINITY_NONE不绑定（默认）；_NODE每个线程绑定到所在节点的全部CPU；_CPU每个线程绑定到节点中的一个CPU（节点内轮流分配）
+2.cpu_list：线程可以使用的CPU，格式和/sys/devices/system/node/node0/cpulist相同，例如"0-7,16-23"，NULL表示进程允许的所有CPU
+3.numa：按/sys/devices/system/node中的节点把线程分组，第i个线程属于第i%节点数个节点；nodes大于0时不读取系统拓扑，把CPU平均分成nodes组（用于测试）
+4.工作窃取模式下每个节点有一个自己的注入通道，threadPoolQueueNode把任务放入指定节点的通道。线程取任务的顺序：
+  自己的队列 -> 本节点的通道和公共通道 -> 窃取本节点其他线程 -> 其他节点的通道 -> 窃取其他节点的线程，本节点没有任务时才跨节点
+  全局队列模式没有节点通道，节点提示被忽略，只做CPU绑定
+*/
+#define THREADPOOL_AFFINITY_NONE	0
+#define THREADPOOL_AFFINITY_NODE	1
+#define THREADPOOL_AFFINITY_CPU		2
+#define THREADPOOL_MAX_NODES		8			//最多使用的节点数，多出的节点不使用
+
+/*
+定时任务：threadPoolSchedule在delay_ms毫秒之后执行一次，threadPoolScheduleEvery之后每period_ms毫秒执行一次
+1.到期时间放在线程池中的4叉最小堆里，插入和取消都是O(log n)；每个job记录自己在堆中的位置，取消时直接从这个位置删除
+2.空闲线程中有一个负责定时器，它的睡眠时间不超过最近的到期时间；其他线程照常睡眠。忙碌的线程每取一次任务看一次最近的到期时间
+3.到期的任务放入普通优先级通道（不受capacity限制），和其他任务一样排队执行
+4.周期任务执行完之后才计算下一次的到期时间（同一个任务不会同时执行），按提交时的节拍对齐，执行太慢错过的节拍直接跳过，不补执行
+5.threadPoolCancel：还在堆中的任务删除，返回0，job归还调用者；已经到期在排队或执行的返回-1，周期任务执行完这一次之后不再放回，
+  之后线程池把timer_state置为THREADPOOL_TIMER_NONE，不再访问job（任务槽由线程池归还）
+*/
+#define THREADPOOL_TIMER_NONE		0			//不在定时器中
+#define THREADPOOL_TIMER_PENDING	1			//在堆中等待到期
+#define THREADPOOL_TIMER_FIRED		2			//周期任务已经到期，正在排队或者执行
+#define THREADPOOL_TIMER_CANCELLED	3			//周期任务在排队或者执行时被取消
+
+/*
+取消和截止时间：线程取出任务、开始执行之前检查，被取消或者已经过期的任务不执行，改为调用drop_function清理（丢弃）
+1.run_state：提交时置为THREADPOOL_JOB_QUEUED，开始执行时原子地改为STARTED；threadPoolJobCancel把QUEUED改为CANCELLED
+  两者用CAS竞争，所以取消成功（返回0）的任务一定不会执行，返回-1说明已经开始（或者已经丢弃）
+2.expire_ns：threadPoolQueueDeadline提交的任务在timeout_ms之后过期，开始执行时已经过期就丢弃；其他提交方式不过期
+3.drop_function(job,reason)：reason是THREADPOOL_DROP_*，在取出任务的线程中调用，可以在其中释放job；为NULL时只丢弃
+  任务槽在drop_function返回之后自动归还。没有设置drop_function的job在取消之前要把它置为NULL（threadPoolJobAlloc已经置为NULL）
+4.只有job还有效时才能取消：执行完之后调用者（或者任务函数）释放了job，或者任务槽被重新分配之后就不能再取消
+5.周期任务用threadPoolCancel取消，不检查run_state和expire_ns；strand中的任务同样在开始执行前检查取消
+丢弃的任务不计入线程的任务数，分别统计在dropped_cancelled和dropped_expired中
+*/
+#define THREADPOOL_JOB_QUEUED		0			//已提交，还没有开始
+#define THREADPOOL_JOB_STARTED		1			//已经开始执行（或者已经过期丢弃）
+#define THREADPOOL_JOB_CANCELLED	2			//开始之前被取消
+
+#define THREADPOOL_DROP_CANCELLED	1			//drop_function的reason：被取消
+#define THREADPOOL_DROP_EXPIRED		2			//drop_function的reason：开始执行时已经过期
+
+/*
+串行队列（strand）：提交到同一个strand的任务按FIFO顺序逐个执行，可以在任何线程中执行，但是同一时间最多执行一个
+1.strand没有自己的线程，也不阻塞线程池的线程：有任务时把strand的runner任务放入线程池，runner依次执行积压的任务，
+  一次最多执行THREADPOOL_STRAND_BATCH个，还有剩余就把自己重新放入线程池，让其他任务和strand也有机会执行
+2.任务队列是无锁的多生产者单消费者链表（Vyukov）：提交者原子交换tail之后链接到前一个任务上，runner是唯一的消费者
+3.pending是已提交还没有执行完的任务数，把它从0变成1的提交者负责放入runner，runner执行完一批之后减去执行的个数，不为0就继续
+  所以任何时刻最多一个runner在排队或者执行，同一个strand的任务之间有happens-before，只被这个strand访问的状态不需要加锁
+4.任务中可以向同一个strand提交任务（放在队尾，之后执行，不会死锁）；提交到strand的任务槽执行完之后同样自动归还
+  strand中的任务和直接提交的任务一样计入统计（排队时间从提交到strand开始算），runner本身不计入
+5.strand不占用资源，pending为0之后就可以释放；线程池关闭时还在排队的任务和pool中的任务一样被丢弃
+*/
+#define THREADPOOL_STRAND_BATCH		32			//runner一次最多执行的任务数
+
+//=========================定义线程和任务=========================
+
+struct NJOB;
+struct NTOPOLOGY;								//节点和CPU集合，只在threadPool.c中使用
+struct NTIMERENTRY;								//定时器堆的元素，只在threadPool.c中使用
+
+//以2为底的对数直方图，单位微秒，计数用原子操作累加
+typedef struct NHISTOGRAM {
+	unsigned long long count;
+	unsigned long long sum_us;
+	unsigned long long max_us;
+	unsigned long long buckets[THREADPOOL_HIST_BUCKETS];
+} nHistogram;
+
+//一个FIFO通道：尾部插入，头部取出
+typedef struct NJOBLANE {
+	struct NJOB *head;
+	struct NJOB *tail;
+	long count;
+} nJobLane;
+
+//Chase-Lev双端队列：固定容量的环形数组，top和bottom单调递增，分别放在不同的缓存行
+typedef struct NJOBDEQUE {
+	long top __attribute__((aligned(64)));		//窃取端，其他线程CAS增加
+	long bottom __attribute__((aligned(64)));	//所有者端，只有所属线程修改
+	struct NJOB **buffer;
+	long mask;									//容量-1
+} nJobDeque;
+
+//定义线程信息,用于工作
+typedef struct NWORKER {
+	pthread_t thread;							//类似于线程id
+	int terminate;								//线程通过这个标识来决定是否退出
+	int active;									//线程正在运行；空闲退出之后为0，worker保留到线程池关闭，可以被新线程重用
+	int index;									//线程在池中的序号
+	int node;									//线程所属的节点序号（0到num_nodes-1，不是系统的节点编号）
+	int cpu;									//AFFINITY_CPU时绑定的CPU，否则为-1
+	unsigned int seed;							//随机选择窃取对象用的随机数种子
+	unsigned int park_word;						//睡眠用的futex字，被唤醒时置为1
+	int parked;									//在空闲栈中，park_mtx保护
+	struct NWORKER *park_next;
+	int depth;									//正在执行的任务的嵌套层数（任务中调用threadPoolRunOne），只统计最外层的执行时间
+	unsigned long long start_ns;				//线程启动的时间
+	unsigned long long busy_ns;					//执行任务的总时间，只有所属线程修改
+	unsigned long long jobs;					//执行的任务数
+	struct NWORKQUEUE *workqueue;				//线程所属的线程池信息
+	struct NWORKER *prev;						//链表前指针
+	struct NWORKER *next;						//链表后指针
+	nJobDeque deque;							//工作窃取模式下线程自己的任务队列
+} nWorker;
+
+//定义job任务，线程通过获取job链表中的任务进行执行
+typedef struct NJOB {
+	void (*job_function)(struct NJOB *job);		//JOB任务要去执行的函数,之所以传入NJOB参数，因为NJOB中包含了函数想要的数据
+	void *user_data;
+	struct NJOB *prev;
+	struct NJOB *next;
+
+	//以下字段由线程池在提交时填写，调用者不需要初始化
+	int priority;								//所在的优先级通道（节点通道中的任务是普通优先级）
+	int timer_state;							//THREADPOOL_TIMER_*，原子读写
+	unsigned long long enqueue_ns;				//提交时间，用于老化和排队时间统计
+	unsigned long long deadline_ns;				//定时任务的到期时间（CLOCK_MONOTONIC）
+	unsigned long long period_ns;				//周期任务的周期，0表示只执行一次
+	int timer_index;							//在定时器堆中的位置，timer_mtx保护
+	int run_state;								//THREADPOOL_JOB_*，原子读写
+	unsigned long long expire_ns;				//过期时间（CLOCK_MONOTONIC），0表示不过期
+
+	void (*drop_function)(struct NJOB *job,int reason);	//被取消或者过期时代替job_function调用，由调用者设置，可以为NULL
+} nJob;
+
+//任务槽：nJob和内联参数区，按缓存行对齐，相邻的槽不会伪共享
+typedef struct NJOBSLOT {
+	nJob job;
+	unsigned int next;							//空闲栈中下一个槽的序号+1，0表示没有
+	char payload[THREADPOOL_SLOT_PAYLOAD] __attribute__((aligned(16)));
+} __attribute__((aligned(64))) nJobSlot;
+
+//=========================定义线程池=========================
+typedef struct NWORKQUEUE {
+	struct NWORKER *workers;					//线程池中线程链表
+	nJobLane lanes[THREADPOOL_LANES];			//待处理的任务，按优先级分成FIFO通道（工作窃取模式下是注入队列）
+	long queued;								//所有通道中的任务数，jobs_mtx保护，无锁读取只作为提示
+	pthread_mutex_t jobs_mtx;					//线程锁，只有一个线程去读取任务，不允许多个线程读取到一个任务
+	pthread_cond_t notfull_cond;				//条件变量，用于通知队列有空位
+	long capacity;								//注入队列容量，0表示不限制
+	int waiting_producers;						//阻塞在notfull_cond上的提交者数，jobs_mtx保护
+	unsigned long long blocked;					//队列满了需要等待的提交次数
+	unsigned long long rejected;				//threadPoolTryQueue因为队列满被拒绝的次数
+	unsigned long long timeouts;				//threadPoolQueueTimed等待超时的次数
+
+	nJobSlot *slots;							//任务槽数组，没有启用时为NULL
+	int slot_count;
+	unsigned long long slot_head __attribute__((aligned(64)));	//空闲栈栈顶：高32位是版本号（防止ABA），低32位是槽序号+1
+	unsigned long long slot_exhausted;			//任务槽用完，threadPoolJobAlloc返回NULL的次数
+
+	int sched;									//调度方式THREADPOOL_SCHED_*
+	int num_workers;							//worker_array中已经使用的位置数（只增不减），包括已经退出的线程
+	struct NWORKER **worker_array;				//按序号索引的线程，用于随机选择窃取对象，共max_workers个位置
+	int live_workers;							//正在运行的线程数
+	int min_workers;
+	int max_workers;
+	int starting;								//已经创建还没有开始取任务的线程数，不为0时不再增加线程
+	int shutdown;								//正在关闭，不再增加线程
+	int deque_size;
+	unsigned long long grow_wait_ns;			//排队时间超过这个值时增加线程，0表示不按排队时间增加
+	int grow_depth;								//平均每个线程的排队任务数超过这个值时增加线程，0表示不按队列深度增加
+	int idle_timeout_ms;						//空闲线程退出时间
+	unsigned long long spawned;					//创建之后增加的线程数
+	unsigned long long retired;					//空闲退出的线程数
+	long pending;								//已提交还没有被取走的任务数（原子操作）
+	int idle;									//睡眠（或者准备睡眠）的线程数（原子操作），为0时提交任务不需要唤醒
+	pthread_mutex_t park_mtx;					//保护空闲栈
+	struct NWORKER *park_list;					//睡眠的线程，栈顶是最近睡眠的
+	unsigned long long spin_ns;					//空闲线程睡眠之前自旋的时间
+	unsigned long long aging_ns;				//老化时间
+	int dequeue_batch;							//一次加锁最多取出的任务数
+
+	int affinity;								//THREADPOOL_AFFINITY_*
+	int num_nodes;								//节点数，至少为1
+	struct NTOPOLOGY *topology;
+	nJobLane node_lanes[THREADPOOL_MAX_NODES];	//每个节点的注入通道，任务数也计入queued，jobs_mtx保护
+	unsigned long long remote_pops;				//从其他节点的通道取走的任务数
+	unsigned long long remote_steals;			//从其他节点的线程窃取的任务数
+
+	nHistogram lane_wait[THREADPOOL_LANES];		//每个优先级从提交到开始执行的排队时间
+	nHistogram lane_run[THREADPOOL_LANES];		//每个优先级的执行时间
+	long max_queued;							//queued的最大值，jobs_mtx保护
+	unsigned long long spin_hits;				//自旋期间等到任务的次数（原子操作，以下几个都是）
+	unsigned long long parks;					//睡眠次数
+	unsigned long long unparks;					//提交者唤醒线程（futex_wake）的次数
+	unsigned long long wakeups;					//睡眠的线程醒来的次数（不包括超时）
+	unsigned long long spurious_wakeups;		//醒来之后没有任务的次数
+	unsigned long long lock_acquires;			//jobs_mtx加锁次数（不包括条件变量返回时的重新加锁），jobs_mtx保护
+	unsigned long long lock_contended;			//加锁时锁已经被占用的次数
+
+	pthread_mutex_t timer_mtx;					//保护定时器堆
+	struct NTIMERENTRY *timer_heap;				//4叉最小堆，按到期时间排序
+	void *timer_mem;							//timer_heap所在的内存块（对齐之后再偏移，见timerGrow）
+	long timer_count;
+	long timer_cap;
+	unsigned long long timer_next;				//堆顶的到期时间，没有定时任务时为ULLONG_MAX（原子读写，无锁读取）
+	struct NWORKER *timer_sleeper;				//负责定时器的睡眠线程，park_mtx保护
+	unsigned long long timers_fired;			//到期放入通道的任务数
+	unsigned long long dropped_cancelled;		//开始执行前发现被取消而丢弃的任务数（原子操作）
+	unsigned long long dropped_expired;			//开始执行前发现已经过期而丢弃的任务数（原子操作）
+
+	pthread_t stats_thread;						//定期输出统计的线程，没有启动时stats_interval_ms为0
+	pthread_cond_t stats_cond;
+	int stats_interval_ms;
+	FILE *stats_fp;
+} nWorkQueue;
+
+typedef nWorkQueue nThreadPool;					//线程池
+
+//串行队列，tail和pending被提交者修改，head只有runner访问，分别放在不同的缓存行
+typedef struct NSTRAND {
+	struct NJOB *tail __attribute__((aligned(64)));	//最后提交的任务，提交者原子交换
+	long pending;								//已提交还没有执行完的任务数（原子操作）
+	struct NJOB *head __attribute__((aligned(64)));	//下一个要执行的任务（或者stub），只有runner访问
+	unsigned long long executed;				//执行的任务数，只有runner修改
+	unsigned long long turns;					//runner被调度执行的次数，只有runner修改
+	nWorkQueue *workqueue;
+	nJob stub;									//占位节点，队列中只剩最后一个任务时放到它后面，让最后一个任务可以取出
+	nJob runner;								//放入线程池执行积压任务的任务，user_data指向strand
+} nStrand;
+
+//线程池的创建参数
+typedef struct NTHREADPOOLATTR {
+	int sched;									//调度方式，默认THREADPOOL_SCHED_STEALING
+	int deque_size;								//每个线程双端队列的容量，默认THREADPOOL_DEQUE_SIZE，会向上取整为2的幂
+	int aging_ms;								//低优先级任务的老化时间，默认THREADPOOL_AGING_MS，0表示严格按优先级
+	int dequeue_batch;							//线程一次加锁最多取出的任务数，默认THREADPOOL_DEQUEUE_BATCH，1表示每次只取一个
+	int min_workers;							//最少线程数，默认0表示等于创建时的线程数
+	int max_workers;							//最多线程数，默认0表示等于创建时的线程数（固定大小），不超过MAX_THREADS_COUNT
+	int grow_wait_ms;							//默认THREADPOOL_GROW_WAIT_MS
+	int grow_depth;								//默认THREADPOOL_GROW_DEPTH
+	int idle_timeout_ms;						//默认THREADPOOL_IDLE_TIMEOUT_MS
+	long capacity;								//注入队列容量，默认MAX_JOBS_COUNT，0表示不限制
+	int job_slots;								//预先分配的任务槽数量，默认0表示不使用
+	int affinity;								//默认THREADPOOL_AFFINITY_NONE
+	const char *cpu_list;						//可以使用的CPU，默认NULL
+	int numa;									//按NUMA节点分组，默认0
+	int nodes;									//大于0时人为划分的节点数，默认0表示读取系统拓扑
+	int spin_us;								//空闲线程睡眠之前的自旋时间，默认-1表示多于一个CPU时THREADPOOL_SPIN_US，只有一个CPU时不自旋；0表示直接睡眠
+} nThreadPoolAttr;
+
+/*
+统计快照：threadPoolStats一次读取所有计数（各个计数分别原子读取，整体不是严格的快照）
+1.排队时间和执行时间直方图，按优先级分开（节点通道中的任务算普通优先级）
+2.每个线程的任务数和忙碌比例：执行任务的时间/线程运行的时间，空闲比例是1-忙碌比例
+3.自旋等到任务的次数、睡眠次数、唤醒次数和没有任务的唤醒次数，jobs_mtx的加锁次数和竞争次数（trylock失败）
+4.threadPoolStatsPrint输出一个快照，prev不为NULL时计数和忙碌比例都是两次快照之间的差值；threadPoolStatsStart定期输出
+判断：排队时间长并且线程都很忙是线程不够；忙碌比例低是线程太多；竞争比例高说明瓶颈在jobs_mtx上（考虑工作窃取、批量提交）
+*/
+typedef struct NWORKERSTATS {
+	int index;
+	int node;
+	int active;
+	unsigned long long jobs;
+	unsigned long long busy_ns;
+	unsigned long long alive_ns;				//线程启动到现在的时间
+} nWorkerStats;
+
+typedef struct NTHREADPOOLSTATS {
+	unsigned long long time_ns;					//快照时间（CLOCK_MONOTONIC）
+	long queued;								//注入队列中的任务数
+	long max_queued;
+	long pending;								//工作窃取模式下还没有开始的任务数，包括线程自己队列中的
+	long capacity;
+	int live_workers;
+	int idle_workers;
+	unsigned long long spawned;
+	unsigned long long retired;
+	unsigned long long blocked;
+	unsigned long long rejected;
+	unsigned long long timeouts;
+	unsigned long long slot_exhausted;
+	unsigned long long spin_hits;
+	unsigned long long parks;
+	unsigned long long unparks;
+	unsigned long long wakeups;
+	unsigned long long spurious_wakeups;
+	unsigned long long lock_acquires;
+	unsigned long long lock_contended;
+	unsigned long long remote_pops;
+	unsigned long long remote_steals;
+	long timers;								//等待到期的定时任务数
+	unsigned long long timers_fired;
+	unsigned long long executed;				//线程池的线程执行的任务数（各个线程的任务数之和）
+	unsigned long long dropped_cancelled;
+	unsigned long long dropped_expired;
+	nHistogram wait[THREADPOOL_LANES];
+	nHistogram run[THREADPOOL_LANES];
+	int worker_count;							//workers中有效的个数，最多MAX_THREADS_COUNT个
+	nWorkerStats workers[MAX_THREADS_COUNT];
+} nThreadPoolStats;
+
+//=========================线程池接口=========================
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void threadPoolAttrInit(nThreadPoolAttr *attr);										//创建参数设置为默认值
+int threadPoolCreate(nThreadPool *workqueue, int numWorkers);						//创建线程池，成功返回0，失败返回-1
+int threadPoolCreateEx(nThreadPool *workqueue, int numWorkers, const nThreadPoolAttr *attr);	//按参数创建线程池，attr为NULL时使用默认值，numWorkers是初始线程数
+//以下提交函数成功返回0，失败（队列满、超时或者线程池已经关闭）返回-1
+int threadPoolQueue(nThreadPool *workQueue,nJob *job);								//为线程池中添加任务，普通优先级，队列满时阻塞
+int threadPoolQueuePriority(nThreadPool *workQueue,nJob *job,int priority);		//按优先级添加任务，priority为THREADPOOL_PRIO_*，队列满时阻塞
+int threadPoolTryQueue(nThreadPool *workQueue,nJob *job);							//添加普通优先级任务，队列满时立即返回-1
+int threadPoolQueueTimed(nThreadPool *workQueue,nJob *job,int timeout_ms);		//添加普通优先级任务，队列满时最多等待timeout_ms毫秒
+int threadPoolQueueNode(nThreadPool *workQueue,nJob *job,int node);				//添加普通优先级任务到第node个节点的通道，优先由这个节点的线程执行；node无效时和threadPoolQueue相同
+int threadPoolQueueBatch(nThreadPool *workQueue,nJob **jobs,int n);				//批量添加n个普通优先级的任务：一次加锁，最多唤醒min(n,空闲线程数)个线程；等待有n个空位（n大于容量时等待队列为空）
+int threadPoolQueueDeadline(nThreadPool *workQueue,nJob *job,int priority,unsigned int timeout_ms);	//添加任务，timeout_ms毫秒之后还没有开始就丢弃；队列满时最多等到过期
+int threadPoolJobCancel(nThreadPool *workQueue,nJob *job);						//取消还没有开始的任务：成功返回0，任务不会执行，由取出它的线程调用drop_function；已经开始返回-1
+int threadPoolSchedule(nThreadPool *workQueue,nJob *job,unsigned int delay_ms);	//delay_ms毫秒之后执行一次，成功返回0，线程池已经关闭返回-1
+int threadPoolScheduleEvery(nThreadPool *workQueue,nJob *job,unsigned int delay_ms,unsigned int period_ms);	//delay_ms毫秒之后第一次执行，之后每period_ms毫秒执行一次，直到被取消
+int threadPoolCancel(nThreadPool *workQueue,nJob *job);							//取消定时任务：还没有到期返回0，已经到期（或者不是定时任务）返回-1
+void threadPoolStrandInit(nThreadPool *workQueue,nStrand *strand);				//初始化串行队列，任务在workQueue中执行
+int threadPoolStrandPost(nStrand *strand,nJob *job);								//提交到串行队列的队尾，成功返回0；需要放入runner但是线程池已经关闭时返回-1
+int threadPoolStrandRunning(nStrand *strand);										//调用线程正在执行这个strand的任务返回1
+long threadPoolStrandPending(nStrand *strand);									//已提交还没有执行完的任务数
+nJob *threadPoolJobAlloc(nThreadPool *workQueue);									//取一个任务槽，user_data指向THREADPOOL_SLOT_PAYLOAD字节的参数区；槽用完时返回NULL
+void threadPoolJobFree(nThreadPool *workQueue,nJob *job);							//归还没有提交的任务槽（提交过的任务执行完之后自动归还）
+int threadPoolRunOne(nThreadPool *workQueue);										//在调用线程中执行一个等待中的任务，执行了返回1，没有任务返回0
+int threadPoolSize(nThreadPool *workQueue);										//当前正在运行的线程数
+int threadPoolNodes(nThreadPool *workQueue);										//节点数
+int threadPoolCurrentNode(nThreadPool *workQueue);									//调用线程所属的节点，不是这个线程池的线程返回-1
+void threadPoolLaneWait(nThreadPool *workQueue,int priority,nHistogram *out);		//读取某个优先级的排队时间直方图
+unsigned long long threadPoolHistPercentile(const nHistogram *hist,double p);		//直方图的p分位数（0-100），返回所在桶的上界（微秒）
+void threadPoolStats(nThreadPool *workQueue,nThreadPoolStats *out);				//读取统计快照
+void threadPoolStatsPrint(const nThreadPoolStats *cur,const nThreadPoolStats *prev,FILE *fp);	//输出快照，prev不为NULL时输出两次之间的差值
+int threadPoolStatsStart(nThreadPool *workQueue,int interval_ms,FILE *fp);		//启动一个线程每interval_ms毫秒输出一次统计，threadPoolShutdown时停止，成功返回0
+void threadPoolShutdown(nThreadPool *workQueue);									//线程池关闭退出：等待正在执行的任务结束，还没有开始的任务被丢弃
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,648 @@
+#ifndef __THREADPOOLCOROUTINE_H
+#define __THREADPOOLCOROUTINE_H
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "threadPool.h"
+
+/*
+nThreadPool之上的C++20协程（g++ -std=c++20）：异步的处理流程写成顺序的代码
+1.pool_task<T>：惰性的协程，co_await时才开始执行，结果或者异常在co_await处返回；完成时直接切换到等待它的协程（对称转移），
+  一层层co_await下去调用栈不会变深
+2.co_await schedule_on(pool)：把当前协程挂起，作为一个任务提交到线程池，在工作线程中恢复
+3.co_await when_all(a,b,...)：依次启动各个任务，全部完成之后返回结果的tuple（void任务的结果是std::monostate）；
+  vector版本返回结果的vector。最后一个完成的任务直接恢复等待者。任意一个抛出异常时，全部完成之后重新抛出第一个
+4.pool_reactor：一个线程在epoll上等待（和进程池子进程的事件循环一样），co_await reactor.readable(fd)/writable(fd)
+  注册EPOLLONESHOT，事件到达时把协程作为任务提交到线程池恢复，返回epoll的事件，注册失败返回-1
+5.sync_wait(task)：在非线程池线程中启动任务并阻塞等待结果；pool_spawn(pool,task)：在线程池中启动一个pool_task<void>，不等待
+挂起操作的awaiter（包括其中的nJob）都在协程帧里，除了协程帧本身，挂起和恢复都不分配内存
+*/
+
+template<typename T>
+class pool_task;
+
+//=========================pool_task=========================
+class task_promise_base
+{
+public:
+	std::coroutine_handle<> m_continuation;				//co_await这个任务的协程
+	std::exception_ptr m_error;
+
+	//完成时恢复等待者：返回它的句柄，由编译器跳转过去（尾调用），不在当前栈帧上嵌套调用resume
+	struct final_awaiter
+	{
+		bool await_ready() noexcept { return false; }
+		template<typename P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+		{
+			std::coroutine_handle<> next = h.promise().m_continuation;
+			return next ? next : std::noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	final_awaiter final_suspend() noexcept { return {}; }
+	void unhandled_exception() noexcept { m_error = std::current_exception(); }
+};
+
+template<typename T>
+class task_promise : public task_promise_base
+{
+public:
+	std::optional<T> m_value;
+
+	pool_task<T> get_return_object() noexcept;
+
+	template<typename U>
+	void return_value(U &&value){ m_value.emplace(std::forward<U>(value)); }
+
+	T result()
+	{
+		if(m_error){
+			std::rethrow_exception(m_error);
+		}
+		return std::move(*m_value);
+	}
+};
+
+template<>
+class task_promise<void> : public task_promise_base
+{
+public:
+	pool_task<void> get_return_object() noexcept;
+	void return_void() noexcept {}
+	void result()
+	{
+		if(m_error){
+			std::rethrow_exception(m_error);
+		}
+	}
+};
+
+template<typename T = void>
+class pool_task
+{
+public:
+	typedef task_promise<T> promise_type;
+private:
+	std::coroutine_handle<promise_type> m_handle;
+public:
+	explicit pool_task(std::coroutine_handle<promise_type> h) noexcept : m_handle(h){}
+	pool_task(pool_task &&other) noexcept : m_handle(std::exchange(other.m_handle,nullptr)){}
+	pool_task &operator=(pool_task &&other) noexcept
+	{
+		if(this != &other){
+			if(m_handle){
+				m_handle.destroy();
+			}
+			m_handle = std::exchange(other.m_handle,nullptr);
+		}
+		return *this;
+	}
+	~pool_task()
+	{
+		if(m_handle){
+			m_handle.destroy();
+		}
+	}
+
+	pool_task(const pool_task &) = delete;
+	pool_task &operator=(const pool_task &) = delete;
+
+	bool done() const { return !m_handle || m_handle.done(); }
+
+	struct awaiter
+	{
+		std::coroutine_handle<promise_type> m_handle;
+
+		bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+		{
+			m_handle.promise().m_continuation = caller;
+			return m_handle;									//对称转移：直接开始执行这个任务
+		}
+		T await_resume(){ return m_handle.promise().result(); }
+	};
+
+	awaiter operator co_await() const & noexcept { return awaiter{m_handle}; }
+	awaiter operator co_await() const && noexcept { return awaiter{m_handle}; }
+};
+
+template<typename T>
+inline pool_task<T> task_promise<T>::get_return_object() noexcept
+{
+	return pool_task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline pool_task<void> task_promise<void>::get_return_object() noexcept
+{
+	return pool_task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+//=========================schedule_on=========================
+class schedule_awaiter
+{
+private:
+	nThreadPool *m_pool;
+	int m_priority;
+	bool m_failed;
+	std::coroutine_handle<> m_handle;
+	nJob m_job;												//在协程帧中，提交不分配内存
+public:
+	schedule_awaiter(nThreadPool *pool,int priority) : m_pool(pool),m_priority(priority),m_failed(false){}
+
+	bool await_ready() const noexcept { return false; }
+
+	bool await_suspend(std::coroutine_handle<> h) noexcept
+	{
+		m_handle = h;
+		m_job.job_function = resume;
+		m_job.user_data = this;
+		if(threadPoolQueuePriority(m_pool,&m_job,m_priority) != 0){
+			m_failed = true;
+			return false;										//线程池已经关闭，在当前线程继续，await_resume抛出异常
+		}
+		return true;											//提交之后不能再访问this，协程可能已经在其他线程恢复并且离开了这个co_await
+	}
+
+	void await_resume()
+	{
+		if(m_failed){
+			throw std::runtime_error("schedule_on: thread pool is shut down");
+		}
+	}
+private:
+	static void resume(nJob *job)
+	{
+		static_cast<schedule_awaiter *>(job->user_data)->m_handle.resume();
+	}
+};
+
+//挂起当前协程，在pool的工作线程中恢复；priority为THREADPOOL_PRIO_*
+inline schedule_awaiter schedule_on(nThreadPool *pool,int priority = THREADPOOL_PRIO_NORMAL)
+{
+	return schedule_awaiter(pool,priority);
+}
+
+//=========================when_all=========================
+//所有任务数+1：每个任务完成时减1，等待者挂起之前减1，减到0的一方恢复等待者
+class when_all_counter
+{
+private:
+	std::atomic<size_t> m_count;
+	std::coroutine_handle<> m_continuation;
+public:
+	explicit when_all_counter(size_t n) : m_count(n + 1){}
+
+	//返回true表示还有任务没有完成，需要挂起
+	bool try_await(std::coroutine_handle<> h)
+	{
+		m_continuation = h;
+		return m_count.fetch_sub(1,std::memory_order_acq_rel) > 1;
+	}
+
+	std::coroutine_handle<> arrive()
+	{
+		if(m_count.fetch_sub(1,std::memory_order_acq_rel) == 1){
+			return m_continuation;
+		}
+		return std::noop_coroutine();
+	}
+};
+
+template<typename T>
+struct when_all_slot
+{
+	typedef typename std::conditional<std::is_void<T>::value,std::monostate,T>::type value_type;
+	std::optional<value_type> m_value;
+	std::exception_ptr m_error;
+};
+
+//包装一个子任务：co_await它，把结果放进slot，完成时通知计数
+class when_all_child
+{
+public:
+	struct promise_type
+	{
+		when_all_counter *m_counter = NULL;
+
+		struct final_awaiter
+		{
+			bool await_ready() noexcept { return false; }
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+			{
+				return h.promise().m_counter->arrive();
+			}
+			void await_resume() noexcept {}
+		};
+
+		when_all_child get_return_object() noexcept { return when_all_child(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		final_awaiter final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }	//子任务的异常已经在包装中捕获
+	};
+private:
+	std::coroutine_handle<promise_type> m_handle;
+public:
+	explicit when_all_child(std::coroutine_handle<promise_type> h) noexcept : m_handle(h){}
+	when_all_child(when_all_child &&other) noexcept : m_handle(std::exchange(other.m_handle,nullptr)){}
+	~when_all_child()
+	{
+		if(m_handle){
+			m_handle.destroy();
+		}
+	}
+	when_all_child(const when_all_child &) = delete;
+	when_all_child &operator=(const when_all_child &) = delete;
+	when_all_child &operator=(when_all_child &&) = delete;
+
+	void start(when_all_counter *counter)
+	{
+		m_handle.promise().m_counter = counter;
+		m_handle.resume();										//在当前线程执行到第一次挂起（或者完成）
+	}
+};
+
+template<typename T>
+when_all_child make_when_all_child(pool_task<T> &task,when_all_slot<T> &slot)
+{
+	try{
+		if constexpr(std::is_void<T>::value){
+			co_await task;
+			slot.m_value.emplace();
+		}else{
+			slot.m_value.emplace(co_await task);
+		}
+	}catch(...){
+		slot.m_error = std::current_exception();
+	}
+	co_return;													//GCC只看到if constexpr中的co_await时会误报没有返回值
+}
+
+//依次启动子任务，最后一个完成的子任务恢复等待者
+template<typename Children>
+class when_all_awaiter
+{
+private:
+	Children &m_children;
+	when_all_counter &m_counter;
+public:
+	when_all_awaiter(Children &children,when_all_counter &counter) : m_children(children),m_counter(counter){}
+	bool await_ready() const noexcept { return false; }
+	bool await_suspend(std::coroutine_handle<> h)
+	{
+		for(auto &child : m_children){
+			child.start(&m_counter);
+		}
+		return m_counter.try_await(h);
+	}
+	void await_resume() noexcept {}
+};
+
+template<typename... T,size_t... I>
+pool_task<std::tuple<typename when_all_slot<T>::value_type...>> when_all_impl(std::index_sequence<I...>,pool_task<T>... tasks)
+{
+	std::tuple<when_all_slot<T>...> slots;
+	when_all_counter counter(sizeof...(T));
+	std::array<when_all_child,sizeof...(T)> children{make_when_all_child(tasks,std::get<I>(slots))...};
+	co_await when_all_awaiter<std::array<when_all_child,sizeof...(T)>>(children,counter);
+
+	std::exception_ptr error;
+	((error = error ? error : std::get<I>(slots).m_error),...);
+	if(error){
+		std::rethrow_exception(error);
+	}
+	co_return std::tuple<typename when_all_slot<T>::value_type...>(std::move(*std::get<I>(slots).m_value)...);
+}
+
+template<typename... T>
+pool_task<std::tuple<typename when_all_slot<T>::value_type...>> when_all(pool_task<T>... tasks)
+{
+	return when_all_impl(std::index_sequence_for<T...>(),std::move(tasks)...);
+}
+
+//vector版本：T为void时没有结果
+template<typename T>
+pool_task<typename std::conditional<std::is_void<T>::value,void,std::vector<T>>::type> when_all(std::vector<pool_task<T>> tasks)
+{
+	std::vector<when_all_slot<T>> slots(tasks.size());
+	when_all_counter counter(tasks.size());
+	std::vector<when_all_child> children;
+	children.reserve(tasks.size());
+	for(size_t i = 0;i < tasks.size();i++){
+		children.push_back(make_when_all_child(tasks[i],slots[i]));
+	}
+	co_await when_all_awaiter<std::vector<when_all_child>>(children,counter);
+
+	for(auto &slot : slots){
+		if(slot.m_error){
+			std::rethrow_exception(slot.m_error);
+		}
+	}
+	if constexpr(!std::is_void<T>::value){
+		std::vector<T> values;
+		values.reserve(slots.size());
+		for(auto &slot : slots){
+			values.push_back(std::move(*slot.m_value));
+		}
+		co_return values;
+	}
+}
+
+//=========================sync_wait和pool_spawn=========================
+class sync_wait_state
+{
+public:
+	std::mutex m_mtx;
+	std::condition_variable m_cond;
+	bool m_done = false;
+};
+
+//启动任务并在完成时通知sync_wait_state；通知在锁内完成，等待者返回之后不会再访问它
+class sync_wait_task
+{
+public:
+	struct promise_type
+	{
+		sync_wait_state *m_state = NULL;
+
+		struct final_awaiter
+		{
+			bool await_ready() noexcept { return false; }
+			void await_suspend(std::coroutine_handle<promise_type> h) noexcept
+			{
+				sync_wait_state *state = h.promise().m_state;
+				std::lock_guard<std::mutex> lock(state->m_mtx);
+				state->m_done = true;
+				state->m_cond.notify_one();
+			}
+			void await_resume() noexcept {}
+		};
+
+		sync_wait_task get_return_object() noexcept { return sync_wait_task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		final_awaiter final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+private:
+	std::coroutine_handle<promise_type> m_handle;
+public:
+	explicit sync_wait_task(std::coroutine_handle<promise_type> h) noexcept : m_handle(h){}
+	~sync_wait_task(){ m_handle.destroy(); }
+	sync_wait_task(const sync_wait_task &) = delete;
+	sync_wait_task &operator=(const sync_wait_task &) = delete;
+
+	void run()
+	{
+		sync_wait_state state;
+		m_handle.promise().m_state = &state;
+		m_handle.resume();
+		std::unique_lock<std::mutex> lock(state.m_mtx);
+		state.m_cond.wait(lock,[&]{ return state.m_done; });
+	}
+};
+
+template<typename T>
+sync_wait_task make_sync_wait_task(pool_task<T> &task,when_all_slot<T> &slot)
+{
+	try{
+		if constexpr(std::is_void<T>::value){
+			co_await task;
+			slot.m_value.emplace();
+		}else{
+			slot.m_value.emplace(co_await task);
+		}
+	}catch(...){
+		slot.m_error = std::current_exception();
+	}
+	co_return;													//GCC只看到if constexpr中的co_await时会误报没有返回值
+}
+
+//阻塞等待任务完成，返回结果或者重新抛出异常。不能在线程池的工作线程中调用（会占住这个线程）
+template<typename T>
+T sync_wait(pool_task<T> task)
+{
+	when_all_slot<T> slot;
+	make_sync_wait_task(task,slot).run();
+	if(slot.m_error){
+		std::rethrow_exception(slot.m_error);
+	}
+	if constexpr(!std::is_void<T>::value){
+		return std::move(*slot.m_value);
+	}
+}
+
+//不需要等待的协程：开始就执行，结束时自己销毁协程帧
+class detached_task
+{
+public:
+	struct promise_type
+	{
+		detached_task get_return_object() noexcept { return detached_task(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+//在pool中执行task，不等待；task抛出的异常打印并忽略（和pool_executor的post一样）
+inline detached_task pool_spawn(nThreadPool *pool,pool_task<void> task)
+{
+	try{
+		co_await schedule_on(pool);
+		co_await task;
+	}catch(const std::exception &e){
+		fprintf(stderr,"pool_spawn: task threw: %s\n",e.what());
+	}catch(...){
+		fprintf(stderr,"pool_spawn: task threw an unknown exception\n");
+	}
+}
+
+//=========================epoll事件=========================
+class pool_reactor;
+
+class io_awaiter
+{
+	friend class pool_reactor;
+private:
+	pool_reactor *m_reactor;
+	int m_fd;
+	uint32_t m_events;
+	uint32_t m_revents;										//事件线程写入，提交任务之后在工作线程中读取
+	int m_error;
+	std::atomic<bool> m_armed;								//注册时release，事件线程acquire：epoll_ctl到epoll_wait的顺序内核保证了，但是内存模型（和TSAN）看不到
+	std::coroutine_handle<> m_handle;
+	nJob m_job;
+public:
+	io_awaiter(pool_reactor *reactor,int fd,uint32_t events) : m_reactor(reactor),m_fd(fd),m_events(events),m_revents(0),m_error(0),m_armed(false){}
+
+	bool await_ready() const noexcept { return false; }
+	inline bool await_suspend(std::coroutine_handle<> h) noexcept;
+
+	//返回epoll的事件（EPOLLIN、EPOLLOUT、EPOLLERR、EPOLLHUP等），注册失败返回-1，errno是失败原因
+	int await_resume() noexcept
+	{
+		if(m_error != 0){
+			errno = m_error;
+			return -1;
+		}
+		return (int)m_revents;
+	}
+private:
+	static void resume(nJob *job)
+	{
+		static_cast<io_awaiter *>(job->user_data)->m_handle.resume();
+	}
+};
+
+/*
+事件线程：epoll_wait返回的事件一次批量提交到线程池（threadPoolQueueBatch），每个事件恢复一个协程
+fd用EPOLLONESHOT注册，触发一次之后自动停止监听，下次co_await时用EPOLL_CTL_MOD重新打开；关闭fd之前调用forget
+析构时停止事件线程，还在等待的协程不会再被恢复，所以析构之前应该让它们都完成
+*/
+class pool_reactor
+{
+	friend class io_awaiter;
+private:
+	static const int MAX_EVENT_NUMBER = 1024;				//epoll一次最多返回的事件数量
+	nThreadPool *m_pool;
+	int m_epollfd;
+	int m_stopfd;											//eventfd，写入之后事件线程退出
+	std::thread m_thread;
+public:
+	explicit pool_reactor(nThreadPool *pool) : m_pool(pool)
+	{
+		m_epollfd = epoll_create1(EPOLL_CLOEXEC);
+		m_stopfd = eventfd(0,EFD_CLOEXEC | EFD_NONBLOCK);
+		if(m_epollfd == -1 || m_stopfd == -1){
+			if(m_epollfd != -1){
+				close(m_epollfd);
+			}
+			if(m_stopfd != -1){
+				close(m_stopfd);
+			}
+			throw std::runtime_error("pool_reactor: create epoll failed");
+		}
+		epoll_event event;
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;									//data.ptr为NULL的事件是停止通知
+		epoll_ctl(m_epollfd,EPOLL_CTL_ADD,m_stopfd,&event);
+		m_thread = std::thread([this]{ run(); });
+	}
+
+	~pool_reactor()
+	{
+		uint64_t one = 1;
+		ssize_t ret = write(m_stopfd,&one,sizeof(one));
+		(void)ret;
+		m_thread.join();
+		close(m_stopfd);
+		close(m_epollfd);
+	}
+
+	pool_reactor(const pool_reactor &) = delete;
+	pool_reactor &operator=(const pool_reactor &) = delete;
+
+	//co_await等待fd可读/可写，fd需要是非阻塞的
+	io_awaiter readable(int fd){ return io_awaiter(this,fd,EPOLLIN | EPOLLRDHUP); }
+	io_awaiter writable(int fd){ return io_awaiter(this,fd,EPOLLOUT); }
+
+	//关闭fd之前从epoll中删除
+	void forget(int fd){ epoll_ctl(m_epollfd,EPOLL_CTL_DEL,fd,NULL); }
+private:
+	//注册一次性的事件，已经注册过的fd（上一次触发之后停止了监听）用MOD重新打开
+	//只用参数不用awaiter：MOD成功之后awaiter可能已经被恢复的协程销毁了
+	int arm(int fd,epoll_event *event)
+	{
+		if(epoll_ctl(m_epollfd,EPOLL_CTL_MOD,fd,event) == 0){
+			return 0;
+		}
+		if(errno == ENOENT && epoll_ctl(m_epollfd,EPOLL_CTL_ADD,fd,event) == 0){
+			return 0;
+		}
+		return errno;
+	}
+
+	void run()
+	{
+		epoll_event events[MAX_EVENT_NUMBER];
+		nJob *jobs[MAX_EVENT_NUMBER];
+		while(1){
+			int number = epoll_wait(m_epollfd,events,MAX_EVENT_NUMBER,-1);
+			if(number < 0){
+				if(errno == EINTR){
+					continue;
+				}
+				printf("epoll failure\n");
+				break;
+			}
+			bool stop = false;
+			int n = 0;
+			for(int i = 0;i < number;i++){
+				io_awaiter *awaiter = static_cast<io_awaiter *>(events[i].data.ptr);
+				if(awaiter == NULL){
+					stop = true;
+					continue;
+				}
+				awaiter->m_armed.load(std::memory_order_acquire);			//和注册时的release配对
+				awaiter->m_revents = events[i].events;
+				jobs[n++] = &awaiter->m_job;
+			}
+			if(n > 0 && threadPoolQueueBatch(m_pool,jobs,n) != 0){
+				for(int i = 0;i < n;i++){
+					io_awaiter::resume(jobs[i]);					//线程池已经关闭，在事件线程中恢复
+				}
+			}
+			if(stop){
+				break;
+			}
+		}
+	}
+};
+
+//先设置好恢复用的任务再注册：注册成功之后事件可能马上在其他线程触发，协程恢复之后这个awaiter就不存在了，不能再访问this
+inline bool io_awaiter::await_suspend(std::coroutine_handle<> h) noexcept
+{
+	m_handle = h;
+	m_job.job_function = resume;
+	m_job.user_data = this;
+	pool_reactor *reactor = m_reactor;
+	int fd = m_fd;
+	epoll_event event;
+	event.events = m_events | EPOLLONESHOT;
+	event.data.ptr = this;
+	m_armed.store(true,std::memory_order_release);				//之后只用局部变量
+	int error = reactor->arm(fd,&event);
+	if(error != 0){
+		m_error = error;										//没有注册上，不会有事件
+		return false;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef __THREADPOOLEXECUTOR_H
+#define __THREADPOOLEXECUTOR_H
+
+#include <stdio.h>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "threadPoolFuture.h"
+
+/*
+类型安全的执行器：直接提交任意可调用对象（可以只能移动，例如捕获了std::unique_ptr的lambda），不需要void *user_data和强制转换
+1.可调用对象和绑定的参数（完美转发，按值保存）不超过THREADPOOL_SLOT_PAYLOAD字节时，直接构造在线程池的任务槽中，提交和执行都不分配内存
+2.更大的，或者任务槽用完时，和nJob一起分配在一个堆节点中（只分配一次，也不经过std::function）
+3.post的任务不能抛出异常（工作线程是C代码），抛出时打印并忽略；需要结果或者异常时用submit，返回pool_future
+4.析构时先等所有已经提交的任务执行完（边等待边帮忙），再关闭线程池，任务中捕获的对象都会被正常析构
+*/
+
+class pool_executor
+{
+private:
+	nThreadPool m_pool;
+	std::atomic<int> m_outstanding;							//已经提交还没有执行完的任务数，也是wait_idle用的futex字
+public:
+	explicit pool_executor(int workers,const nThreadPoolAttr *attr = NULL) : m_outstanding(0)
+	{
+		nThreadPoolAttr def;
+		if(attr == NULL){
+			threadPoolAttrInit(&def);
+			def.job_slots = 4096;
+			attr = &def;
+		}
+		if(threadPoolCreateEx(&m_pool,workers,attr) != 0){
+			throw std::runtime_error("pool_executor: create thread pool failed");
+		}
+	}
+
+	~pool_executor()
+	{
+		wait_idle();
+		threadPoolShutdown(&m_pool);
+	}
+
+	pool_executor(const pool_executor &) = delete;
+	pool_executor &operator=(const pool_executor &) = delete;
+
+	nThreadPool *pool(){ return &m_pool; }
+	int size(){ return threadPoolSize(&m_pool); }
+
+	//提交func(args...)，参数按值保存（右值移动进来）。成功返回true，线程池已经关闭返回false
+	template<typename F,typename... Args>
+	bool post(F &&func,Args &&...args)
+	{
+		if constexpr(sizeof...(Args) == 0){
+			return post_callable(std::forward<F>(func),THREADPOOL_PRIO_NORMAL);
+		}else{
+			return post_callable([fn = std::forward<F>(func),tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+				std::apply(std::move(fn),std::move(tup));
+			},THREADPOOL_PRIO_NORMAL);
+		}
+	}
+
+	//按优先级提交，priority为THREADPOOL_PRIO_*
+	template<typename F>
+	bool post_priority(int priority,F &&func)
+	{
+		return post_callable(std::forward<F>(func),priority);
+	}
+
+	//提交func(args...)并返回结果的future，任务抛出的异常在get()时重新抛出
+	template<typename F,typename... Args>
+	auto submit(F &&func,Args &&...args)
+	{
+		typedef typename std::invoke_result<typename std::decay<F>::type,typename std::decay<Args>::type...>::type R;
+		auto state = std::make_shared<future_state<R>>(&m_pool);
+		bool ok = post_callable([state,fn = std::forward<F>(func),tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+			state->fulfil([&]{ return std::apply(std::move(fn),std::move(tup)); });
+		},THREADPOOL_PRIO_NORMAL);
+		if(!ok){
+			state->fail(std::make_exception_ptr(std::runtime_error("thread pool is shut down")));
+		}
+		return pool_future<R>(state);
+	}
+
+	//等待所有已经提交的任务执行完，等待时帮忙执行，没有可以帮忙的任务时睡眠等待
+	void wait_idle()
+	{
+		int outstanding;
+		while((outstanding = m_outstanding.load(std::memory_order_acquire)) > 0){
+			if(!threadPoolRunOne(&m_pool)){
+				pool_count_wait(m_outstanding,outstanding,200);
+			}
+		}
+	}
+private:
+	template<typename Fn>
+	struct heap_node
+	{
+		nJob job;											//必须是第一个成员，job和节点地址相同
+		pool_executor *exec;
+		Fn fn;
+		heap_node(pool_executor *e,Fn &&f) : exec(e),fn(std::move(f)){}
+	};
+
+	//任务槽中放不下executor指针，放在可调用对象后面
+	template<typename Fn>
+	struct inline_task
+	{
+		Fn fn;
+		pool_executor *exec;
+	};
+
+	template<typename Fn>
+	static constexpr bool fits_inline()
+	{
+		return sizeof(inline_task<Fn>) <= THREADPOOL_SLOT_PAYLOAD && alignof(inline_task<Fn>) <= 16;
+	}
+
+	template<typename F>
+	bool post_callable(F &&func,int priority)
+	{
+		typedef typename std::decay<F>::type Fn;
+
+		//m_outstanding在任务构造完成之后、放入线程池之前增加：构造抛出异常时计数不变，wait_idle不会永远等待
+		if constexpr(fits_inline<Fn>()){
+			nJob *job = threadPoolJobAlloc(&m_pool);
+			if(job != NULL){
+				try{
+					new (job->user_data) inline_task<Fn>{Fn(std::forward<F>(func)),this};
+				}catch(...){
+					threadPoolJobFree(&m_pool,job);
+					throw;
+				}
+				job->job_function = run_inline<Fn>;
+				m_outstanding.fetch_add(1,std::memory_order_relaxed);
+				if(threadPoolQueuePriority(&m_pool,job,priority) == 0){
+					return true;
+				}
+				static_cast<inline_task<Fn> *>(job->user_data)->~inline_task<Fn>();
+				threadPoolJobFree(&m_pool,job);
+				task_done();
+				return false;
+			}
+		}
+
+		heap_node<Fn> *node = new heap_node<Fn>(this,Fn(std::forward<F>(func)));
+		node->job.job_function = run_heap<Fn>;
+		node->job.user_data = node;
+		m_outstanding.fetch_add(1,std::memory_order_relaxed);
+		if(threadPoolQueuePriority(&m_pool,&node->job,priority) == 0){
+			return true;
+		}
+		delete node;
+		task_done();
+		return false;
+	}
+
+	//最后一个任务完成时唤醒wait_idle；之后执行器可能马上被析构，不能再访问成员
+	void task_done()
+	{
+		if(m_outstanding.fetch_sub(1,std::memory_order_release) == 1){
+			pool_count_wake(m_outstanding);
+		}
+	}
+
+	template<typename Fn>
+	static void invoke(Fn &fn)
+	{
+		try{
+			fn();
+		}catch(const std::exception &e){
+			fprintf(stderr,"pool_executor: task threw: %s\n",e.what());
+		}catch(...){
+			fprintf(stderr,"pool_executor: task threw an unknown exception\n");
+		}
+	}
+
+	template<typename Fn>
+	static void run_inline(nJob *job)
+	{
+		inline_task<Fn> *t = static_cast<inline_task<Fn> *>(job->user_data);
+		pool_executor *exec = t->exec;
+		invoke(t->fn);
+		t->~inline_task<Fn>();								//任务槽由线程池在返回之后归还
+		exec->task_done();
+	}
+
+	template<typename Fn>
+	static void run_heap(nJob *job)
+	{
+		heap_node<Fn> *node = static_cast<heap_node<Fn> *>(job->user_data);
+		pool_executor *exec = node->exec;
+		invoke(node->fn);
+		delete node;
+		exec->task_done();
+	}
+};
+
+#endif
@@ -0,0 +1,475 @@
+#ifndef __THREADPOOLFUTURE_H
+#define __THREADPOOLFUTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "threadPool.h"
+
+/*
+nThreadPool之上的C++接口：任务的结果、组合和任务图
+1.pool_submit(pool,f)：把f提交到线程池，返回pool_future<R>，R是f的返回值类型（可以是void），f抛出的异常在get()时重新抛出
+2.future.get()：等待结果。还没有完成时调用threadPoolRunOne在当前线程帮忙执行其他任务，没有可执行的任务才短暂睡眠，
+  所以在线程池的任务中等待其他任务不会因为所有线程都在等待而死锁
+3.future.then(f)：完成之后把f(结果)作为新任务提交，返回新的pool_future；前面的任务抛出异常时f不执行，异常传递下去
+4.when_all / when_any：多个future全部完成 / 任意一个完成
+5.task_graph：任务图，节点在所有前驱节点完成之后才提交到线程池
+future只是共享状态的句柄，可以复制；get()会移走结果，只能调用一次
+*/
+
+//=========================提交到线程池的闭包=========================
+//nJob和要执行的函数放在一起，执行完释放自己
+class pool_closure
+{
+public:
+	nJob m_job;
+	std::function<void()> m_func;
+public:
+	//队列满时阻塞（线程池自己的线程提交时不阻塞），线程池已经关闭时返回-1，func不会执行
+	static int post(nThreadPool *pool,std::function<void()> func,int priority = THREADPOOL_PRIO_NORMAL)
+	{
+		pool_closure *c = new pool_closure;
+		c->m_func = std::move(func);
+		c->m_job.job_function = run;
+		c->m_job.user_data = c;
+		if(threadPoolQueuePriority(pool,&c->m_job,priority) != 0){
+			delete c;
+			return -1;
+		}
+		return 0;
+	}
+private:
+	static void run(nJob *job)
+	{
+		pool_closure *c = static_cast<pool_closure *>(job->user_data);
+		c->m_func();
+		delete c;
+	}
+};
+
+//=========================等待计数归零=========================
+/*
+parallel_group和pool_executor等待未完成的任务数归零：帮不上忙时在计数上futex_wait，最多timeout_us微秒，醒来之后再看看有没有任务可以帮忙
+只有减到0的那一次调用pool_count_wake，中间的完成不需要系统调用
+等待者看到0之后可能马上释放计数所在的对象，futex_wake只用地址查找等待者，不访问这块内存，最多让复用这个地址的等待者多醒一次
+*/
+static_assert(sizeof(std::atomic<int>) == sizeof(int),"futex needs a plain int");
+
+inline void pool_count_wait(std::atomic<int> &count,int expected,int timeout_us)
+{
+	struct timespec ts = {0,(long)timeout_us * 1000};
+	syscall(SYS_futex,reinterpret_cast<int *>(&count),FUTEX_WAIT_PRIVATE,expected,&ts,NULL,0);	//计数已经不是expected时立即返回
+}
+
+inline void pool_count_wake(std::atomic<int> &count)
+{
+	syscall(SYS_futex,reinterpret_cast<int *>(&count),FUTEX_WAKE_PRIVATE,INT_MAX,NULL,NULL,0);
+}
+
+//=========================共享状态=========================
+class future_state_base
+{
+public:
+	nThreadPool *m_pool;						//等待时帮忙执行这个线程池的任务，可以为NULL
+	std::exception_ptr m_error;
+private:
+	std::atomic<bool> m_ready;
+	std::mutex m_mtx;
+	std::condition_variable m_cond;
+	std::vector<std::function<void()>> m_callbacks;
+public:
+	explicit future_state_base(nThreadPool *pool) : m_pool(pool),m_ready(false){}
+
+	bool ready() const { return m_ready.load(std::memory_order_acquire); }
+
+	//结果（或者异常）写入之后调用：唤醒等待的线程，执行注册的回调
+	void finish()
+	{
+		std::vector<std::function<void()>> callbacks;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_ready.store(true,std::memory_order_release);
+			callbacks.swap(m_callbacks);
+		}
+		m_cond.notify_all();
+		for(auto &cb : callbacks){
+			cb();
+		}
+	}
+
+	void fail(std::exception_ptr error)
+	{
+		m_error = error;
+		finish();
+	}
+
+	//完成时调用cb，已经完成则立即调用。回调在完成任务的线程中直接执行，只应该做很少的事情（例如提交后续任务）
+	void on_ready(std::function<void()> cb)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			if(!m_ready.load(std::memory_order_relaxed)){
+				m_callbacks.push_back(std::move(cb));
+				return;
+			}
+		}
+		cb();
+	}
+
+	//边等待边帮忙执行线程池中的任务
+	void wait()
+	{
+		while(!ready()){
+			if(m_pool != NULL && threadPoolRunOne(m_pool)){
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_mtx);
+			m_cond.wait_for(lock,std::chrono::microseconds(200),[this]{ return m_ready.load(std::memory_order_relaxed); });	//醒来之后再看看有没有新的任务可以帮忙
+		}
+	}
+};
+
+template<typename T>
+class future_state : public future_state_base
+{
+public:
+	std::optional<T> m_value;
+public:
+	explicit future_state(nThreadPool *pool) : future_state_base(pool){}
+
+	//执行func，把返回值或者异常写入状态
+	template<typename F>
+	void fulfil(F &&func)
+	{
+		try{
+			m_value.emplace(func());
+		}catch(...){
+			m_error = std::current_exception();
+		}
+		finish();
+	}
+
+	T take()
+	{
+		return std::move(*m_value);
+	}
+};
+
+template<>
+class future_state<void> : public future_state_base
+{
+public:
+	explicit future_state(nThreadPool *pool) : future_state_base(pool){}
+
+	template<typename F>
+	void fulfil(F &&func)
+	{
+		try{
+			func();
+		}catch(...){
+			m_error = std::current_exception();
+		}
+		finish();
+	}
+
+	void take(){}
+};
+
+//=========================pool_future=========================
+template<typename T>
+class pool_future
+{
+public:
+	typedef future_state<T> state_type;
+	std::shared_ptr<state_type> m_state;
+public:
+	pool_future(){}
+	explicit pool_future(std::shared_ptr<state_type> state) : m_state(std::move(state)){}
+
+	bool valid() const { return m_state != nullptr; }
+	bool is_ready() const { return m_state->ready(); }
+	nThreadPool *pool() const { return m_state->m_pool; }
+
+	void wait() const { m_state->wait(); }
+
+	//等待并取出结果，任务抛出的异常在这里重新抛出
+	T get()
+	{
+		m_state->wait();
+		if(m_state->m_error){
+			std::rethrow_exception(m_state->m_error);
+		}
+		return m_state->take();
+	}
+
+	//完成之后把func(结果)提交到同一个线程池（T为void时是func()），返回func结果的future
+	template<typename F>
+	auto then(F func,int priority = THREADPOOL_PRIO_NORMAL)
+	{
+		typedef typename std::conditional<std::is_void<T>::value,std::invoke_result<F>,std::invoke_result<F,T>>::type::type R;
+		std::shared_ptr<state_type> prev = m_state;
+		auto next = std::make_shared<future_state<R>>(prev->m_pool);
+		prev->on_ready([prev,next,func,priority]() mutable {
+			if(prev->m_error){
+				next->fail(prev->m_error);
+				return;
+			}
+			int ret = pool_closure::post(prev->m_pool,[prev,next,func]() mutable {
+				if constexpr(std::is_void<T>::value){
+					next->fulfil([&]{ return func(); });
+				}else{
+					next->fulfil([&]{ return func(prev->take()); });
+				}
+			},priority);
+			if(ret != 0){
+				next->fail(std::make_exception_ptr(std::runtime_error("thread pool is shut down")));
+			}
+		});
+		return pool_future<R>(next);
+	}
+};
+
+//提交一个任务，返回它的结果
+template<typename F>
+auto pool_submit(nThreadPool *pool,F func,int priority = THREADPOOL_PRIO_NORMAL)
+{
+	typedef typename std::invoke_result<F>::type R;
+	auto state = std::make_shared<future_state<R>>(pool);
+	int ret = pool_closure::post(pool,[state,func]() mutable {
+		state->fulfil(func);
+	},priority);
+	if(ret != 0){
+		state->fail(std::make_exception_ptr(std::runtime_error("thread pool is shut down")));
+	}
+	return pool_future<R>(state);
+}
+
+//=========================when_all / when_any=========================
+/*
+when_all：所有future完成之后完成，结果是按原顺序排列的vector（T为void时没有结果）；任意一个失败则整体失败，异常是下标最小的那个
+when_any：任意一个完成之后完成，结果是它在vector中的下标，再对那个future调用get()取结果
+两者都不提交额外的任务，最后一个（第一个）完成的任务直接在自己的线程中完成组合
+*/
+template<typename T>
+auto when_all(std::vector<pool_future<T>> futures)
+{
+	typedef typename std::conditional<std::is_void<T>::value,void,std::vector<T>>::type R;
+	nThreadPool *pool = futures.empty() ? NULL : futures[0].pool();
+	auto result = std::make_shared<future_state<R>>(pool);
+	if(futures.empty()){
+		result->fulfil([]{ return R(); });
+		return pool_future<R>(result);
+	}
+
+	auto inputs = std::make_shared<std::vector<pool_future<T>>>(std::move(futures));
+	auto remaining = std::make_shared<std::atomic<size_t>>(inputs->size());
+	for(auto &f : *inputs){
+		f.m_state->on_ready([inputs,remaining,result]{
+			if(remaining->fetch_sub(1,std::memory_order_acq_rel) != 1){
+				return;
+			}
+			for(auto &in : *inputs){
+				if(in.m_state->m_error){
+					result->fail(in.m_state->m_error);
+					return;
+				}
+			}
+			result->fulfil([&]{
+				if constexpr(!std::is_void<T>::value){
+					R values;
+					values.reserve(inputs->size());
+					for(auto &in : *inputs){
+						values.push_back(in.m_state->take());
+					}
+					return values;
+				}
+			});
+		});
+	}
+	return pool_future<R>(result);
+}
+
+template<typename T>
+pool_future<size_t> when_any(const std::vector<pool_future<T>> &futures)
+{
+	nThreadPool *pool = futures.empty() ? NULL : futures[0].pool();
+	auto result = std::make_shared<future_state<size_t>>(pool);
+	if(futures.empty()){
+		result->fail(std::make_exception_ptr(std::invalid_argument("when_any: no futures")));
+		return pool_future<size_t>(result);
+	}
+
+	auto fired = std::make_shared<std::atomic<bool>>(false);
+	for(size_t i = 0;i < futures.size();i++){
+		futures[i].m_state->on_ready([fired,result,i]{
+			if(!fired->exchange(true,std::memory_order_acq_rel)){
+				result->fulfil([i]{ return i; });
+			}
+		});
+	}
+	return pool_future<size_t>(result);
+}
+
+//=========================任务图=========================
+/*
+先用add添加节点、precede(a,b)声明a必须在b之前完成，再run到线程池上执行：
+入度为0的节点先提交，每个节点完成之后把后继的剩余入度减1，减到0的后继再提交
+某个节点抛出异常之后，还没有开始的节点不再执行（仍然按依赖关系走完，保证计数归零），run返回的future带着第一个异常
+图中有环时run返回的future直接带着std::logic_error
+run返回的future完成之前task_graph不能销毁也不能再次run；完成之后可以重复run
+*/
+class task_graph
+{
+private:
+	struct node
+	{
+		std::function<void()> m_func;
+		std::vector<int> m_succ;				//后继节点
+		int m_deps;								//前驱节点数（入度）
+		std::atomic<int> m_remaining;			//本次运行还没有完成的前驱数
+	};
+	std::vector<std::unique_ptr<node>> m_nodes;
+	nThreadPool *m_pool;
+	std::atomic<int> m_unfinished;
+	std::atomic<bool> m_failed;
+	std::mutex m_error_mtx;
+	std::exception_ptr m_error;
+	std::shared_ptr<future_state<void>> m_done;
+public:
+	task_graph() : m_pool(NULL),m_unfinished(0),m_failed(false){}
+
+	//添加一个节点，返回节点编号
+	int add(std::function<void()> func)
+	{
+		std::unique_ptr<node> n(new node);
+		n->m_func = std::move(func);
+		n->m_deps = 0;
+		n->m_remaining.store(0,std::memory_order_relaxed);
+		m_nodes.push_back(std::move(n));
+		return (int)m_nodes.size() - 1;
+	}
+
+	//before完成之后after才能开始
+	void precede(int before,int after)
+	{
+		m_nodes.at(before)->m_succ.push_back(after);
+		m_nodes.at(after)->m_deps++;
+	}
+
+	size_t size() const { return m_nodes.size(); }
+
+	pool_future<void> run(nThreadPool *pool)
+	{
+		m_pool = pool;
+		m_done = std::make_shared<future_state<void>>(pool);
+		if(has_cycle()){
+			m_done->fail(std::make_exception_ptr(std::logic_error("task_graph: cycle detected")));
+			return pool_future<void>(m_done);
+		}
+		if(m_nodes.empty()){
+			m_done->finish();
+			return pool_future<void>(m_done);
+		}
+
+		m_failed.store(false,std::memory_order_relaxed);
+		m_error = nullptr;
+		m_unfinished.store((int)m_nodes.size(),std::memory_order_relaxed);
+		for(auto &n : m_nodes){
+			n->m_remaining.store(n->m_deps,std::memory_order_relaxed);
+		}
+		std::shared_ptr<future_state<void>> done = m_done;		//最后一个节点完成之后图可能马上被销毁，先留一份
+		for(size_t i = 0;i < m_nodes.size();i++){
+			if(m_nodes[i]->m_deps == 0){
+				schedule((int)i);
+			}
+		}
+		return pool_future<void>(done);
+	}
+private:
+	//线程池已经关闭时记录错误，在当前线程中走完这个节点（不执行函数），保证计数归零
+	void schedule(int id)
+	{
+		if(pool_closure::post(m_pool,[this,id]{ execute(id); }) != 0){
+			{
+				std::lock_guard<std::mutex> lock(m_error_mtx);
+				if(!m_error){
+					m_error = std::make_exception_ptr(std::runtime_error("thread pool is shut down"));
+				}
+			}
+			m_failed.store(true,std::memory_order_release);
+			execute(id);
+		}
+	}
+
+	void execute(int id)
+	{
+		node *n = m_nodes[id].get();
+		if(!m_failed.load(std::memory_order_acquire)){
+			try{
+				n->m_func();
+			}catch(...){
+				std::lock_guard<std::mutex> lock(m_error_mtx);
+				if(!m_error){
+					m_error = std::current_exception();
+				}
+				m_failed.store(true,std::memory_order_release);
+			}
+		}
+		for(int s : n->m_succ){
+			if(m_nodes[s]->m_remaining.fetch_sub(1,std::memory_order_acq_rel) == 1){
+				schedule(s);
+			}
+		}
+		if(m_unfinished.fetch_sub(1,std::memory_order_acq_rel) == 1){
+			std::shared_ptr<future_state<void>> done = m_done;
+			if(m_error){
+				done->fail(m_error);
+			}else{
+				done->finish();
+			}
+		}
+	}
+
+	//Kahn算法：能按入度为0的顺序取完所有节点就没有环
+	bool has_cycle() const
+	{
+		std::vector<int> deps(m_nodes.size());
+		std::vector<int> ready;
+		for(size_t i = 0;i < m_nodes.size();i++){
+			deps[i] = m_nodes[i]->m_deps;
+			if(deps[i] == 0){
+				ready.push_back((int)i);
+			}
+		}
+		size_t visited = 0;
+		while(!ready.empty()){
+			int id = ready.back();
+			ready.pop_back();
+			visited++;
+			for(int s : m_nodes[id]->m_succ){
+				if(--deps[s] == 0){
+					ready.push_back(s);
+				}
+			}
+		}
+		return visited != m_nodes.size();
+	}
+};
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef __THREADPOOLPARALLEL_H
+#define __THREADPOOLPARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "threadPoolFuture.h"
+
+/*
+nThreadPool上的数据并行算法，都在调用线程中同步完成，调用线程自己也参与计算
+1.parallel_for(pool,first,last,f)：对[first,last)中的每个下标i调用f(i)
+2.parallel_reduce(pool,first,last,identity,chunk,combine)：chunk(b,e,init)计算一段的结果，combine把两段的结果合并
+3.parallel_scan(pool,first,last,out,identity,op)：包含式前缀和（和std::inclusive_scan一样），op需要满足结合律
+4.parallel_sort(pool,first,last,comp)：稳定的归并排序，叶子用std::stable_sort，合并也是并行的
+切分方式：区间大于grain就对半切开，右半边提交到线程池（工作窃取模式下进入自己的队列，空闲线程来窃取），左半边自己继续切，
+所以一个线程没有被窃取的时候，它会按顺序把整个区间做完，只有被窃取走的部分才会产生额外的任务
+grain为0时自动选择：区间长度/(线程数*8)，不小于min_grain
+等待子任务时调用threadPoolRunOne帮忙执行，不会阻塞线程池中的线程；没有可以帮忙的任务时在未完成计数上短暂睡眠，不空转占用CPU
+*/
+
+//=========================任务组=========================
+//一组子任务：run提交，wait等待全部完成（边等待边帮忙），子任务中的第一个异常在wait时重新抛出
+class parallel_group
+{
+private:
+	nThreadPool *m_pool;
+	std::atomic<int> m_pending;							//未完成的子任务数，也是等待用的futex字
+	std::mutex m_error_mtx;
+	std::exception_ptr m_error;
+public:
+	explicit parallel_group(nThreadPool *pool) : m_pool(pool),m_pending(0){}
+	~parallel_group(){ wait_nothrow(); }
+
+	template<typename F>
+	void run(F func)
+	{
+		m_pending.fetch_add(1,std::memory_order_relaxed);
+		auto task = [this,func]() mutable {
+			try{
+				func();
+			}catch(...){
+				std::lock_guard<std::mutex> lock(m_error_mtx);
+				if(!m_error){
+					m_error = std::current_exception();
+				}
+			}
+			if(m_pending.fetch_sub(1,std::memory_order_release) == 1){
+				pool_count_wake(m_pending);						//最后一个子任务，唤醒等待者
+			}
+		};
+		if(pool_closure::post(m_pool,task) != 0){
+			task();												//线程池已经关闭，直接在当前线程执行
+		}
+	}
+
+	void wait()
+	{
+		wait_nothrow();
+		if(m_error){
+			std::exception_ptr error = m_error;
+			m_error = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+private:
+	void wait_nothrow()
+	{
+		int pending;
+		while((pending = m_pending.load(std::memory_order_acquire)) > 0){
+			if(!threadPoolRunOne(m_pool)){
+				pool_count_wait(m_pending,pending,200);			//子任务在其他线程中执行，没有可以帮忙的，睡眠等待而不是空转
+			}
+		}
+	}
+};
+
+//自动选择切分粒度
+inline size_t parallel_grain(nThreadPool *pool,size_t n,size_t grain,size_t min_grain)
+{
+	if(grain > 0){
+		return grain;
+	}
+	size_t workers = threadPoolSize(pool) > 0 ? threadPoolSize(pool) : 1;
+	grain = n / (workers * 8);
+	return grain < min_grain ? min_grain : grain;
+}
+
+//=========================parallel_for=========================
+template<typename F>
+void parallel_for_split(parallel_group &group,size_t first,size_t last,size_t grain,const F &func)
+{
+	while(last - first > grain){
+		size_t mid = first + (last - first) / 2;
+		group.run([&group,mid,last,grain,&func]{ parallel_for_split(group,mid,last,grain,func); });
+		last = mid;
+	}
+	for(size_t i = first;i < last;i++){
+		func(i);
+	}
+}
+
+template<typename F>
+void parallel_for(nThreadPool *pool,size_t first,size_t last,F func,size_t grain = 0)
+{
+	if(last <= first){
+		return;
+	}
+	grain = parallel_grain(pool,last - first,grain,1024);
+	parallel_group group(pool);
+	parallel_for_split(group,first,last,grain,func);
+	group.wait();
+}
+
+//=========================parallel_reduce=========================
+template<typename T,typename Chunk,typename Combine>
+T parallel_reduce_split(nThreadPool *pool,size_t first,size_t last,size_t grain,const T &identity,const Chunk &chunk,const Combine &combine)
+{
+	if(last - first <= grain){
+		return chunk(first,last,identity);
+	}
+	size_t mid = first + (last - first) / 2;
+	T right = identity;
+	parallel_group group(pool);
+	group.run([&]{ right = parallel_reduce_split(pool,mid,last,grain,identity,chunk,combine); });
+	T left = parallel_reduce_split(pool,first,mid,grain,identity,chunk,combine);
+	group.wait();
+	return combine(std::move(left),std::move(right));
+}
+
+//chunk(b,e,init)返回init和[b,e)合并的结果，combine(左,右)合并相邻两段的结果
+template<typename T,typename Chunk,typename Combine>
+T parallel_reduce(nThreadPool *pool,size_t first,size_t last,T identity,Chunk chunk,Combine combine,size_t grain = 0)
+{
+	if(last <= first){
+		return identity;
+	}
+	grain = parallel_grain(pool,last - first,grain,4096);
+	return parallel_reduce_split(pool,first,last,grain,identity,chunk,combine);
+}
+
+//=========================parallel_scan=========================
+/*
+三个阶段：
+1.把输入分成若干块，并行计算每块的总和
+2.在调用线程中对块的总和做前缀和，得到每块的起始值
+3.并行地对每块做前缀和，从起始值开始
+*/
+template<typename InIt,typename OutIt,typename T,typename Op>
+OutIt parallel_scan(nThreadPool *pool,InIt first,InIt last,OutIt out,T identity,Op op,size_t grain = 0)
+{
+	size_t n = std::distance(first,last);
+	if(n == 0){
+		return out;
+	}
+	grain = parallel_grain(pool,n,grain,16384);
+	size_t blocks = (n + grain - 1) / grain;
+	std::vector<T> sums(blocks,identity);
+
+	parallel_for(pool,0,blocks,[&](size_t b){
+		InIt it = first + b * grain;
+		InIt end = b + 1 == blocks ? last : it + grain;
+		T s = identity;
+		for(;it != end;++it){
+			s = op(s,*it);
+		}
+		sums[b] = s;
+	},1);
+
+	T carry = identity;
+	for(size_t b = 0;b < blocks;b++){
+		T s = sums[b];
+		sums[b] = carry;
+		carry = op(carry,s);
+	}
+
+	parallel_for(pool,0,blocks,[&](size_t b){
+		InIt it = first + b * grain;
+		InIt end = b + 1 == blocks ? last : it + grain;
+		OutIt o = out + b * grain;
+		T s = sums[b];
+		for(;it != end;++it,++o){
+			s = op(s,*it);
+			*o = s;
+		}
+	},1);
+	return out + n;
+}
+
+template<typename InIt,typename OutIt>
+OutIt parallel_scan(nThreadPool *pool,InIt first,InIt last,OutIt out)
+{
+	typedef typename std::iterator_traits<InIt>::value_type T;
+	return parallel_scan(pool,first,last,out,T(),std::plus<T>());
+}
+
+//=========================parallel_sort=========================
+/*
+把[a,a_end)和[b,b_end)两个有序段合并到out：在较长的段上取中点，用二分查找在另一段上找到分界，两边分别合并
+相等的元素a段在前，保证稳定
+*/
+template<typename It,typename OutIt,typename Comp>
+void parallel_merge(nThreadPool *pool,It a,It a_end,It b,It b_end,OutIt out,size_t grain,const Comp &comp)
+{
+	size_t na = a_end - a,nb = b_end - b;
+	if(na + nb <= grain){
+		std::merge(std::make_move_iterator(a),std::make_move_iterator(a_end),
+				   std::make_move_iterator(b),std::make_move_iterator(b_end),out,comp);
+		return;
+	}
+	It a_mid,b_mid;
+	if(na >= nb){
+		a_mid = a + na / 2;
+		b_mid = std::lower_bound(b,b_end,*a_mid,comp);				//b中严格小于a_mid的放左边
+	}else{
+		b_mid = b + nb / 2;
+		a_mid = std::upper_bound(a,a_end,*b_mid,comp);				//a中不大于b_mid的放左边
+	}
+	OutIt out_mid = out + ((a_mid - a) + (b_mid - b));
+	parallel_group group(pool);
+	group.run([&]{ parallel_merge(pool,a_mid,a_end,b_mid,b_end,out_mid,grain,comp); });
+	parallel_merge(pool,a,a_mid,b,b_mid,out,grain,comp);
+	group.wait();
+}
+
+/*
+排序src开始的n个元素，to_dst为true时结果放在dst中，否则留在src中；另一边同样长度的空间作为合并的临时空间
+两个缓冲区逐层交替（ping-pong）：子区间的结果放在父区间合并来源的一边，每层只有一次合并，不需要再搬回来
+*/
+template<typename It,typename TmpIt,typename Comp>
+void parallel_sort_split(nThreadPool *pool,It src,TmpIt dst,size_t n,bool to_dst,size_t grain,const Comp &comp)
+{
+	if(n <= grain){
+		std::stable_sort(src,src + n,comp);
+		if(to_dst){
+			std::move(src,src + n,dst);
+		}
+		return;
+	}
+	size_t half = n / 2;
+	{
+		parallel_group group(pool);
+		group.run([&]{ parallel_sort_split(pool,src + half,dst + half,n - half,!to_dst,grain,comp); });
+		parallel_sort_split(pool,src,dst,half,!to_dst,grain,comp);
+		group.wait();
+	}
+	if(to_dst){
+		parallel_merge(pool,src,src + half,src + half,src + n,dst,grain,comp);
+	}else{
+		parallel_merge(pool,dst,dst + half,dst + half,dst + n,src,grain,comp);
+	}
+}
+
+/*
+临时空间是未初始化的内存，值类型不需要默认构造：先把元素并行地移动构造到临时空间，
+再以临时空间为来源、[first,last)为目标排序，结果正好回到[first,last)；值类型的移动构造不能抛出异常
+*/
+template<typename It,typename Comp>
+void parallel_sort(nThreadPool *pool,It first,It last,Comp comp,size_t grain = 0)
+{
+	typedef typename std::iterator_traits<It>::value_type T;
+	size_t n = std::distance(first,last);
+	if(n < 2){
+		return;
+	}
+	grain = parallel_grain(pool,n,grain,16384);
+	std::allocator<T> alloc;
+	T *tmp = alloc.allocate(n);
+	parallel_for(pool,0,n,[&](size_t i){ ::new((void *)(tmp + i)) T(std::move(first[i])); },grain);
+	struct tmp_guard {
+		std::allocator<T> &alloc;
+		T *tmp;
+		size_t n;
+		~tmp_guard(){
+			for(size_t i = 0;i < n;i++){
+				tmp[i].~T();
+			}
+			alloc.deallocate(tmp,n);
+		}
+	} guard = {alloc,tmp,n};
+	parallel_sort_split(pool,tmp,first,n,true,grain,comp);
+}
+
+template<typename It>
+void parallel_sort(nThreadPool *pool,It first,It last)
+{
+	parallel_sort(pool,first,last,std::less<typename std::iterator_traits<It>::value_type>());
+}
+
+#endif
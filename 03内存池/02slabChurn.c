@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "memoryPool.h"
+
+/*
+反复分配释放（churn）时的内存占用：./02slabChurn [live] [steps]
+先分配live个对象（大小在16到512字节之间随机），然后steps次随机释放一个、再分配一个新的，最后释放90%的对象
+1.bump：mp_nalloc，小块内存不能单独释放，内存占用随分配总量一直增长
+2.slab：mp_salloc/mp_sfree，释放的对象被同一级别复用，内存占用跟随存活的对象数；空了的slab归还给系统
+3.malloc：glibc的malloc/free作为对照
+每种方式在单独的子进程中运行，输出每个阶段之后的RSS（/proc/self/statm）和每次操作的平均耗时
+随机释放90%之后大部分slab中还有存活的对象，不能归还，slab和malloc的RSS都基本不变；按分配顺序成批释放时空slab才会归还
+*/
+
+#define MODE_BUMP	0
+#define MODE_SLAB	1
+#define MODE_MALLOC	2
+
+static const char *modeNames[] = {"bump","slab","malloc"};
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long rss_kb(){
+	long pages = 0,resident = 0;
+	FILE *fp = fopen("/proc/self/statm","r");
+	if(fp){
+		if(fscanf(fp,"%ld %ld",&pages,&resident) != 2){
+			resident = 0;
+		}
+		fclose(fp);
+	}
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static struct mp_pool_s *pool;
+static int mode;
+
+static void *obj_alloc(size_t size){
+	switch(mode){
+	case MODE_BUMP:
+		return mp_nalloc(pool,size);
+	case MODE_SLAB:
+		return mp_salloc(pool,size);
+	default:
+		return malloc(size);
+	}
+}
+
+static void obj_free(void *p,size_t size){
+	switch(mode){
+	case MODE_BUMP:
+		break;														//小块内存不能单独释放
+	case MODE_SLAB:
+		mp_sfree(pool,p,size);
+		break;
+	default:
+		free(p);
+	}
+}
+
+static void run(long live,long steps){
+	void **objs = (void **)malloc(sizeof(void *) * live);
+	size_t *sizes = (size_t *)malloc(sizeof(size_t) * live);
+	unsigned int seed = 12345;										//每种方式的分配序列相同
+	pool = mp_create_pool(MP_PAGE_SIZE);
+	long base = rss_kb();
+
+	double start = now_sec();
+	for(long i = 0;i < live;i++){
+		sizes[i] = 16 + rand_r(&seed) % 497;
+		objs[i] = obj_alloc(sizes[i]);
+		memset(objs[i],(int)i,sizes[i]);							//写一遍，RSS才会计入
+	}
+	long filled = rss_kb() - base;
+
+	double churnStart = now_sec();
+	for(long i = 0;i < steps;i++){
+		long k = rand_r(&seed) % live;
+		obj_free(objs[k],sizes[k]);
+		sizes[k] = 16 + rand_r(&seed) % 497;
+		objs[k] = obj_alloc(sizes[k]);
+		memset(objs[k],(int)i,sizes[k]);
+	}
+	double churnSpend = now_sec() - churnStart;
+	long churned = rss_kb() - base;
+
+	for(long i = 0;i < live;i++){
+		if(i % 10 != 0){
+			obj_free(objs[i],sizes[i]);
+		}
+	}
+	long shrunk = rss_kb() - base;
+	double spend = now_sec() - start;
+
+	printf("%-6s: rss(KB) after fill %7ld after churn %7ld after freeing 90%% %7ld | churn %.0f ns/op total %.2fs\n",
+		modeNames[mode],filled,churned,shrunk,churnSpend * 1e9 / steps,spend);
+	for(long i = 0;i < live;i += 10){
+		obj_free(objs[i],sizes[i]);
+	}
+	mp_destory_pool(pool);
+	free(sizes);
+	free(objs);
+}
+
+int main(int argc,char *argv[]){
+	long live = argc > 1 ? atol(argv[1]) : 100000;
+	long steps = argc > 2 ? atol(argv[2]) : 2000000;
+	printf("live:%ld steps:%ld sizes:16-512 slab:%d bytes classes:%d max:%d\n",live,steps,MP_SLAB_SIZE,MP_SLAB_CLASSES,MP_SLAB_MAX);
+	fflush(stdout);
+
+	for(mode = MODE_BUMP;mode <= MODE_MALLOC;mode++){
+		pid_t pid = fork();											//每种方式单独一个进程，RSS互不影响
+		if(pid == 0){
+			run(live,steps);
+			exit(0);
+		}
+		waitpid(pid,NULL,0);
+	}
+	return 0;
+}
+
+//gcc -O2 ./02slabChurn.c ./memoryPool.c -o slabChurn
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "memoryPool.h"
+
+/*
+多线程分配：./03threadCache [threads] [ops]
+threads从1开始每次翻倍，每个线程ops次分配和释放，对象大小在16到512字节之间随机；每次都写满对象，释放前检查内容，发现两个线程拿到同一个对象时报错
+1.local：每个线程分配一批（64个）对象再全部释放，对象都在分配它的线程中释放
+2.remote：线程两两一组，生产者分配对象放入无锁环形队列，消费者取出检查后释放，所有的释放都发生在别的线程
+对比三种分配方式：
+1.malloc：glibc的malloc/free（每个线程有自己的tcache和arena）
+2.locked：一个mp_pool_s加一把锁，mp_salloc/mp_sfree都在锁里面
+3.shared：mp_shared_pool，线程缓存无锁分配，别的线程的对象压入owner的remote链表
+输出每秒的操作数（一次分配加一次释放算一次）和结束时shared还占用的slab数
+*/
+
+#define BATCH		64
+#define RING_SIZE	1024
+
+#define ALLOC_MALLOC	0
+#define ALLOC_LOCKED	1
+#define ALLOC_SHARED	2
+
+static const char *allocNames[] = {"malloc","locked","shared"};
+
+typedef struct {
+	void *p;
+	size_t size;
+} nObject;
+
+//单生产者单消费者的环形队列
+typedef struct {
+	unsigned long head __attribute__((aligned(64)));			//消费者的位置
+	unsigned long tail __attribute__((aligned(64)));			//生产者的位置
+	nObject slots[RING_SIZE] __attribute__((aligned(64)));
+} nRing;
+
+typedef struct {
+	int id;
+	int remote;
+	nRing *ring;												//remote模式下和另一个线程共享
+	long errors;
+} nWorker;
+
+static int allocator;
+static long opsPerThread;
+static struct mp_pool_s *lockedPool;
+static pthread_mutex_t lockedMtx = PTHREAD_MUTEX_INITIALIZER;
+static struct mp_shared_pool *sharedPool;
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *obj_alloc(size_t size){
+	void *p;
+	switch(allocator){
+	case ALLOC_MALLOC:
+		return malloc(size);
+	case ALLOC_LOCKED:
+		pthread_mutex_lock(&lockedMtx);
+		p = mp_salloc(lockedPool,size);
+		pthread_mutex_unlock(&lockedMtx);
+		return p;
+	default:
+		return mp_shared_alloc(sharedPool,size);
+	}
+}
+
+static void obj_free(void *p,size_t size){
+	switch(allocator){
+	case ALLOC_MALLOC:
+		free(p);
+		break;
+	case ALLOC_LOCKED:
+		pthread_mutex_lock(&lockedMtx);
+		mp_sfree(lockedPool,p,size);
+		pthread_mutex_unlock(&lockedMtx);
+		break;
+	default:
+		mp_shared_free(sharedPool,p,size);
+	}
+}
+
+//对象的第一个和最后一个字节是标记，被别的线程同时使用时会被改掉
+static nObject obj_new(unsigned int *seed,int tag){
+	nObject o;
+	o.size = 16 + rand_r(seed) % 497;
+	o.p = obj_alloc(o.size);
+	memset(o.p,tag,o.size);
+	return o;
+}
+
+static int obj_check(nObject o,int tag){
+	unsigned char *b = (unsigned char *)o.p;
+	return b[0] == (unsigned char)tag && b[o.size - 1] == (unsigned char)tag;
+}
+
+static void run_local(nWorker *w){
+	nObject objs[BATCH];
+	unsigned int seed = w->id + 1;
+	long i;
+	int k;
+	for(i = 0;i < opsPerThread;i += BATCH){
+		for(k = 0;k < BATCH;k++){
+			objs[k] = obj_new(&seed,w->id);
+		}
+		for(k = 0;k < BATCH;k++){
+			nObject o = objs[(k * 7) % BATCH];					//打乱释放顺序
+			w->errors += !obj_check(o,w->id);
+			obj_free(o.p,o.size);
+		}
+	}
+}
+
+static void run_producer(nWorker *w){
+	nRing *r = w->ring;
+	unsigned int seed = w->id + 1;
+	long i;
+	for(i = 0;i < opsPerThread;i++){
+		while(r->tail - __atomic_load_n(&r->head,__ATOMIC_ACQUIRE) == RING_SIZE){
+			sched_yield();
+		}
+		r->slots[r->tail % RING_SIZE] = obj_new(&seed,w->id);
+		__atomic_store_n(&r->tail,r->tail + 1,__ATOMIC_RELEASE);
+	}
+}
+
+static void run_consumer(nWorker *w){
+	nRing *r = w->ring;
+	long i;
+	for(i = 0;i < opsPerThread;i++){
+		while(__atomic_load_n(&r->tail,__ATOMIC_ACQUIRE) == r->head){
+			sched_yield();
+		}
+		nObject o = r->slots[r->head % RING_SIZE];
+		w->errors += !obj_check(o,w->id - 1);						//生产者是前一个线程
+		obj_free(o.p,o.size);
+		__atomic_store_n(&r->head,r->head + 1,__ATOMIC_RELEASE);
+	}
+}
+
+static void *worker(void *arg){
+	nWorker *w = (nWorker *)arg;
+	if(!w->remote){
+		run_local(w);
+	}else if(w->id % 2 == 0){
+		run_producer(w);
+	}else{
+		run_consumer(w);
+	}
+	return NULL;
+}
+
+static void run(int remote,int threads){
+	pthread_t tids[256];
+	nWorker workers[256];
+	nRing *rings = NULL;
+	int i;
+	if(remote){
+		void *mem = NULL;
+		if(posix_memalign(&mem,64,sizeof(nRing) * (threads / 2))){
+			return;
+		}
+		rings = (nRing *)mem;
+		memset(rings,0,sizeof(nRing) * (threads / 2));
+	}
+	lockedPool = mp_create_pool(MP_PAGE_SIZE);
+	sharedPool = mp_create_shared_pool();
+
+	double start = now_sec();
+	for(i = 0;i < threads;i++){
+		workers[i].id = i;
+		workers[i].remote = remote;
+		workers[i].ring = remote ? &rings[i / 2] : NULL;
+		workers[i].errors = 0;
+		pthread_create(&tids[i],NULL,worker,&workers[i]);
+	}
+	long errors = 0;
+	for(i = 0;i < threads;i++){
+		pthread_join(tids[i],NULL);
+		errors += workers[i].errors;
+	}
+	double spend = now_sec() - start;
+
+	long ops = remote ? opsPerThread * (threads / 2) : opsPerThread * threads;
+	printf("%-6s %-6s threads %3d: %6.2f Mops/s (%5.1f ns/op)",remote ? "remote" : "local",allocNames[allocator],threads,ops / spend / 1e6,spend * 1e9 / ops);
+	if(allocator == ALLOC_SHARED){
+		printf(" slabs left %zu",mp_shared_slabs(sharedPool));	//线程退出时空slab都还给了中心池
+	}
+	printf(" %s\n",errors ? "WRONG" : "ok");
+
+	mp_destory_shared_pool(sharedPool);
+	mp_destory_pool(lockedPool);
+	free(rings);
+}
+
+int main(int argc,char *argv[]){
+	int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+	opsPerThread = argc > 2 ? atol(argv[2]) : 2000000;
+	if(maxThreads > 256){
+		maxThreads = 256;
+	}
+	printf("threads:1-%d ops per thread:%ld sizes:16-512 cpus:%ld\n",maxThreads,opsPerThread,sysconf(_SC_NPROCESSORS_ONLN));
+
+	int remote,threads;
+	for(remote = 0;remote <= 1;remote++){
+		for(threads = remote ? 2 : 1;threads <= maxThreads;threads *= 2){
+			for(allocator = ALLOC_MALLOC;allocator <= ALLOC_SHARED;allocator++){
+				run(remote,threads);
+			}
+		}
+	}
+	return 0;
+}
+
+//gcc -O2 ./03threadCache.c ./memoryPool.c -o threadCache -lpthread
@@ -0,0 +1,689 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "memoryPool.h"
+
+//===============================内部函数声明===============================
+static void *mp_alloc_block(struct mp_pool_s *pool,size_t size);			//分配小块节点
+static void *mp_alloc_large(struct mp_pool_s *pool,size_t size);			//分配大块节点
+static void *mp_memalign_large(struct mp_pool_s *pool,size_t size);			//分配大块节点（包含对齐操作）
+static void mp_slab_release_all(struct mp_pool_s *pool);					//释放所有slab
+
+//===============================开始定义内存池分配和释放函数===============================
+//内存池构建
+//注意：我们需要严格控制内存分配，尽量避免出现跨页现象，对于size的理解尤为重要！！！
+struct mp_pool_s *mp_create_pool(size_t size){
+	struct mp_pool_s *p;
+	//注意：在分配内存池空间的时候，我们会一道将第一个小内存节点空间分配了，可以用柔性数组进行标识查找！！！
+	//使用posix_memalign专门分配大块内存
+	int ret = posix_memalign((void**)&p,MP_ALIGNMENT,size + sizeof(struct mp_pool_s) + sizeof(struct mp_small_node));					
+
+	if(ret){														
+		return NULL;
+	}
+
+	p->max = (size < MP_MAX_ALLOC_FROM_POOL) ? size : MP_MAX_ALLOC_FROM_POOL;						//获取内存块界限
+	p->current = p->head;													//第一个小内存节点，和我们的内存池结构体是相连的内存
+	p->large = NULL;														//大块内存还没有开始分配
+	memset(p->classes,0,sizeof(p->classes));								//slab按需申请
+
+	p->head->last = (unsigned char *)p + sizeof(struct mp_pool_s) + sizeof(struct mp_small_node);	//指针指向小块内存起始位置（可以正式分配的位置）
+	p->head->end = p->head->last + size;
+
+	p->head->next = NULL;													//posix_memalign不会清零，不设置的话遍历小块节点时会访问到野指针
+	p->head->failed = 0;
+
+	return p;
+}
+
+//内存池销毁,回收所有的内存空间
+void mp_destory_pool(struct mp_pool_s *pool){
+	struct mp_small_node *h,*n;												//用于小块内存的销毁
+	struct mp_large_node *l;												//用于大块内存销毁
+
+	//由于大块内存是头插法，所以遍历方便，容易销毁
+	for(l = pool->large;l;l=l->next){
+		if(l->alloc){														//如果内存被分配了，则可以进行释放
+			free(l->alloc);
+		}
+	}
+	//注意：上面只是释放了内存空间，对于大块内存节点还没有释放，但是由于节点是存放在小块内存中的，所以后面释放小块内存时，会进行释放
+
+	//开始释放小块内存
+	h = pool->head->next;													//释放小块内存，从第二块开始释放，第一块与内存池结构体柔性数组相连，在释放内存池结构体时被释放！！！
+
+	while(h){
+		n = h->next;
+		free(h);
+		h = n;
+	}
+
+	mp_slab_release_all(pool);
+
+	//好了，最后释放内存池结构体
+	free(pool);
+}
+
+//内存池状态重置，但是保留了分配小块内存（last指针被置为内存的起始位置）
+void mp_reset_pool(struct mp_pool_s *pool){
+	struct mp_small_node *h;
+	struct mp_large_node *l;
+
+	//对于大块内存全部释放
+	for(l=pool->large;l;l=l->next){
+		if(l->alloc){
+			free(l->alloc);
+		}
+	}
+
+	pool->large = NULL;
+
+	mp_slab_release_all(pool);										//slab中的对象也一起失效
+
+	//对于小块内存，将last指针置为初始位置---即内存空间都可以重新分配！！！
+	for(h = pool->head;h;h=h->next){
+		h->last = (unsigned char *)h + sizeof(struct mp_small_node);
+		h->failed = 0;												//失败次数也要清零，否则重置之后前面的节点会被永远跳过
+	}
+
+	pool->current = pool->head;										//重新从第一个节点开始分配，长期反复重置的内存池（比如每个请求重置一次）才不会一直增长
+}
+
+
+//===============================开始定义内存分配和释放函数===============================
+//分配小块节点，并在节点中分配空间返回空间首地址
+static void *mp_alloc_block(struct mp_pool_s *pool,size_t size){
+	unsigned char *m;												//要分配的内存空间
+	struct mp_small_node *h = pool->head;							//根据首块节点，获取后面每块节点的空间大小（与max无关）
+	size_t psize = (size_t)(h->end - (unsigned char*)h);			//每块节点大小都要一致！！！
+
+	int ret = posix_memalign((void **)&m,MP_ALIGNMENT,psize);		//成功则返回0
+	if(ret){
+		return NULL;
+	}
+
+	struct mp_small_node *p, *new_node, *current;				
+
+	new_node = (struct mp_small_node*)m;
+	new_node->end = m + psize;
+	new_node->next = NULL;
+	new_node->failed = 0;
+
+	//下面开始改变m,分配空间
+	m += sizeof(struct mp_small_node);
+	m = (unsigned char *)mp_align_ptr(m, MP_ALIGNMENT);
+	new_node->last = m + size;										//前面size部分被分配了
+
+	current = pool->current;										//遍历结点，修改failed字段
+	for(p = current;p->next;p=p->next){
+		if(p->failed++ > 4){										//允许分配出错6次
+			current = p->next;
+		}
+	}
+
+	p->next = new_node;												//尾插法
+
+	pool->current = current ? current : new_node;					//修改current指针
+
+	return m;														//新节点的前size字节就是分配出去的空间
+}
+
+//分配大块节点,直接分配，然后返回指针即可
+static void *mp_alloc_large(struct mp_pool_s *pool,size_t size){
+	void *p = malloc(size);											//malloc也可以用于大块内存分配，只是少了对齐操作，但是大块内存分配不需要对齐，所以使用malloc正好
+	if(p == NULL){
+		return NULL;
+	}
+
+	//下面遍历所有大块节点的alloc指针，如果为NULL，则可以直接将内存挂上去
+	size_t n = 0;
+	struct mp_large_node *large;
+	for(large = pool->large; large; large=large->next){
+		if(large->alloc == NULL){
+			large->alloc = p;
+			return p;
+		}
+		if(n++ > 3){												//如果查找5次节点都没有找到空alloc指针，则直接头插法
+			break;
+		}
+	}
+
+	//开始头插法插入大块内存
+	//1.先把结构体空间分配到小块空间中去
+	large = (struct mp_large_node *)mp_alloc(pool,sizeof(struct mp_large_node));
+	if(large == NULL){
+		free(p);													//结构体结点分配失败，则没有必要继续了
+		return NULL;
+	}
+
+	//2.头插法处理
+	large->alloc = p;
+	large->next = pool->large;
+	pool->large = large;
+
+	return p;
+}
+
+//分配大块节点,对齐分配，然后返回指针即可
+static void *mp_memalign_large(struct mp_pool_s *pool,size_t size){
+	void *p;
+
+	int ret = posix_memalign(&p,MP_ALIGNMENT,size);					//这里继续对齐操作
+	if(ret){
+		return NULL;
+	}
+
+	//下面遍历所有大块节点的alloc指针，如果为NULL，则可以直接将内存挂上去
+	size_t n = 0;
+	struct mp_large_node *large;
+	for(large = pool->large; large; large=large->next){
+		if(large->alloc == NULL){
+			large->alloc = p;
+			return p;
+		}
+		if(n++ > 3){												//如果查找5次节点都没有找到空alloc指针，则直接头插法
+			break;
+		}
+	}
+
+	//开始头插法插入大块内存
+	//1.先把结构体空间分配到小块空间中去
+	large = (struct mp_large_node *)mp_alloc(pool,sizeof(struct mp_large_node));
+	if(large == NULL){
+		free(p);													//结构体结点分配失败，则没有必要继续了
+		return NULL;
+	}
+
+	//2.头插法处理
+	large->alloc = p;
+	large->next = pool->large;
+	pool->large = large;
+
+	return p;
+}
+
+//内存分配,会判断分配大块还是小块内存,包含对齐操作
+void *mp_alloc(struct mp_pool_s *pool,size_t size){
+	unsigned char *m;
+	struct mp_small_node *p;
+
+	if(size <= pool->max){											//可以放入小块内存中，开始去遍历小块内存
+		p = pool->current;
+
+		do {
+			m = (unsigned char *)mp_align_ptr(p->last,MP_ALIGNMENT);					//地址对齐，方便后面寻址，提高效率！！！！
+			if(m <= p->end && (size_t)(p->end - m) >= size){			//对齐之后m可能越过end，差值为负数，转成size_t会变成很大的数
+				p->last = m + size;									//如果current块空间足够，则直接分配空间
+				return m;
+			}
+
+			p = p->next;											//如果current块空间不够分配，则去找下一块空间
+		}while(p);
+
+		return mp_alloc_block(pool,size);							//分配小块节点
+	}
+
+	return mp_memalign_large(pool,size);							//分配大块节点
+}							
+
+//内存分配,会判断分配大块还是小块内存
+void *mp_nalloc(struct mp_pool_s *pool,size_t size){
+	unsigned char *m;
+	struct mp_small_node *p;
+
+	if(size <= pool->max){
+		p = pool->current;											//小块内存分配
+
+		do {
+			m = p->last;
+			if((size_t)(p->end - m) >= size){						//空间足够
+				p->last = m + size;
+				return m;
+			}
+
+			p = p->next;
+		}while(p);
+
+		return mp_alloc_block(pool,size);
+	}
+
+	return mp_alloc_large(pool,size);
+}
+						
+//内部调用mp_alloc,会对内存进行置0操作						
+void *mp_calloc(struct mp_pool_s *pool,size_t size){
+	void *p = mp_alloc(pool,size);									//调用上面方法，含对齐,方便寻址！！！！但是会造成部分空间未被使用
+	if(p){
+		memset(p,0,size);
+	}
+
+	return p;
+}
+
+//内存释放，释放大块内存，内存地址为p则释放
+void mp_free(struct mp_pool_s *pool,void *p){
+	struct mp_large_node *l;
+
+	for(l = pool->large; l; l=l->next){
+		if(p == l->alloc){											//找到要释放的节点，直接释放了
+			free(l->alloc);
+			l->alloc = NULL;
+			return;
+		}
+	}
+}
+
+//===============================按大小分级的slab===============================
+//对象从slab头部之后开始，按16字节对齐（所有级别的大小都是16的倍数，所以每个对象都对齐）
+#define MP_SLAB_HEADER	mp_align(sizeof(struct mp_slab),16)
+
+//链表操作：slab在partial或者full链表中
+static void mp_slab_unlink(struct mp_slab **list,struct mp_slab *s){
+	if(s->prev){
+		s->prev->next = s->next;
+	}else{
+		*list = s->next;
+	}
+	if(s->next){
+		s->next->prev = s->prev;
+	}
+	s->prev = s->next = NULL;
+}
+
+static void mp_slab_push(struct mp_slab **list,struct mp_slab *s){
+	s->prev = NULL;
+	s->next = *list;
+	if(*list){
+		(*list)->prev = s;
+	}
+	*list = s;
+}
+
+/*
+slab直接用mmap申请：多映射一个MP_SLAB_SIZE，再把对齐地址前后多出的部分munmap掉
+posix_memalign按16KB对齐时，glibc在每个slab前后留下的碎片很难被再利用，churn测试中RSS多出一半以上
+*/
+static struct mp_slab *mp_slab_map(){
+	unsigned char *m = (unsigned char *)mmap(NULL,MP_SLAB_SIZE * 2,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+	if(m == MAP_FAILED){
+		return NULL;
+	}
+	unsigned char *s = (unsigned char *)mp_align_ptr(m,MP_SLAB_SIZE);
+	if(s > m){
+		munmap(m,s - m);
+	}
+	munmap(s + MP_SLAB_SIZE,m + MP_SLAB_SIZE - s);					//前后一共多出MP_SLAB_SIZE
+	return (struct mp_slab *)s;
+}
+
+static void mp_slab_unmap(struct mp_slab *s){
+	if(s){
+		munmap(s,MP_SLAB_SIZE);
+	}
+}
+
+static void mp_slab_free_list(struct mp_slab *s){
+	while(s){
+		struct mp_slab *n = s->next;
+		mp_slab_unmap(s);
+		s = n;
+	}
+}
+
+static void mp_slab_release_all(struct mp_pool_s *pool){
+	int i;
+	for(i = 0;i < MP_SLAB_CLASSES;i++){
+		struct mp_slab_class *c = &pool->classes[i];
+		mp_slab_free_list(c->partial);
+		mp_slab_free_list(c->full);
+		mp_slab_unmap(c->empty);
+		memset(c,0,sizeof(struct mp_slab_class));
+	}
+}
+
+//空slab：所有对象都还没有分配过，从fresh开始按顺序切分
+static void mp_slab_init(struct mp_slab *s,int cls){
+	s->prev = s->next = NULL;
+	s->free = NULL;
+	s->fresh = (unsigned char *)s + MP_SLAB_HEADER;
+	s->inuse = 0;
+	s->total = (MP_SLAB_SIZE - MP_SLAB_HEADER) / MP_SLAB_CLASS_SIZE(cls);
+	s->cls = cls;
+	s->owner = NULL;
+}
+
+//从partial链表中的slab分配一个对象
+static void *mp_slab_take(struct mp_slab_class *c,struct mp_slab *s){
+	void *p;
+	if(s->free){													//优先复用释放过的对象，缓存更热
+		p = s->free;
+		s->free = *(void **)p;
+	}else{
+		p = s->fresh;
+		s->fresh += MP_SLAB_CLASS_SIZE(s->cls);
+	}
+	if(++s->inuse == s->total){										//分配完了，移到full链表
+		mp_slab_unlink(&c->partial,s);
+		mp_slab_push(&c->full,s);
+	}
+	return p;
+}
+
+//对象放回slab，slab空了时从链表中摘下并返回1，由调用者缓存或者归还
+static int mp_slab_put(struct mp_slab_class *c,struct mp_slab *s,void *p){
+	*(void **)p = s->free;
+	s->free = p;
+	if(s->inuse-- == s->total){										//从full回到partial
+		mp_slab_unlink(&c->full,s);
+		mp_slab_push(&c->partial,s);
+	}
+	if(s->inuse == 0){
+		mp_slab_unlink(&c->partial,s);
+		return 1;
+	}
+	return 0;
+}
+
+//16到128：每16字节一级；之后以2的幂为界，每段分成4级，(size-1)右移(b-2)位之后是4到7，就是段内的级别+4
+int mp_slab_class(size_t size){
+	if(size <= 128){
+		return size == 0 ? 0 : (int)((size + 15) >> 4) - 1;
+	}
+	if(size > MP_SLAB_MAX){
+		return -1;
+	}
+	int b = 63 - __builtin_clzll((unsigned long long)(size - 1));	//size-1的最高位，size大于128时至少是7
+	return 8 + (b - 7) * 4 + (int)((size - 1) >> (b - 2)) - 4;
+}
+
+void *mp_salloc(struct mp_pool_s *pool,size_t size){
+	int cls = mp_slab_class(size);
+	if(cls < 0){
+		return mp_memalign_large(pool,size);						//大对象按大块内存分配
+	}
+
+	struct mp_slab_class *c = &pool->classes[cls];
+	struct mp_slab *s = c->partial;
+	if(s == NULL){
+		if(c->empty){												//先用缓存的空slab
+			s = c->empty;
+			c->empty = NULL;
+		}else{
+			s = mp_slab_map();
+			if(s == NULL){
+				return NULL;
+			}
+			mp_slab_init(s,cls);
+			c->slabs++;
+		}
+		mp_slab_push(&c->partial,s);
+	}
+	return mp_slab_take(c,s);
+}
+
+void mp_sfree(struct mp_pool_s *pool,void *p,size_t size){
+	if(p == NULL){
+		return;
+	}
+	int cls = mp_slab_class(size);
+	if(cls < 0){
+		mp_free(pool,p);
+		return;
+	}
+
+	struct mp_slab *s = (struct mp_slab *)((size_t)p & ~((size_t)MP_SLAB_SIZE - 1));	//slab按MP_SLAB_SIZE对齐
+	struct mp_slab_class *c = &pool->classes[s->cls];
+	if(mp_slab_put(c,s,p)){											//空了：缓存一个，多的归还给系统
+		if(c->empty == NULL){
+			mp_slab_init(s,s->cls);
+			c->empty = s;
+		}else{
+			mp_slab_unmap(s);
+			c->slabs--;
+		}
+	}
+}
+
+//===============================多线程共享的内存池===============================
+static unsigned long mp_shared_ids;
+
+//最近使用的内存池和本线程的缓存，命中时不需要pthread_getspecific
+static __thread struct {
+	struct mp_shared_pool *pool;
+	unsigned long id;
+	struct mp_heap *heap;
+} mp_tls;
+
+#define mp_slab_of(p)	((struct mp_slab *)((size_t)(p) & ~((size_t)MP_SLAB_SIZE - 1)))
+
+//从中心池取一个空slab，没有缓存的就向系统申请
+static struct mp_slab *mp_central_get(struct mp_shared_pool *pool){
+	pthread_mutex_lock(&pool->mtx);
+	struct mp_slab *s = pool->cached;
+	if(s){
+		pool->cached = s->next;
+		pool->cached_count--;
+	}else{
+		pool->slabs++;
+	}
+	pthread_mutex_unlock(&pool->mtx);
+	if(s == NULL && (s = mp_slab_map()) == NULL){					//mmap不需要持有锁
+		pthread_mutex_lock(&pool->mtx);
+		pool->slabs--;
+		pthread_mutex_unlock(&pool->mtx);
+	}
+	return s;
+}
+
+static void mp_central_put(struct mp_shared_pool *pool,struct mp_slab *s){
+	pthread_mutex_lock(&pool->mtx);
+	if(pool->cached_count < MP_SHARED_CACHED_SLABS){
+		s->next = pool->cached;
+		pool->cached = s;
+		pool->cached_count++;
+		s = NULL;
+	}else{
+		pool->slabs--;
+	}
+	pthread_mutex_unlock(&pool->mtx);
+	mp_slab_unmap(s);
+}
+
+//owner释放自己的对象：空slab在线程缓存中留一个，多的还给中心池
+static void mp_heap_put(struct mp_heap *heap,struct mp_slab *s,void *p){
+	struct mp_slab_class *c = &heap->classes[s->cls];
+	if(mp_slab_put(c,s,p)){
+		if(c->empty == NULL){
+			mp_slab_init(s,s->cls);
+			s->owner = heap;
+			c->empty = s;
+		}else{
+			c->slabs--;
+			mp_central_put(heap->pool,s);
+		}
+	}
+}
+
+//取走别的线程释放的对象，放回各自的slab
+static void mp_heap_drain(struct mp_heap *heap){
+	void *p = __atomic_exchange_n(&heap->remote,NULL,__ATOMIC_ACQUIRE);
+	while(p){
+		void *next = *(void **)p;
+		mp_heap_put(heap,mp_slab_of(p),p);
+		p = next;
+	}
+}
+
+//线程退出：取走remote对象，空slab还给中心池，线程缓存放入orphan链表等待新线程接管
+static void mp_heap_abandon(void *arg){
+	struct mp_heap *heap = (struct mp_heap *)arg;
+	struct mp_shared_pool *pool = heap->pool;
+	int i;
+	mp_heap_drain(heap);
+	for(i = 0;i < MP_SLAB_CLASSES;i++){
+		struct mp_slab_class *c = &heap->classes[i];
+		if(c->empty){
+			mp_central_put(pool,c->empty);
+			c->empty = NULL;
+			c->slabs--;
+		}
+	}
+	pthread_mutex_lock(&pool->mtx);
+	heap->orphan = pool->orphans;
+	pool->orphans = heap;
+	pthread_mutex_unlock(&pool->mtx);
+}
+
+//本线程的缓存，没有时返回NULL
+static struct mp_heap *mp_heap_find(struct mp_shared_pool *pool){
+	if(mp_tls.pool == pool && mp_tls.id == pool->id){
+		return mp_tls.heap;
+	}
+	struct mp_heap *heap = (struct mp_heap *)pthread_getspecific(pool->key);
+	if(heap){
+		mp_tls.pool = pool;
+		mp_tls.id = pool->id;
+		mp_tls.heap = heap;
+	}
+	return heap;
+}
+
+//本线程的缓存，没有时接管一个orphan或者新建一个
+static struct mp_heap *mp_heap_get(struct mp_shared_pool *pool){
+	struct mp_heap *heap = mp_heap_find(pool);
+	if(heap){
+		return heap;
+	}
+	pthread_mutex_lock(&pool->mtx);
+	heap = pool->orphans;
+	if(heap){
+		pool->orphans = heap->orphan;
+		heap->orphan = NULL;
+	}
+	pthread_mutex_unlock(&pool->mtx);
+	if(heap == NULL){
+		void *mem = NULL;
+		if(posix_memalign(&mem,64,sizeof(struct mp_heap))){
+			return NULL;
+		}
+		heap = (struct mp_heap *)mem;
+		memset(heap,0,sizeof(struct mp_heap));
+		heap->pool = pool;
+		pthread_mutex_lock(&pool->mtx);
+		heap->next = pool->heaps;
+		pool->heaps = heap;
+		pthread_mutex_unlock(&pool->mtx);
+	}
+	pthread_setspecific(pool->key,heap);
+	mp_tls.pool = pool;
+	mp_tls.id = pool->id;
+	mp_tls.heap = heap;
+	return heap;
+}
+
+struct mp_shared_pool *mp_create_shared_pool(void){
+	struct mp_shared_pool *pool = (struct mp_shared_pool *)calloc(1,sizeof(struct mp_shared_pool));
+	if(pool == NULL){
+		return NULL;
+	}
+	if(pthread_key_create(&pool->key,mp_heap_abandon)){
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->mtx,NULL);
+	pool->id = __atomic_add_fetch(&mp_shared_ids,1,__ATOMIC_RELAXED);
+	return pool;
+}
+
+void mp_destory_shared_pool(struct mp_shared_pool *pool){
+	if(pool == NULL){
+		return;
+	}
+	pthread_key_delete(pool->key);									//之后退出的线程不会再调用mp_heap_abandon
+	struct mp_heap *heap = pool->heaps;
+	while(heap){
+		struct mp_heap *next = heap->next;
+		int i;
+		for(i = 0;i < MP_SLAB_CLASSES;i++){
+			mp_slab_free_list(heap->classes[i].partial);
+			mp_slab_free_list(heap->classes[i].full);
+			mp_slab_unmap(heap->classes[i].empty);
+		}
+		free(heap);
+		heap = next;
+	}
+	mp_slab_free_list(pool->cached);
+	if(mp_tls.pool == pool){
+		mp_tls.pool = NULL;
+	}
+	pthread_mutex_destroy(&pool->mtx);
+	free(pool);
+}
+
+void *mp_shared_alloc(struct mp_shared_pool *pool,size_t size){
+	int cls = mp_slab_class(size);
+	if(cls < 0){
+		return malloc(size);
+	}
+	struct mp_heap *heap = mp_heap_get(pool);
+	if(heap == NULL){
+		return NULL;
+	}
+
+	struct mp_slab_class *c = &heap->classes[cls];
+	struct mp_slab *s = c->partial;
+	if(s == NULL && __atomic_load_n(&heap->remote,__ATOMIC_RELAXED)){	//先收回别的线程释放的对象
+		mp_heap_drain(heap);
+		s = c->partial;
+	}
+	if(s == NULL){
+		if(c->empty){
+			s = c->empty;
+			c->empty = NULL;
+		}else{
+			s = mp_central_get(pool);
+			if(s == NULL){
+				return NULL;
+			}
+			mp_slab_init(s,cls);
+			s->owner = heap;
+			c->slabs++;
+		}
+		mp_slab_push(&c->partial,s);
+	}
+	return mp_slab_take(c,s);
+}
+
+void mp_shared_free(struct mp_shared_pool *pool,void *p,size_t size){
+	if(p == NULL){
+		return;
+	}
+	if(mp_slab_class(size) < 0){
+		free(p);
+		return;
+	}
+
+	struct mp_slab *s = mp_slab_of(p);
+	struct mp_heap *owner = s->owner;								//对象还没有释放，owner不会变化
+	if(owner == mp_heap_find(pool)){
+		mp_heap_put(owner,s,p);
+		return;
+	}
+	void *head = __atomic_load_n(&owner->remote,__ATOMIC_RELAXED);	//别的线程的对象：压入owner的remote链表
+	do{
+		*(void **)p = head;
+	}while(!__atomic_compare_exchange_n(&owner->remote,&head,p,1,__ATOMIC_RELEASE,__ATOMIC_RELAXED));
+}
+
+size_t mp_shared_slabs(struct mp_shared_pool *pool){
+	pthread_mutex_lock(&pool->mtx);
+	size_t n = pool->slabs;
+	pthread_mutex_unlock(&pool->mtx);
+	return n;
+}
@@ -0,0 +1,161 @@
+/*
+*先去了解nginx内存池：https://www.cnblogs.com/shuqin/p/13837898.html
+*/
+#ifndef __MEMORYPOOL_H
+#define __MEMORYPOOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+//https://www.cnblogs.com/shuqin/p/13837898.html
+#define MP_ALIGNMENT			32
+#define MP_PAGE_SIZE			4096										//正好一页内存大小
+#define MP_MAX_ALLOC_FROM_POOL	(MP_PAGE_SIZE - 1)							//当小于4096时候，小块内存分配；当大于等于4096为大块内存分配
+//疑惑：为啥是4095，而不是4096---因为只有分配的空间小于一页的时候才有缓存的必要（放入内存池）
+//注意：4096不代表小块内存必须小于4096，而是说，当获取的内存大于等于4096时没有必要去内存池中申请空间，还不如直接利用系统接口直接向系统申请！！！！！！
+
+
+//内存对齐:https://blog.csdn.net/supperwangli/article/details/5142956
+//内存对齐，位取反和与操作即可
+#define mp_align(n,alignment) (((n) + (alignment - 1)) & ~(alignment - 1))	//返回对齐后的空间大小
+/*
+也是用于对齐操作（或者说地址对齐）:寻址更快
+比如一块内存大小1024字节，第一个程序占了501字节，那么第二个程序需要空间时从哪个地址开始？
+先对第一块地址进行对齐操作到512，然后再从512开始分配新的地址给另外一个程序
+*/
+#define mp_align_ptr(p,alignment) (void *)((((size_t)p) + (alignment - 1)) & ~(alignment - 1))
+
+/*
+按大小分级的slab：mp_alloc/mp_nalloc的小块内存只能整体重置，不能单独释放，长期使用、反复分配释放的内存池会一直增长
+mp_salloc/mp_sfree把小对象按大小分成MP_SLAB_CLASSES级，每级从自己的slab（MP_SLAB_SIZE字节，按MP_SLAB_SIZE对齐）中分配
+1.级别：16到128每16字节一级（8级），之后每次翻倍分成4级（160,192,224,256,320,...,1024），相邻级别的浪费不超过25%
+  大小由MP_SLAB_CLASS_SIZE(i)在编译时计算，mp_slab_class把大小换算成级别只用移位，不查表也不循环
+2.slab用mmap申请，开头是struct mp_slab，之后是同样大小的对象；空闲对象的前8字节存下一个空闲对象（侵入式链表），分配和释放都是O(1)
+  对象的地址按MP_SLAB_SIZE向下取整就是所在的slab，释放时不需要查找
+3.每级有三个slab链表：partial（还有空闲对象，从这里分配）、full、empty（最多缓存一个空slab，避免在边界上反复申请释放）
+  slab中的对象全部释放之后归还给系统，所以内存占用跟随实际使用的对象数，而不是历史最大值
+4.大于MP_SLAB_MAX的对象按大块内存分配，mp_sfree转给mp_free；mp_reset_pool和mp_destory_pool同时释放所有slab
+mp_sfree需要传入分配时的大小（和C++的sized delete一样），据此区分slab对象和大块内存
+*/
+#define MP_SLAB_SIZE			16384										//每个slab的大小，也是它的对齐
+#define MP_SLAB_CLASSES			20											//级别数
+#define MP_SLAB_CLASS_SIZE(i)	((i) < 8 ? 16 * ((i) + 1) : (5 + ((i) - 8) % 4) << (5 + ((i) - 8) / 4))	//第i级的对象大小
+#define MP_SLAB_MAX				MP_SLAB_CLASS_SIZE(MP_SLAB_CLASSES - 1)		//slab分配的最大对象（1024）
+
+/*
+多线程共享的内存池：mp_pool_s没有任何同步，只能在一个线程中使用，对象也不能在别的线程中释放
+mp_shared_pool按mimalloc的思路把slab分给线程：
+1.每个线程第一次分配时得到一个线程缓存（struct mp_heap），有自己的各级slab链表，分配和本线程释放都不加锁，和mp_salloc/mp_sfree相同
+2.中心池只管理整块的slab：线程缓存没有可用的slab时加锁从中心池取一个（一次补充一整个slab的对象），空了的slab多于一个时还给中心池
+  中心池缓存最多MP_SHARED_CACHED_SLABS个空slab给所有线程和级别复用，更多的归还给系统
+3.slab记录所属的线程缓存（owner）；别的线程释放的对象无锁地压入owner的remote链表（多生产者单消费者，CAS头插），
+  owner在本级没有可用slab时一次取走整个链表（exchange），放回各自的slab。slab的元数据始终只有owner修改
+4.线程退出时线程缓存交还中心池（orphan），保留其中的slab和还没有取走的remote对象，之后新的线程直接接管
+5.大于MP_SLAB_MAX的对象直接用malloc/free
+mp_destory_shared_pool之前所有线程都要停止使用这个内存池；对象不需要全部释放，slab会一起归还
+*/
+#define MP_SHARED_CACHED_SLABS	64											//中心池缓存的空slab数
+
+
+
+//===============================开始定义内存池结构体===============================
+//定义大块内存结构体，整体按照链表结构关联
+struct mp_large_node {
+	struct mp_large_node *next;
+	void *alloc;															//后面使用posix_memalign分配大块内存
+};
+
+//定义小块内存结构体，也是按照链表结构管理所有的节点
+struct mp_small_node {
+	unsigned char *last;													//标识当前节点空闲内存位置,会随着空间的的分配不断变化
+	unsigned char *end;														//标识当前节点内存的结束位置，不会变化。end-current可以用于标识空间的大小
+
+	struct mp_small_node *next;												//同样使用链表管理
+	size_t failed;															//用于标识这块内存分配失败的次数，如果分配失败次数过多，后面再分配大概率是不会成功的，所以可以直接跳过
+};
+
+//一个slab：头部之后是total个同样大小的对象
+struct mp_slab {
+	struct mp_slab *prev;													//所在的partial/full链表
+	struct mp_slab *next;
+	void *free;																//释放过的空闲对象链表
+	unsigned char *fresh;													//从没有分配过的对象从这里开始，用完之前不需要把它们串成链表
+	unsigned int inuse;														//已经分配出去的对象数
+	unsigned int total;														//对象总数
+	unsigned int cls;														//级别
+	struct mp_heap *owner;													//所属的线程缓存，只有mp_shared_pool使用
+};
+
+//一个级别的slab
+struct mp_slab_class {
+	struct mp_slab *partial;												//还有空闲对象的slab，从第一个分配
+	struct mp_slab *full;													//对象全部分配出去的slab
+	struct mp_slab *empty;													//缓存的空slab，最多一个
+	size_t slabs;															//这个级别正在使用的slab数（包括缓存的空slab）
+};
+
+//定义内存池
+struct mp_pool_s {
+	size_t max;																//用于标识界限，在小块内存和大块内存分配时使用
+
+	struct mp_small_node *current;											//（使用尾插法）小块内存节点指针，current指向当前应该分配的节点。如果当前节点无法继续分配空间，则在生成一个新的节点去分配内存，同时移动current指针到这个节点
+	struct mp_large_node *large;											//（使用头插法）大块内存指针，始终指向最新的内存块
+	struct mp_slab_class classes[MP_SLAB_CLASSES];							//按大小分级的slab
+
+	//https://blog.csdn.net/gatieme/article/details/64131322
+	struct mp_small_node head[0];											//柔性数组：可以保证内存连续性，减少内存碎片。
+};
+
+//线程缓存：一个线程独占，只有remote会被别的线程修改，单独占一个缓存行
+struct mp_heap {
+	void *remote __attribute__((aligned(64)));								//别的线程释放的对象（侵入式链表）
+	struct mp_slab_class classes[MP_SLAB_CLASSES] __attribute__((aligned(64)));
+	struct mp_shared_pool *pool;
+	struct mp_heap *next;													//中心池的所有线程缓存
+	struct mp_heap *orphan;													//线程退出之后在中心池的orphan链表中
+};
+
+//多线程共享的内存池
+struct mp_shared_pool {
+	pthread_mutex_t mtx;													//保护下面所有成员
+	pthread_key_t key;														//线程对应的mp_heap，线程退出时交还
+	unsigned long id;														//区分先后创建在同一个地址上的内存池
+	struct mp_slab *cached;													//空slab，通过next串起来
+	size_t cached_count;
+	size_t slabs;															//申请的slab总数
+	struct mp_heap *heaps;
+	struct mp_heap *orphans;												//没有线程使用的线程缓存
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//===============================开始声明内存池分配、释放、重置函数===============================
+struct mp_pool_s *mp_create_pool(size_t size);								//内存池构建
+void mp_destory_pool(struct mp_pool_s *pool);								//内存池销毁
+
+void mp_reset_pool(struct mp_pool_s *pool);									//内存池状态重置，但是保留了分配小块内存（last指针被置为内存的起始位置）
+
+//===============================开始声明内存分配和释放函数===============================
+void *mp_alloc(struct mp_pool_s *pool,size_t size);							//内存分配,会判断分配大块还是小块内存,包含对齐操作
+void *mp_nalloc(struct mp_pool_s *pool,size_t size);						//内存分配,会判断分配大块还是小块内存
+void *mp_calloc(struct mp_pool_s *pool,size_t size);						//内部调用mp_alloc,会对内存进行置0操作
+void mp_free(struct mp_pool_s *pool,void *p);								//内存释放，释放大块内存，内存地址为p则释放
+
+void *mp_salloc(struct mp_pool_s *pool,size_t size);						//从对应级别的slab分配，按16字节对齐，可以用mp_sfree单独释放；大于MP_SLAB_MAX时按大块内存分配
+void mp_sfree(struct mp_pool_s *pool,void *p,size_t size);					//释放mp_salloc分配的对象，size和分配时相同
+int mp_slab_class(size_t size);												//size所在的级别，大于MP_SLAB_MAX返回-1
+
+//===============================开始声明多线程共享的内存池函数===============================
+struct mp_shared_pool *mp_create_shared_pool(void);							//创建多线程共享的内存池
+void mp_destory_shared_pool(struct mp_shared_pool *pool);					//销毁，所有slab归还给系统
+void *mp_shared_alloc(struct mp_shared_pool *pool,size_t size);				//任意线程分配，按16字节对齐
+void mp_shared_free(struct mp_shared_pool *pool,void *p,size_t size);		//任意线程释放，size和分配时相同
+size_t mp_shared_slabs(struct mp_shared_pool *pool);						//当前申请的slab数
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
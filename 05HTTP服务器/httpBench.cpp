@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/*
+HTTP压测工具（类似wrk）：./httpBench ip port path threads conns seconds [pipeline]
+1.每个线程一个epoll，负责conns/threads个keep-alive连接
+2.每个连接一次发送pipeline个请求（流水线），收齐响应之后再发下一批
+3.响应支持Content-Length和Transfer-Encoding: chunked两种格式
+4.记录每个请求从发送到收到完整响应的时间，输出吞吐量和延迟分位数
+*/
+
+struct bench_conn
+{
+	int fd;
+	int outstanding;														//已发送、还没有收到响应的请求数
+	double sent_at[64];														//流水线中每个请求的发送时间，响应按顺序返回
+	int sent_head;
+	vector<char> in;														//接收缓冲区
+};
+
+struct bench_thread
+{
+	const char *ip;
+	int port;
+	const char *path;
+	int conns;
+	int pipeline;
+	double seconds;
+
+	long requests;
+	long errors;
+	long bytes;
+	vector<double> latency;													//每个请求的延迟，单位微秒
+};
+
+static double now_sec(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connect_server(const char *ip,int port){
+	int fd = socket(AF_INET,SOCK_STREAM,0);
+	if(fd < 0){
+		return -1;
+	}
+	struct sockaddr_in addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr(ip);
+	if(connect(fd,(struct sockaddr*)&addr,sizeof(addr)) == -1){
+		close(fd);
+		return -1;
+	}
+	int nodelay = 1;
+	setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&nodelay,sizeof(nodelay));
+	fcntl(fd,F_SETFL,fcntl(fd,F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+/*
+从缓冲区头部解析一个完整的响应，返回响应的总长度，数据不够返回0，格式错误返回-1
+*/
+static long parse_response(const char *buf,long len){
+	const char *end = (const char*)memmem(buf,len,"\r\n\r\n",4);
+	if(end == NULL){
+		return 0;
+	}
+	long head_len = end - buf + 4;
+	if(len < 12 || memcmp(buf,"HTTP/1.",7) != 0){
+		return -1;
+	}
+
+	long content_length = -1;
+	bool chunked = false;
+	for(const char *line = (const char*)memmem(buf,head_len,"\r\n",2) + 2;line < end;){
+		const char *next = (const char*)memmem(line,end + 2 - line,"\r\n",2);
+		if(strncasecmp(line,"Content-Length:",15) == 0){
+			content_length = atol(line + 15);
+		}else if(strncasecmp(line,"Transfer-Encoding:",18) == 0){
+			chunked = true;
+		}
+		line = next + 2;
+	}
+
+	if(!chunked){
+		if(content_length < 0){
+			return -1;														//流水线中的响应必须能确定长度
+		}
+		return len >= head_len + content_length ? head_len + content_length : 0;
+	}
+
+	//分块：逐块跳过，直到长度为0的块
+	long pos = head_len;
+	while(true){
+		const char *crlf = (const char*)memmem(buf + pos,len - pos,"\r\n",2);
+		if(crlf == NULL){
+			return 0;
+		}
+		long size = strtol(buf + pos,NULL,16);
+		pos = crlf - buf + 2 + size + 2;
+		if(pos > len){
+			return 0;
+		}
+		if(size == 0){
+			return pos;
+		}
+	}
+}
+
+static bool send_batch(bench_thread *t,bench_conn *c,const char *req,int req_len){
+	vector<char> out;
+	for(int i = 0;i < t->pipeline;i++){
+		out.insert(out.end(),req,req + req_len);
+	}
+	//一批请求通常远小于发送缓冲区，简单起见阻塞式地写完
+	size_t sent = 0;
+	while(sent < out.size()){
+		ssize_t n = send(c->fd,&out[sent],out.size() - sent,0);
+		if(n < 0){
+			if(errno == EAGAIN || errno == EINTR){
+				continue;
+			}
+			return false;
+		}
+		sent += n;
+	}
+	double now = now_sec();
+	for(int i = 0;i < t->pipeline;i++){
+		c->sent_at[i] = now;
+	}
+	c->sent_head = 0;
+	c->outstanding = t->pipeline;
+	return true;
+}
+
+static void *bench_run(void *argv){
+	bench_thread *t = (bench_thread*)argv;
+
+	char req[1024];
+	int req_len = snprintf(req,sizeof(req),"GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: httpBench\r\n\r\n",t->path,t->ip);
+
+	int epollfd = epoll_create(5);
+	vector<bench_conn> conns(t->conns);
+	for(int i = 0;i < t->conns;i++){
+		conns[i].fd = connect_server(t->ip,t->port);
+		if(conns[i].fd < 0){
+			t->errors++;
+			continue;
+		}
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u32 = i;
+		epoll_ctl(epollfd,EPOLL_CTL_ADD,conns[i].fd,&ev);
+		if(!send_batch(t,&conns[i],req,req_len)){
+			t->errors++;
+		}
+	}
+
+	double deadline = now_sec() + t->seconds;
+	epoll_event events[256];
+	char buf[64 * 1024];
+	while(now_sec() < deadline){
+		int number = epoll_wait(epollfd,events,256,100);
+		for(int i = 0;i < number;i++){
+			bench_conn *c = &conns[events[i].data.u32];
+			if(c->fd < 0){
+				continue;
+			}
+
+			bool dead = false;
+			while(true){
+				ssize_t n = recv(c->fd,buf,sizeof(buf),0);
+				if(n > 0){
+					c->in.insert(c->in.end(),buf,buf + n);
+					t->bytes += n;
+					continue;
+				}
+				if(n == 0 || (errno != EAGAIN && errno != EINTR)){
+					dead = true;
+				}
+				break;
+			}
+
+			//取出所有完整的响应
+			long off = 0;
+			double now = now_sec();
+			while(c->outstanding > 0){
+				long rsp_len = parse_response(&c->in[0] + off,c->in.size() - off);
+				if(rsp_len < 0){
+					dead = true;
+					break;
+				}
+				if(rsp_len == 0){
+					break;
+				}
+				off += rsp_len;
+				t->latency.push_back((now - c->sent_at[c->sent_head++]) * 1e6);
+				t->requests++;
+				c->outstanding--;
+			}
+			c->in.erase(c->in.begin(),c->in.begin() + off);
+
+			if(!dead && c->outstanding == 0 && !send_batch(t,c,req,req_len)){
+				dead = true;
+			}
+			if(dead){
+				t->errors++;
+				epoll_ctl(epollfd,EPOLL_CTL_DEL,c->fd,NULL);
+				close(c->fd);
+				c->fd = -1;
+			}
+		}
+	}
+
+	for(int i = 0;i < t->conns;i++){
+		if(conns[i].fd >= 0){
+			close(conns[i].fd);
+		}
+	}
+	close(epollfd);
+	return NULL;
+}
+
+int main(int argc,char **argv)
+{
+	if(argc < 7){
+		printf("usage:%s ip port path threads conns seconds [pipeline]\n",basename(argv[0]));
+		return 1;
+	}
+
+	int threads = atoi(argv[4]);
+	int conns = atoi(argv[5]);
+	int pipeline = argc > 7 ? atoi(argv[7]) : 1;
+	if(threads <= 0 || conns < threads || pipeline <= 0 || pipeline > 64){
+		printf("need threads > 0, conns >= threads, 0 < pipeline <= 64\n");
+		return 1;
+	}
+
+	vector<bench_thread> ts(threads);
+	vector<pthread_t> tids(threads);
+	for(int i = 0;i < threads;i++){
+		ts[i].ip = argv[1];
+		ts[i].port = atoi(argv[2]);
+		ts[i].path = argv[3];
+		ts[i].conns = conns / threads + (i < conns % threads ? 1 : 0);
+		ts[i].pipeline = pipeline;
+		ts[i].seconds = atof(argv[6]);
+		ts[i].requests = ts[i].errors = ts[i].bytes = 0;
+	}
+
+	double start = now_sec();
+	for(int i = 0;i < threads;i++){
+		pthread_create(&tids[i],NULL,bench_run,&ts[i]);
+	}
+
+	long requests = 0,errors = 0,bytes = 0;
+	vector<double> latency;
+	for(int i = 0;i < threads;i++){
+		pthread_join(tids[i],NULL);
+		requests += ts[i].requests;
+		errors += ts[i].errors;
+		bytes += ts[i].bytes;
+		latency.insert(latency.end(),ts[i].latency.begin(),ts[i].latency.end());
+	}
+	double spend = now_sec() - start;
+
+	printf("%s:%s%s threads:%d conns:%d pipeline:%d seconds:%.2f\n",argv[1],argv[2],argv[3],threads,conns,pipeline,spend);
+	printf("requests:%ld (%.0f req/s), %.2f MB/s, errors:%ld\n",requests,requests / spend,bytes / spend / 1024 / 1024,errors);
+	if(!latency.empty()){
+		sort(latency.begin(),latency.end());
+		size_t n = latency.size();
+		printf("latency(us) p50:%.0f p90:%.0f p99:%.0f max:%.0f\n",
+			latency[n / 2],latency[n * 90 / 100],latency[n * 99 / 100],latency[n - 1]);
+	}
+	return 0;
+}
+
+//g++ -O2 ./httpBench.cpp -o httpBench -lpthread
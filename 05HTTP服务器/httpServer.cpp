@@ -0,0 +1,710 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../01进程池/processPool.h"
+#include "../01进程池/bufferChain.h"
+#include "../02线程池/threadPool.h"
+#include "../03内存池/memoryPool.h"
+
+/*
+最小的HTTP/1.1服务器：把前面的几个组件组合起来
+1.processpool：父进程分配连接，子进程各自跑epoll事件循环
+2.buffer_chain：连接的读写缓冲，readv读入、writev写出
+3.mp_pool_s：每个连接一个内存池，请求的头部、响应、文件内容都从内存池分配，流水线中的请求全部处理完之后整体重置
+4.nThreadPool：每个子进程一个线程池，读文件这种会阻塞的操作交给线程池，完成之后通过eventfd通知事件循环
+5.shared_cache：所有子进程共享的缓存，小文件读过一次之后，任何一个子进程都可以直接从共享内存返回，不再交给线程池
+
+支持：keep-alive、流水线（pipelining，响应严格按请求顺序返回）、chunked响应、静态文件
+路由：/hello 固定的小响应（用于压测），/chunked?n=块数&size=块大小 分块响应，其他路径是文档根目录下的静态文件
+*/
+
+class http_conn;
+
+//内存池的包装：线程池中还有任务在读文件时，连接可能已经关闭，内存池要等任务都完成之后才能释放
+struct http_arena
+{
+	mp_pool_s *pool;
+	int inflight;															//还没有完成的文件读取任务
+	bool orphaned;															//连接已经关闭，最后一个任务完成时释放
+};
+
+/*
+共享缓存中小文件的值：文件的修改时间和大小，后面紧跟文件内容
+每次请求仍然会stat，修改时间或者大小变化了就认为缓存过期，重新读取并覆盖
+*/
+struct http_cached_file
+{
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	int64_t size;
+};
+
+#define HTTP_CACHE_MAX_FILE	(16 * 1024)										//不超过这个大小的文件放入共享缓存
+
+//交给线程池的读文件任务，本身也从连接的内存池中分配
+struct http_file_job
+{
+	nJob job;																//线程池任务，job.user_data指向自己
+	http_conn *conn;
+	unsigned int gen;														//提交任务时连接的代数，连接关闭或者被复用之后代数会变化
+	http_arena *arena;
+	int slot;																//响应槽位
+	char *path;
+	const char *key;														//共享缓存的key（相对于文档根目录的路径），NULL表示不缓存
+	http_cached_file *cached;												//buf前面的缓存头部，读取成功之后和文件内容一起写入共享缓存
+	char *buf;																//文件内容，大小在事件循环中stat得到
+	size_t size;
+	ssize_t result;															//读取的字节数，小于0是-errno
+	http_file_job *next;													//完成链表
+};
+
+//每个子进程一份：线程池和完成通知
+struct http_child
+{
+	bool started;
+	nThreadPool pool;
+	int efd;																//eventfd，线程池完成任务之后写它，唤醒事件循环
+	pthread_mutex_t done_mtx;
+	http_file_job *done;													//已经完成、等待事件循环处理的任务
+};
+
+static http_child s_child;
+static const char *s_docroot = ".";
+
+//一个响应槽位：流水线中的请求按顺序占用槽位，前面的槽位没有就绪时，后面的响应即使就绪了也不能发送
+struct http_response
+{
+	int state;																//RSP_EMPTY、RSP_PENDING（等待线程池）、RSP_READY
+	char *head;																//状态行和响应头
+	int head_len;
+	char *body;
+	size_t body_len;
+	bool close;																//发送完这个响应之后关闭连接
+	bool head_only;															//HEAD请求，不发送响应体
+};
+
+class http_conn{
+public:
+	http_conn() : m_arena(NULL),m_gen(0){}
+	~http_conn(){}
+public:
+	void init(int epollfd,int sockfd,const sockaddr_in& client_addr);
+	void process();
+	void complete_file(http_file_job *job);									//事件循环中调用：文件读取完成
+private:
+	enum { RSP_EMPTY = 0,RSP_PENDING,RSP_READY };
+
+	void drive();															//读取、解析、发送，直到没有进展
+	int parse_request();													//解析一个请求，返回1表示解析了一个，0表示数据不够，-1表示出错
+	void handle_get(int slot,const char *target,bool head_only,bool close);
+	void serve_file(int slot,const char *target,bool head_only,bool close);
+	void serve_chunked(int slot,const char *query,bool head_only,bool close);
+	void set_simple(int slot,int status,const char *reason,const char *type,const char *body,size_t len,bool head_only,bool close);
+	int alloc_slot();
+	bool flush();
+	void close_conn();
+	mp_pool_s *pool();
+private:
+	static const int MAX_HEADER_LEN = 8192;									//请求头最大长度
+	static const int MAX_BODY_LEN = 1024 * 1024;							//请求体最大长度，请求体读完之后直接丢弃
+	static const int MAX_PIPELINE = 32;										//一个连接同时在处理的请求数量
+	static const int MAX_PENDING_OUTPUT = 4 * 1024 * 1024;					//输出积压上限
+	static const size_t MAX_FILE_SIZE = 64 * 1024 * 1024;					//静态文件的最大长度
+	static const int ARENA_SIZE = 4096;										//连接内存池的块大小
+
+	static int m_epollfd;
+
+	int m_sockfd;
+	sockaddr_in m_address;
+
+	buffer_chain m_in;
+	buffer_chain m_out;
+	int m_scan_idx;															//已经查找过\r\n\r\n的位置
+	bool m_want_write;
+	bool m_closing;															//已经排队了一个需要关闭连接的响应，不再解析后面的请求
+
+	http_arena *m_arena;													//按需创建
+	unsigned int m_gen;														//连接代数，每次init/close都会增加
+
+	http_response m_rsp[MAX_PIPELINE];										//环形队列
+	int m_rsp_head;
+	int m_rsp_count;
+};
+
+int http_conn::m_epollfd = -1;
+
+//===============================线程池任务===============================
+//在线程池的工作线程中运行：阻塞地打开、读取文件
+static void file_job_run(nJob *job){
+	http_file_job *fj = (http_file_job*)job->user_data;
+	fj->result = 0;
+
+	int fd = open(fj->path,O_RDONLY);
+	if(fd < 0){
+		fj->result = -errno;
+	}else{
+		size_t done = 0;
+		while(done < fj->size){
+			ssize_t n = read(fd,fj->buf + done,fj->size - done);
+			if(n < 0){
+				if(errno == EINTR){
+					continue;
+				}
+				fj->result = -errno;
+				break;
+			}
+			if(n == 0){														//文件被截断了
+				break;
+			}
+			done += n;
+		}
+		close(fd);
+		if(fj->result == 0){
+			fj->result = done;
+		}
+	}
+
+	//放入完成链表，通知事件循环
+	pthread_mutex_lock(&s_child.done_mtx);
+	fj->next = s_child.done;
+	s_child.done = fj;
+	pthread_mutex_unlock(&s_child.done_mtx);
+
+	uint64_t one = 1;
+	ssize_t ret = write(s_child.efd,&one,sizeof(one));
+	(void)ret;
+}
+
+//事件循环中调用：eventfd可读，处理所有完成的任务
+static void on_file_done(int fd,void *arg){
+	(void)arg;
+	uint64_t cnt;
+	while(read(fd,&cnt,sizeof(cnt)) > 0){									//非阻塞，读到EAGAIN为止
+	}
+
+	pthread_mutex_lock(&s_child.done_mtx);
+	http_file_job *list = s_child.done;
+	s_child.done = NULL;
+	pthread_mutex_unlock(&s_child.done_mtx);
+
+	while(list){
+		http_file_job *fj = list;
+		list = list->next;
+
+		http_arena *arena = fj->arena;
+		arena->inflight--;
+		if(arena->orphaned){												//连接已经关闭了，结果直接丢弃
+			if(arena->inflight == 0){
+				mp_destory_pool(arena->pool);
+				delete arena;
+			}
+			continue;
+		}
+		fj->conn->complete_file(fj);
+	}
+}
+
+//子进程中第一次有连接时才创建线程池：线程不能跨越fork，必须在子进程中创建
+static void child_start(){
+	if(s_child.started){
+		return;
+	}
+	s_child.started = true;
+	s_child.done = NULL;
+	pthread_mutex_init(&s_child.done_mtx,NULL);
+
+	s_child.efd = eventfd(0,EFD_NONBLOCK | EFD_CLOEXEC);
+	assert(s_child.efd >= 0);
+	processpool< http_conn >::instance()->watch_fd(s_child.efd,on_file_done,NULL);
+
+	int ret = threadPoolCreate(&s_child.pool,4);
+	assert(ret == 0);
+}
+
+//===============================连接处理===============================
+void http_conn::init(int epollfd,int sockfd,const sockaddr_in& client_addr){
+	child_start();
+
+	m_epollfd = epollfd;
+	m_sockfd = sockfd;
+	m_address = client_addr;
+
+	int nodelay = 1;														//响应是一次writev写出的完整数据，不需要Nagle；否则最后一个不满的报文段要等对端的延迟确认
+	setsockopt(sockfd,IPPROTO_TCP,TCP_NODELAY,&nodelay,sizeof(nodelay));
+
+	m_in.clear();
+	m_out.clear();
+	m_scan_idx = 0;
+	m_want_write = false;
+	m_closing = false;
+	m_rsp_head = 0;
+	m_rsp_count = 0;
+	m_gen++;
+}
+
+void http_conn::close_conn(){
+	removefd(m_epollfd,m_sockfd);
+	m_in.clear();
+	m_out.clear();
+	m_rsp_count = 0;
+	m_gen++;																//还在线程池中的任务完成之后，发现代数不一致就丢弃
+
+	if(m_arena){
+		if(m_arena->inflight > 0){											//还有任务在写这个内存池，交给最后一个任务释放
+			m_arena->orphaned = true;
+		}else{
+			mp_destory_pool(m_arena->pool);
+			delete m_arena;
+		}
+		m_arena = NULL;
+	}
+}
+
+mp_pool_s *http_conn::pool(){
+	if(m_arena == NULL){
+		m_arena = new http_arena;
+		m_arena->pool = mp_create_pool(ARENA_SIZE);
+		m_arena->inflight = 0;
+		m_arena->orphaned = false;
+	}
+	return m_arena->pool;
+}
+
+int http_conn::alloc_slot(){
+	int slot = (m_rsp_head + m_rsp_count) % MAX_PIPELINE;
+	m_rsp_count++;
+	memset(&m_rsp[slot],0,sizeof(http_response));
+	m_rsp[slot].state = RSP_PENDING;
+	return slot;
+}
+
+static const char *content_type(const char *path){
+	const char *dot = strrchr(path,'.');
+	if(dot == NULL){
+		return "application/octet-stream";
+	}
+	if(strcasecmp(dot,".html") == 0 || strcasecmp(dot,".htm") == 0) return "text/html";
+	if(strcasecmp(dot,".txt") == 0) return "text/plain";
+	if(strcasecmp(dot,".css") == 0) return "text/css";
+	if(strcasecmp(dot,".js") == 0) return "application/javascript";
+	if(strcasecmp(dot,".json") == 0) return "application/json";
+	if(strcasecmp(dot,".png") == 0) return "image/png";
+	if(strcasecmp(dot,".jpg") == 0 || strcasecmp(dot,".jpeg") == 0) return "image/jpeg";
+	return "application/octet-stream";
+}
+
+//组织一个完整的、已经就绪的响应，响应头和响应体都从内存池分配
+void http_conn::set_simple(int slot,int status,const char *reason,const char *type,const char *body,size_t len,bool head_only,bool close){
+	http_response &r = m_rsp[slot];
+	r.head = (char*)mp_nalloc(pool(),256);
+	r.head_len = snprintf(r.head,256,"HTTP/1.1 %d %s\r\nServer: processpool\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s\r\n",
+						status,reason,type,len,close ? "Connection: close\r\n" : "");
+	r.body = (char*)body;
+	r.body_len = len;
+	r.head_only = head_only;
+	r.close = close;
+	r.state = RSP_READY;
+}
+
+/*
+静态文件：在事件循环中stat（元数据通常在缓存中），文件内容的读取交给线程池
+目标必须以/开头（否则docroot+target会落到docroot的兄弟目录），路径中不允许出现".."，防止访问文档根目录之外的文件
+*/
+void http_conn::serve_file(int slot,const char *target,bool head_only,bool close){
+	if(target[0] != '/'){
+		set_simple(slot,400,"Bad Request","text/plain","bad request\n",12,head_only,close);
+		return;
+	}
+	if(strstr(target,"..") != NULL){
+		set_simple(slot,403,"Forbidden","text/plain","forbidden\n",10,head_only,close);
+		return;
+	}
+
+	size_t plen = strlen(s_docroot) + strlen(target) + 16;
+	char *path = (char*)mp_nalloc(pool(),plen);
+	snprintf(path,plen,"%s%s",s_docroot,target);
+
+	struct stat st;
+	if(stat(path,&st) == 0 && S_ISDIR(st.st_mode)){						//目录使用index.html
+		strncat(path,target[strlen(target) - 1] == '/' ? "index.html" : "/index.html",plen - strlen(path) - 1);
+	}
+	if(stat(path,&st) == -1 || !S_ISREG(st.st_mode)){
+		set_simple(slot,404,"Not Found","text/plain","not found\n",10,head_only,close);
+		return;
+	}
+	if((size_t)st.st_size > MAX_FILE_SIZE){
+		set_simple(slot,403,"Forbidden","text/plain","too large\n",10,head_only,close);
+		return;
+	}
+
+	//HEAD请求或者空文件不需要读取内容
+	if(head_only || st.st_size == 0){
+		set_simple(slot,200,"OK",content_type(path),NULL,st.st_size,head_only,close);
+		return;
+	}
+
+	//小文件先查共享缓存，key是相对于文档根目录的路径
+	const char *key = path + strlen(s_docroot);
+	int klen = strlen(key);
+	shared_cache *cache = processpool< http_conn >::instance()->cache();
+	bool cacheable = cache && st.st_size <= HTTP_CACHE_MAX_FILE && klen <= SC_MAX_KEY;
+
+	//缓存头部和文件内容放在一起分配，读取完成之后可以直接整块写入缓存
+	http_cached_file *cached = (http_cached_file*)mp_nalloc(pool(),sizeof(http_cached_file) + st.st_size);
+	char *buf = (char*)(cached + 1);
+	if(cacheable){
+		int vlen = 0;
+		int want = sizeof(http_cached_file) + st.st_size;
+		if(cache->get(key,klen,cached,want,&vlen) && vlen == want && cached->size == st.st_size
+			&& cached->mtime_sec == st.st_mtim.tv_sec && cached->mtime_nsec == st.st_mtim.tv_nsec){
+			set_simple(slot,200,"OK",content_type(path),buf,st.st_size,false,close);
+			return;
+		}
+		cached->mtime_sec = st.st_mtim.tv_sec;
+		cached->mtime_nsec = st.st_mtim.tv_nsec;
+		cached->size = st.st_size;
+	}
+
+	http_file_job *fj = (http_file_job*)mp_nalloc(pool(),sizeof(http_file_job));
+	fj->job.job_function = file_job_run;
+	fj->job.user_data = fj;
+	fj->conn = this;
+	fj->gen = m_gen;
+	fj->arena = m_arena;
+	fj->slot = slot;
+	fj->path = path;
+	fj->key = cacheable ? key : NULL;
+	fj->cached = cached;
+	fj->buf = buf;															//大于4095字节时内存池使用malloc，重置内存池时统一释放
+	fj->size = st.st_size;
+	fj->result = 0;
+	fj->next = NULL;
+
+	//事件循环不能阻塞：读文件的队列满了说明磁盘跟不上，直接返回503让客户端稍后重试
+	m_rsp[slot].close = close;
+	m_arena->inflight++;
+	if(threadPoolTryQueue(&s_child.pool,&fj->job) != 0){
+		m_arena->inflight--;
+		set_simple(slot,503,"Service Unavailable","text/plain","busy\n",5,false,close);
+	}
+}
+
+//事件循环中调用
+void http_conn::complete_file(http_file_job *fj){
+	if(fj->gen != m_gen){
+		return;
+	}
+
+	bool close = m_rsp[fj->slot].close;
+	if(fj->result < 0 || (size_t)fj->result != fj->size){
+		set_simple(fj->slot,500,"Internal Server Error","text/plain","read error\n",11,false,close);
+	}else{
+		if(fj->key){														//写入共享缓存，其他子进程也能命中
+			shared_cache *cache = processpool< http_conn >::instance()->cache();
+			cache->put(fj->key,strlen(fj->key),fj->cached,sizeof(http_cached_file) + fj->size);
+		}
+		set_simple(fj->slot,200,"OK",content_type(fj->path),fj->buf,fj->size,false,close);
+	}
+	drive();
+}
+
+//分块响应：n个size字节的块，演示Transfer-Encoding: chunked
+void http_conn::serve_chunked(int slot,const char *query,bool head_only,bool close){
+	int n = 4,size = 16;
+	const char *p;
+	if(query && (p = strstr(query,"n=")) != NULL){
+		n = atoi(p + 2);
+	}
+	if(query && (p = strstr(query,"size=")) != NULL){
+		size = atoi(p + 5);
+	}
+	if(n < 0 || n > 1024 || size <= 0 || size > 65536){
+		set_simple(slot,400,"Bad Request","text/plain","bad chunk args\n",15,head_only,close);
+		return;
+	}
+
+	//每个块："十六进制长度\r\n" + 数据 + "\r\n"，最后是"0\r\n\r\n"
+	size_t cap = (size_t)n * (size + 16) + 8;
+	char *body = (char*)mp_nalloc(pool(),cap);
+	size_t len = 0;
+	for(int i = 0;i < n;i++){
+		len += snprintf(body + len,cap - len,"%x\r\n",size);
+		memset(body + len,'a' + i % 26,size);
+		len += size;
+		memcpy(body + len,"\r\n",2);
+		len += 2;
+	}
+	memcpy(body + len,"0\r\n\r\n",5);
+	len += 5;
+
+	http_response &r = m_rsp[slot];
+	r.head = (char*)mp_nalloc(pool(),256);
+	r.head_len = snprintf(r.head,256,"HTTP/1.1 200 OK\r\nServer: processpool\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n%s\r\n",
+						close ? "Connection: close\r\n" : "");
+	r.body = body;
+	r.body_len = len;
+	r.head_only = head_only;
+	r.close = close;
+	r.state = RSP_READY;
+}
+
+void http_conn::handle_get(int slot,const char *target,bool head_only,bool close){
+	char *query = (char*)strchr(target,'?');
+	if(query){
+		*query++ = '\0';
+	}
+
+	if(strcmp(target,"/hello") == 0){
+		static const char hello[] = "Hello, World!\n";
+		set_simple(slot,200,"OK","text/plain",hello,sizeof(hello) - 1,head_only,close);
+	}else if(strcmp(target,"/chunked") == 0){
+		serve_chunked(slot,query,head_only,close);
+	}else{
+		serve_file(slot,target,head_only,close);
+	}
+}
+
+/*
+解析一个请求：找到\r\n\r\n，把请求头拷贝到内存池中（以\0结尾，方便按行解析），请求体按Content-Length跳过
+*/
+int http_conn::parse_request(){
+	int end = m_in.find("\r\n\r\n",4,m_scan_idx);
+	if(end == -1){
+		if(m_in.size() > MAX_HEADER_LEN){
+			return -1;
+		}
+		m_scan_idx = m_in.size() > 3 ? m_in.size() - 3 : 0;				//分隔符可能跨越两次读取
+		return 0;
+	}
+
+	int head_len = end + 4;
+	char *head = (char*)mp_nalloc(pool(),head_len + 1);
+	m_in.copy_out(head,head_len);
+	head[head_len] = '\0';
+
+	//请求行：方法 目标 版本
+	char *line_end = strstr(head,"\r\n");
+	*line_end = '\0';
+	char *method = head;
+	char *target = strchr(method,' ');
+	if(target == NULL){
+		return -1;
+	}
+	*target++ = '\0';
+	char *version = strchr(target,' ');
+	if(version == NULL){
+		return -1;
+	}
+	*version++ = '\0';
+
+	bool http11 = strcmp(version,"HTTP/1.1") == 0;
+	if(!http11 && strcmp(version,"HTTP/1.0") != 0){
+		return -1;
+	}
+	bool keep_alive = http11;												//HTTP/1.1默认长连接，HTTP/1.0默认短连接
+	long content_length = 0;
+	bool chunked_body = false;
+
+	//逐行解析请求头
+	for(char *line = line_end + 2;*line && !(line[0] == '\r' && line[1] == '\n');){
+		char *next = strstr(line,"\r\n");
+		*next = '\0';
+		char *colon = strchr(line,':');
+		if(colon){
+			*colon = '\0';
+			char *value = colon + 1;
+			while(*value == ' ' || *value == '\t'){
+				value++;
+			}
+			if(strcasecmp(line,"Connection") == 0){
+				if(strcasecmp(value,"close") == 0){
+					keep_alive = false;
+				}else if(strcasecmp(value,"keep-alive") == 0){
+					keep_alive = true;
+				}
+			}else if(strcasecmp(line,"Content-Length") == 0){
+				content_length = atol(value);
+			}else if(strcasecmp(line,"Transfer-Encoding") == 0){
+				chunked_body = strcasecmp(value,"identity") != 0;
+			}
+		}
+		line = next + 2;
+	}
+
+	if(content_length < 0 || content_length > MAX_BODY_LEN || chunked_body){	//分块的请求体不支持
+		return -1;
+	}
+	if(m_in.size() < head_len + content_length){							//请求体还没有收全，下次重新解析请求头（内存池重置之前这点空间可以忽略）
+		return 0;
+	}
+	m_in.consume(head_len + content_length);
+	m_scan_idx = 0;
+
+	int slot = alloc_slot();
+	bool close = !keep_alive;
+	if(strcmp(method,"GET") == 0){
+		handle_get(slot,target,false,close);
+	}else if(strcmp(method,"HEAD") == 0){
+		handle_get(slot,target,true,close);
+	}else{
+		set_simple(slot,405,"Method Not Allowed","text/plain","method not allowed\n",19,false,close);
+	}
+
+	if(close){
+		m_closing = true;
+	}
+	return 1;
+}
+
+//把队首就绪的响应按顺序放入输出缓冲区并发送，返回false表示需要关闭连接
+bool http_conn::flush(){
+	while(m_rsp_count > 0 && m_rsp[m_rsp_head].state == RSP_READY){
+		http_response &r = m_rsp[m_rsp_head];
+		m_out.append(r.head,r.head_len);
+		if(!r.head_only && r.body_len > 0){
+			m_out.append(r.body,r.body_len);
+		}
+		r.state = RSP_EMPTY;
+		m_rsp_head = (m_rsp_head + 1) % MAX_PIPELINE;
+		m_rsp_count--;
+	}
+
+	//流水线中的请求都处理完了，并且没有任务在使用内存池，整体重置：请求头、响应、文件内容一次性回收
+	if(m_rsp_count == 0 && m_arena && m_arena->inflight == 0){
+		mp_reset_pool(m_arena->pool);
+	}
+
+	while(!m_out.empty()){
+		int ret = m_out.write_fd(m_sockfd);
+		if(ret < 0){
+			if(errno == EAGAIN){
+				if(!m_want_write){
+					modfd(m_epollfd,m_sockfd,EPOLLIN | EPOLLOUT);
+					m_want_write = true;
+				}
+				return true;
+			}
+			return false;
+		}
+	}
+
+	if(m_want_write){
+		modfd(m_epollfd,m_sockfd,EPOLLIN);
+		m_want_write = false;
+	}
+
+	//需要关闭连接的响应一定是最后一个（之后不再解析），它发送完毕就关闭
+	return !(m_closing && m_rsp_count == 0);
+}
+
+void http_conn::drive(){
+	while(true){
+		bool progress = false;
+
+		//解析缓冲区中已有的请求；槽位满了或者输出积压时暂停，等响应发出去之后再继续
+		while(!m_closing && m_rsp_count < MAX_PIPELINE && m_out.size() < MAX_PENDING_OUTPUT){
+			int ret = parse_request();
+			if(ret < 0){
+				int slot = alloc_slot();
+				set_simple(slot,400,"Bad Request","text/plain","bad request\n",12,false,true);
+				m_closing = true;
+				break;
+			}
+			if(ret == 0){
+				//数据不够，边缘触发要读到EAGAIN
+				int n = m_in.read_fd(m_sockfd);
+				if(n == 0 || (n < 0 && errno != EAGAIN)){
+					close_conn();
+					return;
+				}
+				if(n < 0){
+					break;
+				}
+			}
+			progress = true;
+		}
+
+		int before = m_rsp_count;
+		if(!flush()){
+			close_conn();
+			return;
+		}
+
+		//发出了响应腾出了槽位，并且输出没有积压，继续解析；否则等线程池完成或者可写事件
+		if(!progress || m_rsp_count == before || m_want_write){
+			break;
+		}
+	}
+}
+
+void http_conn::process(){
+	drive();
+}
+
+int main(int argc,char *argv[])
+{
+	if(argc <= 3){
+		printf("useage:%s ip_address port_number docroot [process_number] [cache_entries]\n",basename(argv[0]));
+		return 1;
+	}
+
+	int port = atoi(argv[2]);
+	s_docroot = argv[3];
+	int process_number = argc > 4 ? atoi(argv[4]) : 4;
+	int cache_entries = argc > 5 ? atoi(argv[5]) : 1024;					//0表示不使用共享缓存
+
+	int listenfd = socket(AF_INET,SOCK_STREAM,0);
+	assert(listenfd >= 0);
+
+	int ret = 0;
+	struct sockaddr_in address;
+	bzero(&address,sizeof(address));
+
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+
+	int reuse = 1;
+	setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	ret = bind(listenfd,(struct sockaddr*)&address,sizeof(address));
+	assert(ret != -1);
+
+	ret = listen(listenfd,1024);
+	assert(ret != -1);
+
+	processpool< http_conn >::set_shared_cache(cache_entries,sizeof(http_cached_file) + HTTP_CACHE_MAX_FILE);
+	processpool< http_conn > *pool = processpool< http_conn >::create(listenfd,process_number);
+	if(pool){
+		pool->run();
+		delete pool;
+	}
+
+	close(listenfd);
+
+	return 0;
+}
+
+//g++ -O2 ./httpServer.cpp ../02线程池/threadPool.c ../03内存池/memoryPool.c -o httpServer -lpthread